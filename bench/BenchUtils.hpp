@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <limits>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace bench
+{
+    /**
+     * Пиковый объём резидентной памяти процесса в килобайтах
+     * (0, если на платформе значение недоступно)
+     */
+    inline size_t PeakRSSKb()
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+        return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+    }
+
+    /**
+     * Лучшее время выполнения функции (в секундах) из repeats запусков
+     */
+    inline double BestTime(const std::function<void()> &func, const size_t repeats)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (size_t i = 0; i != repeats; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const auto end = std::chrono::steady_clock::now();
+            const double time = std::chrono::duration<double>(end - start).count();
+            best = time < best ? time : best;
+        }
+        return best;
+    }
+
+} // namespace bench
@@ -0,0 +1,495 @@
+#include "BenchUtils.hpp"
+
+#include "AABBTree.hpp"
+#include "MathOperations.hpp"
+#include "Mesh.hpp"
+#include "OBBTree.hpp"
+#include "Parallel.hpp"
+#include "QuantizedAABBTree.hpp"
+#include "WideAABBTree.hpp"
+#include "ReadSTL.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace math;
+using namespace read_stl;
+using namespace std::literals;
+
+// Использование:
+//   benchAABBTree <file_1.stl> <file_2.stl> - замерить построение деревьев двух тел,
+//                                             поиск ближайшей пары и память деревьев
+//                                             для каждого способа построения и размера листа,
+//                                             затем поиск по широким деревьям BVH4 и BVH8
+//                                             и по иерархиям ориентированных боксов,
+//                                             затем по сжатым деревьям с 8- и 16-битными боксами
+//   benchAABBTree threads <file_1.stl> <file_2.stl> - время параллельного поиска ближайшей пары
+//                                             на 1, 2, 4, ... потоках и сверка с последовательным
+//   benchAABBTree refit <file_1.stl> <file_2.stl> - серия закручиваний первого тела: построение
+//                                             заново, обновление границ и обновление
+//                                             с перестроением поддеревьев, время поиска после каждого
+//   benchAABBTree scaling <file.stl> [copies]  - время построения SAH- и LBVH-дерева по copies копиям
+//                                             тела (по умолчанию 64) на 1, 2, 4, ... потоках
+//   benchAABBTree narrow <file_1.stl> <file_2.stl> - точные расстояния между треугольниками
+//                                             в области сближения тел по одной паре и пакетами,
+//                                             без границы и с границей - расстоянием между телами
+namespace
+{
+    // Сетка из copies копий тела, сдвинутых вдоль x без перекрытия
+    std::shared_ptr<const Mesh> TileMesh(const Mesh &mesh, const size_t copies)
+    {
+        double min_x = std::numeric_limits<double>::max(), max_x = std::numeric_limits<double>::lowest();
+        for (size_t i = 0; i != mesh.VertexCount(); ++i)
+        {
+            min_x = std::min(min_x, mesh.Coord(static_cast<uint32_t>(i), 0));
+            max_x = std::max(max_x, mesh.Coord(static_cast<uint32_t>(i), 0));
+        }
+        const double step = 1.1 * (max_x - min_x) + 1.0;
+
+        std::vector<double> x, y, z;
+        std::vector<uint32_t> indices;
+        for (size_t copy = 0; copy != copies; ++copy)
+        {
+            const uint32_t base = static_cast<uint32_t>(x.size());
+            for (size_t i = 0; i != mesh.VertexCount(); ++i)
+            {
+                const uint32_t vertex = static_cast<uint32_t>(i);
+                x.push_back(mesh.Coord(vertex, 0) + static_cast<double>(copy) * step);
+                y.push_back(mesh.Coord(vertex, 1));
+                z.push_back(mesh.Coord(vertex, 2));
+            }
+            for (const uint32_t index : mesh.Indices())
+            {
+                indices.push_back(base + index);
+            }
+        }
+        return std::make_shared<const Mesh>(std::move(x), std::move(y), std::move(z), std::move(indices));
+    }
+
+    void RunQuery(const std::shared_ptr<const Mesh> &mesh_1, const std::shared_ptr<const Mesh> &mesh_2,
+                  const AABBTreeOptions &options)
+    {
+        const double build_time = bench::BestTime([&]
+                                                  {
+                                                      AABBTree tree_1(mesh_1, options);
+                                                      AABBTree tree_2(mesh_2, options);
+                                                  },
+                                                  5);
+
+        AABBTree tree_1(mesh_1, options);
+        AABBTree tree_2(mesh_2, options);
+
+        size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+        double distance = 0.0;
+        const double query_time = bench::BestTime([&]
+                                                  { tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, distance); },
+                                                  5);
+        AABBTreeQueryStats stats;
+        tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, distance, &stats);
+
+        double best_first_distance = 0.0;
+        const double best_first_time = bench::BestTime(
+            [&]
+            { tree_1.FindClosestTrianglesBestFirst(tree_2, closest_1, closest_2, best_first_distance); },
+            5);
+        AABBTreeQueryStats best_first_stats;
+        tree_1.FindClosestTrianglesBestFirst(tree_2, closest_1, closest_2, best_first_distance, &best_first_stats);
+
+        std::cout << "Build time: "s << build_time << " seconds"s << std::endl;
+        std::cout << "Query time: "s << query_time << " seconds (best-first: "s << best_first_time << ")"s
+                  << std::endl;
+        std::cout << "Node pairs: "s << stats.node_pairs << ", triangle pairs: "s << stats.triangle_pairs
+                  << ", culled triangle pairs: "s << stats.culled_pairs << std::endl;
+        std::cout << "Expanded pairs: "s << stats.expanded_pairs << " (best-first: "s
+                  << best_first_stats.expanded_pairs << ")"s << std::endl;
+        std::cout << "Distance: "s << distance << " (triangles "s << closest_1 << ", "s << closest_2 << ")"s << std::endl;
+        std::cout << "Trees nodes: "s << tree_1.Nodes().size() + tree_2.Nodes().size()
+                  << ", memory: "s << (tree_1.MemoryBytes() + tree_2.MemoryBytes()) / 1024 << " KB"s << std::endl;
+    }
+
+    template <size_t Width>
+    void RunWideQuery(const AABBTree &tree_1, const AABBTree &tree_2)
+    {
+        const WideAABBTree<Width> wide_1(tree_1);
+        const WideAABBTree<Width> wide_2(tree_2);
+
+        size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+        double distance = 0.0;
+        const double query_time = bench::BestTime([&]
+                                                  { wide_1.FindClosestTriangles(wide_2, closest_1, closest_2, distance); },
+                                                  5);
+        AABBTreeQueryStats stats;
+        wide_1.FindClosestTriangles(wide_2, closest_1, closest_2, distance, &stats);
+
+        std::cout << "\nWide tree: BVH"s << Width << std::endl;
+        std::cout << "Query time: "s << query_time << " seconds"s << std::endl;
+        std::cout << "Box tests: "s << stats.node_pairs << ", triangle pairs: "s << stats.triangle_pairs << std::endl;
+        std::cout << "Distance: "s << distance << " (triangles "s << closest_1 << ", "s << closest_2 << ")"s << std::endl;
+        std::cout << "Wide nodes memory: "s << (wide_1.MemoryBytes() + wide_2.MemoryBytes()) / 1024 << " KB"s
+                  << std::endl;
+    }
+
+    template <typename T>
+    void RunQuantizedQuery(const AABBTree &tree_1, const AABBTree &tree_2)
+    {
+        const QuantizedAABBTree<T> quantized_1(tree_1);
+        const QuantizedAABBTree<T> quantized_2(tree_2);
+
+        size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+        double distance = 0.0;
+        const double query_time = bench::BestTime(
+            [&]
+            { quantized_1.FindClosestTriangles(quantized_2, closest_1, closest_2, distance); },
+            5);
+        AABBTreeQueryStats stats;
+        quantized_1.FindClosestTriangles(quantized_2, closest_1, closest_2, distance, &stats);
+
+        std::cout << "\nQuantized tree: "s << 8 * sizeof(T) << " bit bounds"s << std::endl;
+        std::cout << "Query time: "s << query_time << " seconds"s << std::endl;
+        std::cout << "Node pairs: "s << stats.node_pairs << ", triangle pairs: "s << stats.triangle_pairs << std::endl;
+        std::cout << "Distance: "s << distance << " (triangles "s << closest_1 << ", "s << closest_2 << ")"s << std::endl;
+        std::cout << "Trees memory: "s << (quantized_1.MemoryBytes() + quantized_2.MemoryBytes()) / 1024
+                  << " KB (binary: "s << (tree_1.MemoryBytes() + tree_2.MemoryBytes()) / 1024 << " KB)"s
+                  << std::endl;
+    }
+
+    void RunOBBQuery(const AABBTree &tree_1, const AABBTree &tree_2, const BoundingVolume volume_1,
+                     const BoundingVolume volume_2)
+    {
+        const double build_time = bench::BestTime([&]
+                                                  {
+                                                      OBBTree obb_1(tree_1, volume_1);
+                                                      OBBTree obb_2(tree_2, volume_2);
+                                                  },
+                                                  5);
+        const OBBTree obb_1(tree_1, volume_1);
+        const OBBTree obb_2(tree_2, volume_2);
+
+        size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+        double distance = 0.0;
+        const double query_time = bench::BestTime([&]
+                                                  { obb_1.FindClosestTriangles(obb_2, closest_1, closest_2, distance); },
+                                                  5);
+        AABBTreeQueryStats stats;
+        obb_1.FindClosestTriangles(obb_2, closest_1, closest_2, distance, &stats);
+
+        const auto name = [](const BoundingVolume volume)
+        { return volume == BoundingVolume::OBB ? "OBB"s : "AABB"s; };
+        std::cout << "\nBounding volumes: "s << name(volume_1) << " / "s << name(volume_2) << std::endl;
+        std::cout << "Build time: "s << build_time << " seconds"s << std::endl;
+        std::cout << "Query time: "s << query_time << " seconds"s << std::endl;
+        std::cout << "Node pairs: "s << stats.node_pairs << ", triangle pairs: "s << stats.triangle_pairs << std::endl;
+        std::cout << "Distance: "s << distance << " (triangles "s << closest_1 << ", "s << closest_2 << ")"s << std::endl;
+        std::cout << "Boxes memory: "s << (obb_1.MemoryBytes() + obb_2.MemoryBytes()) / 1024 << " KB"s << std::endl;
+    }
+
+    int RunQueryThreads(const std::string &filename_1, const std::string &filename_2)
+    {
+        const AABBTree tree_1(std::make_shared<const Mesh>(ReadMesh(filename_1)));
+        const AABBTree tree_2(std::make_shared<const Mesh>(ReadMesh(filename_2)));
+        std::cout << "Files: "s << filename_1 << ", "s << filename_2 << std::endl;
+
+        size_t serial_1 = AABBTree::kNoTriangle, serial_2 = AABBTree::kNoTriangle;
+        double serial_distance = 0.0;
+        const double serial_time = bench::BestTime([&]
+                                                   { tree_1.FindClosestTriangles(tree_2, serial_1, serial_2, serial_distance); },
+                                                   5);
+        std::cout << "Serial: "s << serial_time << " seconds, distance "s << serial_distance << std::endl;
+
+        const size_t max_threads = parallel::DefaultThreadCount();
+        for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+        {
+            size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+            double distance = 0.0;
+            const double query_time = bench::BestTime(
+                [&]
+                { tree_1.FindClosestTrianglesParallel(tree_2, closest_1, closest_2, distance, num_threads); },
+                5);
+            const bool same = distance == serial_distance && closest_1 == serial_1 && closest_2 == serial_2;
+            std::cout << "Threads: "s << num_threads << ", query time: "s << query_time << " seconds"s
+                      << (same ? ""s : " (RESULT DIFFERS)"s) << std::endl;
+        }
+        return 0;
+    }
+
+    int RunRefit(const std::string &filename_1, const std::string &filename_2)
+    {
+        const auto mesh_1 = std::make_shared<const Mesh>(ReadMesh(filename_1));
+        const AABBTree tree_2(std::make_shared<const Mesh>(ReadMesh(filename_2)));
+        std::cout << "Files: "s << filename_1 << ", "s << filename_2 << std::endl;
+
+        // Закручивание вокруг оси z через центр бокса тела, угол растёт с высотой
+        double min_z = std::numeric_limits<double>::max(), max_z = std::numeric_limits<double>::lowest();
+        double center_x = 0.0, center_y = 0.0;
+        for (size_t i = 0; i != mesh_1->VertexCount(); ++i)
+        {
+            const uint32_t vertex = static_cast<uint32_t>(i);
+            min_z = std::min(min_z, mesh_1->Coord(vertex, 2));
+            max_z = std::max(max_z, mesh_1->Coord(vertex, 2));
+            center_x += mesh_1->Coord(vertex, 0) / static_cast<double>(mesh_1->VertexCount());
+            center_y += mesh_1->Coord(vertex, 1) / static_cast<double>(mesh_1->VertexCount());
+        }
+        const auto twist = [&](const double angle)
+        {
+            std::vector<double> x, y, z;
+            for (size_t i = 0; i != mesh_1->VertexCount(); ++i)
+            {
+                const uint32_t vertex = static_cast<uint32_t>(i);
+                const double height = max_z > min_z ? (mesh_1->Coord(vertex, 2) - min_z) / (max_z - min_z) : 0.0;
+                const double c = std::cos(angle * height), s = std::sin(angle * height);
+                const double dx = mesh_1->Coord(vertex, 0) - center_x, dy = mesh_1->Coord(vertex, 1) - center_y;
+                x.push_back(center_x + c * dx - s * dy);
+                y.push_back(center_y + s * dx + c * dy);
+                z.push_back(mesh_1->Coord(vertex, 2));
+            }
+            return std::make_shared<const Mesh>(std::move(x), std::move(y), std::move(z), mesh_1->Indices());
+        };
+
+        AABBTree refit(mesh_1), rebuilt(mesh_1);
+        const AABBTreeRefitOptions rebuild_options{.rebuild_overlap = 0.5, .build = {}};
+        for (size_t step = 1; step <= 8; ++step)
+        {
+            const auto mesh = twist(0.25 * static_cast<double>(step));
+            const double build_time = bench::BestTime([&]
+                                                      { AABBTree tree(mesh); },
+                                                      3);
+            const double refit_time = bench::BestTime([&]
+                                                      { AABBTree(refit).Refit(mesh); },
+                                                      3);
+            refit.Refit(mesh);
+            size_t num_rebuilt = 0;
+            const double rebuild_time = bench::BestTime([&]
+                                                        { num_rebuilt = AABBTree(rebuilt).Refit(mesh, rebuild_options); },
+                                                        3);
+            rebuilt.Refit(mesh, rebuild_options);
+
+            const AABBTree fresh(mesh);
+            size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+            double distance = 0.0;
+            const auto query = [&](const AABBTree &tree)
+            {
+                return bench::BestTime([&]
+                                       { tree.FindClosestTriangles(tree_2, closest_1, closest_2, distance); },
+                                       3);
+            };
+            std::cout << "\nTwist step "s << step << std::endl;
+            std::cout << "Build: "s << build_time << " s, query "s << query(fresh) << " s"s << std::endl;
+            std::cout << "Refit: "s << refit_time << " s, query "s << query(refit) << " s"s << std::endl;
+            std::cout << "Refit + rebuild ("s << num_rebuilt << " subtrees): "s << rebuild_time << " s, query "s
+                      << query(rebuilt) << " s, distance "s << distance << std::endl;
+        }
+        return 0;
+    }
+
+    int RunScaling(const std::string &filename, const size_t copies)
+    {
+        const auto mesh = TileMesh(ReadMesh(filename), copies);
+        std::cout << "File: "s << filename << " x "s << copies << std::endl;
+        std::cout << "Triangles: "s << mesh->TriangleCount() << std::endl;
+
+        const size_t max_threads = parallel::DefaultThreadCount();
+        for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+        {
+            const AABBTreeOptions options{.method = BuildMethod::SAH, .num_threads = num_threads};
+            const double build_time = bench::BestTime([&]
+                                                      { AABBTree tree(mesh, options); },
+                                                      3);
+            const AABBTreeOptions lbvh_options{.method = BuildMethod::LBVH, .num_threads = num_threads};
+            const double lbvh_time = bench::BestTime([&]
+                                                     { AABBTree tree(mesh, lbvh_options); },
+                                                     3);
+            std::cout << "Threads: "s << num_threads << ", build time: "s << build_time << " seconds (LBVH: "s
+                      << lbvh_time << ")"s << std::endl;
+        }
+        return 0;
+    }
+
+    int RunNarrowPhase(const std::string &filename_1, const std::string &filename_2)
+    {
+        const auto mesh_1 = std::make_shared<const Mesh>(ReadMesh(filename_1));
+        const auto mesh_2 = std::make_shared<const Mesh>(ReadMesh(filename_2));
+        std::cout << "Files: "s << filename_1 << ", "s << filename_2 << std::endl;
+
+        size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+        double distance = 0.0;
+        AABBTree(mesh_1).FindClosestTriangles(AABBTree(mesh_2), closest_1, closest_2, distance);
+
+        // Треугольники тела, ближайшие по центру к центру ближайшего треугольника первого тела
+        const auto corner = [](const Mesh &mesh, const size_t triangle, const size_t index, const size_t axis)
+        { return mesh.Coord(mesh.Indices()[3 * triangle + index], axis); };
+        std::array<double, 3> center{};
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            center[axis] = (corner(*mesh_1, closest_1, 0, axis) + corner(*mesh_1, closest_1, 1, axis) +
+                            corner(*mesh_1, closest_1, 2, axis)) / 3.0;
+        }
+        const size_t num_nearest = 128;
+        const auto nearest = [&](const Mesh &mesh)
+        {
+            std::vector<std::pair<double, size_t>> by_distance;
+            for (size_t triangle = 0; triangle != mesh.TriangleCount(); ++triangle)
+            {
+                double squared = 0.0;
+                for (size_t axis = 0; axis != 3; ++axis)
+                {
+                    const double delta = (corner(mesh, triangle, 0, axis) + corner(mesh, triangle, 1, axis) +
+                                          corner(mesh, triangle, 2, axis)) / 3.0 - center[axis];
+                    squared += delta * delta;
+                }
+                by_distance.emplace_back(squared, triangle);
+            }
+            const size_t count = std::min(num_nearest, by_distance.size());
+            std::partial_sort(by_distance.begin(), by_distance.begin() + static_cast<std::ptrdiff_t>(count),
+                              by_distance.end());
+            std::vector<TrianglePoints> triangles(count);
+            for (size_t k = 0; k != count; ++k)
+            {
+                for (size_t index = 0; index != 3; ++index)
+                {
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        triangles[k][index][axis] = corner(mesh, by_distance[k].second, index, axis);
+                    }
+                }
+            }
+            return triangles;
+        };
+        const std::vector<TrianglePoints> triangles_1 = nearest(*mesh_1);
+        const std::vector<TrianglePoints> triangles_2 = nearest(*mesh_2);
+
+        // Все пары двух наборов структурой массивов
+        const size_t num_pairs = triangles_1.size() * triangles_2.size();
+        std::vector<double> coords_1(9 * num_pairs), coords_2(9 * num_pairs);
+        for (size_t i = 0; i != triangles_1.size(); ++i)
+        {
+            for (size_t j = 0; j != triangles_2.size(); ++j)
+            {
+                const size_t pair = i * triangles_2.size() + j;
+                for (size_t row = 0; row != 9; ++row)
+                {
+                    coords_1[row * num_pairs + pair] = triangles_1[i][row / 3][row % 3];
+                    coords_2[row * num_pairs + pair] = triangles_2[j][row / 3][row % 3];
+                }
+            }
+        }
+
+        std::vector<double> scalar(num_pairs), batched(num_pairs);
+        const double scalar_time = bench::BestTime(
+            [&]
+            {
+                for (size_t i = 0; i != triangles_1.size(); ++i)
+                {
+                    for (size_t j = 0; j != triangles_2.size(); ++j)
+                    {
+                        std::array<double, 3> point_1, point_2;
+                        scalar[i * triangles_2.size() + j] = TriangleDistance(triangles_1[i], triangles_2[j],
+                                                                              point_1, point_2);
+                    }
+                }
+            },
+            5);
+        const double batch_time = bench::BestTime([&]
+                                                  { TriangleDistances(coords_1.data(), coords_2.data(), num_pairs,
+                                                                      num_pairs, batched.data()); },
+                                                  5);
+        // С границей - найденным расстоянием между телами, как у обхода после первого листа
+        std::vector<double> bounded(num_pairs);
+        const double bounded_time = bench::BestTime([&]
+                                                    { TriangleDistances(coords_1.data(), coords_2.data(), num_pairs,
+                                                                        num_pairs, bounded.data(), distance); },
+                                                    5);
+        const double scalar_bounded_time = bench::BestTime(
+            [&]
+            {
+                for (size_t i = 0; i != triangles_1.size(); ++i)
+                {
+                    for (size_t j = 0; j != triangles_2.size(); ++j)
+                    {
+                        std::array<double, 3> point_1, point_2;
+                        bounded[i * triangles_2.size() + j] = TriangleDistance(triangles_1[i], triangles_2[j],
+                                                                               point_1, point_2, distance);
+                    }
+                }
+            },
+            5);
+
+        double max_difference = 0.0;
+        for (size_t pair = 0; pair != num_pairs; ++pair)
+        {
+            max_difference = std::max(max_difference, std::abs(scalar[pair] - batched[pair]));
+        }
+
+        std::cout << "Triangle pairs: "s << num_pairs << ", closest distance "s << distance << std::endl;
+        std::cout << "Scalar: "s << scalar_time << " seconds ("s << static_cast<double>(num_pairs) / scalar_time / 1e6
+                  << " M pairs/s)"s << std::endl;
+        std::cout << "Batch of "s << kTriangleBatchWidth << ": "s << batch_time << " seconds ("s
+                  << static_cast<double>(num_pairs) / batch_time / 1e6 << " M pairs/s), speedup "s
+                  << scalar_time / batch_time << ", max difference "s << max_difference << std::endl;
+        std::cout << "With bound "s << distance << ": scalar "s << scalar_bounded_time << " seconds, batch "s
+                  << bounded_time << " seconds"s << std::endl;
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && argv[1] == "threads"s)
+    {
+        return RunQueryThreads(argc > 2 ? argv[2] : "../data/fan1.stl"s, argc > 3 ? argv[3] : "../data/fan2.stl"s);
+    }
+    if (argc > 1 && argv[1] == "refit"s)
+    {
+        return RunRefit(argc > 2 ? argv[2] : "../data/fan1.stl"s, argc > 3 ? argv[3] : "../data/fan2.stl"s);
+    }
+    if (argc > 1 && argv[1] == "narrow"s)
+    {
+        return RunNarrowPhase(argc > 2 ? argv[2] : "../data/fan1.stl"s, argc > 3 ? argv[3] : "../data/fan2.stl"s);
+    }
+    if (argc > 1 && argv[1] == "scaling"s)
+    {
+        const std::string filename = argc > 2 ? argv[2] : "../data/Cil_Tube_Cil_5.stl"s;
+        return RunScaling(filename, argc > 3 ? std::stoul(argv[3]) : 64);
+    }
+
+    const std::string filename_1 = argc > 1 ? argv[1] : "../data/Cil_Tube_Cil_3.stl"s;
+    const std::string filename_2 = argc > 2 ? argv[2] : "../data/Cil_Tube_Cil_5.stl"s;
+
+    const auto mesh_1 = std::make_shared<const Mesh>(ReadMesh(filename_1));
+    const auto mesh_2 = std::make_shared<const Mesh>(ReadMesh(filename_2));
+
+    std::cout << "Files: "s << filename_1 << ", "s << filename_2 << std::endl;
+    std::cout << "Triangles: "s << mesh_1->TriangleCount() << ", "s << mesh_2->TriangleCount() << std::endl;
+
+    const std::vector<std::pair<std::string, BuildMethod>> methods = {{"median"s, BuildMethod::Median},
+                                                                      {"sah"s, BuildMethod::SAH},
+                                                                      {"lbvh"s, BuildMethod::LBVH}};
+    for (const auto &[name, method] : methods)
+    {
+        for (const size_t leaf_size : {size_t{1}, size_t{4}, AABBTree::kMaxLeafSize})
+        {
+            std::cout << "\nMethod: "s << name << ", leaf size: "s << leaf_size << std::endl;
+            RunQuery(mesh_1, mesh_2, {.method = method, .max_leaf_size = leaf_size});
+        }
+    }
+
+    // Широкие деревья над двоичными деревьями по умолчанию
+    const AABBTree tree_1(mesh_1);
+    const AABBTree tree_2(mesh_2);
+    RunWideQuery<4>(tree_1, tree_2);
+    RunWideQuery<8>(tree_1, tree_2);
+    RunOBBQuery(tree_1, tree_2, BoundingVolume::AABB, BoundingVolume::AABB);
+    RunOBBQuery(tree_1, tree_2, BoundingVolume::OBB, BoundingVolume::OBB);
+    RunOBBQuery(tree_1, tree_2, BoundingVolume::OBB, BoundingVolume::AABB);
+    RunQuantizedQuery<uint8_t>(tree_1, tree_2);
+    RunQuantizedQuery<uint16_t>(tree_1, tree_2);
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "BenchUtils.hpp"
+
+#include "AABBTree.hpp"
+#include "ConvexBody.hpp"
+#include "Distance.hpp"
+#include "GJK.hpp"
+#include "MathOperations.hpp"
+#include "ReadSTL.hpp"
+#include "Triangle.hpp"
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace math;
+using namespace dist;
+using namespace read_stl;
+using namespace std::literals;
+
+// Использование:
+//   benchGJK [pairs] - время запроса GJK (нс) и число итераций на случайных парах треугольников
+//                      (по умолчанию 10000) без начального симплекса, затем на серии малых сдвигов
+//                      одной пары с симплексом прошлого запроса и без него; для сравнения -
+//                      время замкнутой формулы TriangleDistance
+//   benchGJK hull <file_1.stl> <file_2.stl> - выпуклые оболочки вершин двух тел: время построения,
+//                      время запроса GJK по оболочкам без начального симплекса и с симплексом
+//                      прошлого запроса, вершины, просмотренные опорными функциями, против числа
+//                      вершин оболочек; для сравнения - нижняя оценка Distance::ConvexLowerBound
+//                      и точное расстояние по деревьям
+namespace
+{
+    Triangle MakeTriangle(const TrianglePoints &points)
+    {
+        return Triangle(0, Vector{}, std::array<Vector, 3>{Vector(points[0]), Vector(points[1]), Vector(points[2])});
+    }
+
+    TrianglePoints RandomTriangle(std::mt19937 &generator, const double shift)
+    {
+        std::uniform_real_distribution<double> coord(-1.0, 1.0);
+        TrianglePoints points;
+        for (std::array<double, 3> &point : points)
+        {
+            point = {coord(generator) + shift, coord(generator), coord(generator)};
+        }
+        return points;
+    }
+
+    void PrintRow(const std::string &name, const double time, const size_t queries, const GJKStats *stats)
+    {
+        std::cout << name << ": "s << time / static_cast<double>(queries) * 1e9 << " ns/query"s;
+        if (stats)
+        {
+            std::cout << ", "s << static_cast<double>(stats->iterations) / static_cast<double>(stats->queries)
+                      << " iterations/query"s;
+        }
+        std::cout << std::endl;
+    }
+
+    int RunHull(const std::string &filename_1, const std::string &filename_2)
+    {
+        const auto mesh_1 = std::make_shared<const Mesh>(ReadMesh(filename_1));
+        const auto mesh_2 = std::make_shared<const Mesh>(ReadMesh(filename_2));
+        std::cout << "Files: "s << filename_1 << ", "s << filename_2 << std::endl;
+        std::cout << "Vertices: "s << mesh_1->VertexCount() << ", "s << mesh_2->VertexCount() << std::endl;
+
+        std::unique_ptr<ConvexBody> hull_1, hull_2;
+        const double build_time = bench::BestTime(
+            [&]
+            {
+                hull_1 = std::make_unique<ConvexBody>(*mesh_1);
+                hull_2 = std::make_unique<ConvexBody>(*mesh_2);
+            },
+            3);
+        std::cout << "Hull build: "s << build_time * 1e3 << " ms, vertices "s << hull_1->VertexCount() << ", "s
+                  << hull_2->VertexCount() << ", faces "s << hull_1->FaceCount() << ", "s << hull_2->FaceCount()
+                  << std::endl;
+
+        constexpr size_t kQueries = 1000;
+        double sum = 0.0;
+        GJKStats cold, warm;
+        const double cold_time = bench::BestTime(
+            [&]
+            {
+                cold = {};
+                for (size_t i = 0; i != kQueries; ++i)
+                {
+                    GJKSimplex simplex;
+                    sum += GJK::Distance(*hull_1, *hull_2, simplex, std::numeric_limits<double>::infinity(), &cold);
+                }
+            },
+            5);
+        GJKSimplex simplex;
+        const double warm_time = bench::BestTime(
+            [&]
+            {
+                warm = {};
+                for (size_t i = 0; i != kQueries; ++i)
+                {
+                    sum += GJK::Distance(*hull_1, *hull_2, simplex, std::numeric_limits<double>::infinity(), &warm);
+                }
+            },
+            5);
+        const auto print = [](const std::string &name, const double time, const GJKStats &stats)
+        {
+            std::cout << name << ": "s << time / static_cast<double>(stats.queries) * 1e6 << " us/query, "s
+                      << static_cast<double>(stats.iterations) / static_cast<double>(stats.queries)
+                      << " iterations/query, "s
+                      << static_cast<double>(stats.support_steps) / static_cast<double>(stats.queries)
+                      << " support vertices/query"s << std::endl;
+        };
+        std::cout << "Hull distance: "s << GJK::Distance(*hull_1, *hull_2) << std::endl;
+        print("GJK, cold start"s, cold_time, cold);
+        print("GJK, warm start"s, warm_time, warm);
+
+        Distance distance(mesh_1, mesh_2);
+        double lower = 0.0, exact = 0.0;
+        distance.ConvexLowerBound();
+        distance.FindDistanceBetweenBody();
+        const double lower_time = bench::BestTime([&] { lower = distance.ConvexLowerBound(); }, 5);
+        const double exact_time = bench::BestTime([&] { exact = distance.FindDistanceBetweenBody(); }, 5);
+        std::cout << "ConvexLowerBound: "s << lower << ", "s << lower_time * 1e6 << " us"s << std::endl;
+        std::cout << "Exact distance: "s << exact << ", "s << exact_time * 1e6 << " us"s << std::endl;
+
+        std::cout << "\nChecksum: "s << sum << std::endl;
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && argv[1] == "hull"s)
+    {
+        return RunHull(argc > 2 ? argv[2] : "../data/fan1.stl"s, argc > 3 ? argv[3] : "../data/fan2.stl"s);
+    }
+
+    const size_t num_pairs = argc > 1 ? std::stoul(argv[1]) : 10000;
+    std::mt19937 generator(1);
+
+    // Независимые случайные пары на расстояниях от пересечения до двух размеров треугольника
+    std::vector<TrianglePoints> points_a, points_b;
+    std::vector<Triangle> triangles_a, triangles_b;
+    for (size_t i = 0; i != num_pairs; ++i)
+    {
+        points_a.push_back(RandomTriangle(generator, 0.0));
+        points_b.push_back(RandomTriangle(generator, 0.5 * static_cast<double>(i % 8)));
+        triangles_a.push_back(MakeTriangle(points_a.back()));
+        triangles_b.push_back(MakeTriangle(points_b.back()));
+    }
+
+    double sum = 0.0;
+    GJKStats cold;
+    const double cold_time = bench::BestTime(
+        [&]
+        {
+            cold = {};
+            for (size_t i = 0; i != num_pairs; ++i)
+            {
+                GJKSimplex simplex;
+                sum += GJK::Distance(triangles_a[i], triangles_b[i], simplex, std::numeric_limits<double>::infinity(),
+                                     &cold);
+            }
+        },
+        5);
+    const double closed_time = bench::BestTime(
+        [&]
+        {
+            for (size_t i = 0; i != num_pairs; ++i)
+            {
+                std::array<double, 3> closest_a, closest_b;
+                sum += TriangleDistance(points_a[i], points_b[i], closest_a, closest_b);
+            }
+        },
+        5);
+    std::cout << "Random pairs: "s << num_pairs << std::endl;
+    PrintRow("GJK"s, cold_time, num_pairs, &cold);
+    PrintRow("TriangleDistance"s, closed_time, num_pairs, nullptr);
+
+    // Одна пара, второй треугольник которой понемногу поворачивается вокруг своего центра
+    std::vector<Triangle> moving;
+    const TrianglePoints start = RandomTriangle(generator, 3.0);
+    for (size_t step = 0; step != num_pairs; ++step)
+    {
+        const double angle = 1e-3 * static_cast<double>(step);
+        const double c = std::cos(angle), s = std::sin(angle);
+        TrianglePoints points = start;
+        for (std::array<double, 3> &point : points)
+        {
+            const double x = point[0] - 3.0, y = point[1];
+            point = {3.0 + c * x - s * y, s * x + c * y, point[2]};
+        }
+        moving.push_back(MakeTriangle(points));
+    }
+    const Triangle fixed = triangles_a[0];
+
+    GJKStats warm, restarted;
+    const double warm_time = bench::BestTime(
+        [&]
+        {
+            warm = {};
+            GJKSimplex simplex;
+            for (const Triangle &triangle : moving)
+            {
+                sum += GJK::Distance(fixed, triangle, simplex, std::numeric_limits<double>::infinity(), &warm);
+            }
+        },
+        5);
+    const double restarted_time = bench::BestTime(
+        [&]
+        {
+            restarted = {};
+            for (const Triangle &triangle : moving)
+            {
+                GJKSimplex simplex;
+                sum += GJK::Distance(fixed, triangle, simplex, std::numeric_limits<double>::infinity(), &restarted);
+            }
+        },
+        5);
+    std::cout << "\nCoherent queries: "s << num_pairs << std::endl;
+    PrintRow("GJK, warm start"s, warm_time, num_pairs, &warm);
+    PrintRow("GJK, cold start"s, restarted_time, num_pairs, &restarted);
+
+    // Сумма выводится, чтобы запросы не были выброшены компилятором
+    std::cout << "\nChecksum: "s << sum << std::endl;
+    return 0;
+}
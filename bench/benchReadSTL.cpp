@@ -0,0 +1,117 @@
+#include "BenchUtils.hpp"
+
+#include "ReadSTL.hpp"
+#include "Triangle.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace math;
+using namespace read_stl;
+using namespace std::literals;
+
+namespace
+{
+    // Запись треугольников в бинарный STL (для сравнения путей чтения на одном файле)
+    void WriteBinarySTL(const std::string &filename, const std::vector<Triangle> &triangles)
+    {
+        std::ofstream out(filename, std::ios::binary);
+
+        char header[80] = "STL-Distance benchmark";
+        out.write(header, 80);
+
+        const uint32_t num_triangles = static_cast<uint32_t>(triangles.size());
+        out.write(reinterpret_cast<const char *>(&num_triangles), 4);
+
+        for (const Triangle &triangle : triangles)
+        {
+            float record[12];
+            const Vector norm = triangle.GetNorm();
+            for (size_t j = 0; j != 3; ++j)
+            {
+                record[j] = static_cast<float>(norm[j]);
+                for (size_t i = 0; i != 3; ++i)
+                {
+                    record[3 * (i + 1) + j] = static_cast<float>(triangle.GetPoint(i)[j]);
+                }
+            }
+            const uint16_t attribute = 0;
+            out.write(reinterpret_cast<const char *>(record), sizeof(record));
+            out.write(reinterpret_cast<const char *>(&attribute), 2);
+        }
+    }
+} // namespace
+
+// Использование:
+//   benchReadSTL <file.stl> convert           - записать бинарную копию <file>.bin.stl
+//   benchReadSTL <file.stl> <native|stl_reader> [threads] - замерить чтение файла
+//   benchReadSTL <file.stl> <mesh|mesh_float> [threads]   - чтение в сетку (double/float) и её размер
+// Пиковая память процесса имеет смысл только при одном режиме на запуск,
+// поэтому режимы сравниваются отдельными запусками.
+int main(int argc, char **argv)
+{
+    const std::string filename = argc > 1 ? argv[1] : "../data/Cil_Tube_Cil_3.stl"s;
+    const std::string mode = argc > 2 ? argv[2] : "native"s;
+    const size_t num_threads = argc > 3 ? std::stoul(argv[3]) : 0;
+
+    if (mode == "convert"s)
+    {
+        const std::string binary_file = std::filesystem::path(filename).filename().string() + ".bin.stl"s;
+        WriteBinarySTL(binary_file, GetTrianglesStlReader(filename));
+        std::cout << "Written: "s << binary_file << std::endl;
+        return 0;
+    }
+
+    const size_t rss_before = bench::PeakRSSKb();
+    size_t num_tris = 0;
+    size_t mesh_bytes = 0;
+    double time = 0.0;
+
+    if (mode == "native"s)
+    {
+        time = bench::BestTime([&]
+                               {
+                                   num_tris = GetTriangles(filename, {.num_threads = num_threads}).size();
+                               },
+                               5);
+    }
+    else if (mode == "mesh"s || mode == "mesh_float"s)
+    {
+        const ReadOptions options{.num_threads = num_threads, .single_precision = mode == "mesh_float"s};
+        time = bench::BestTime([&]
+                               {
+                                   const Mesh mesh = ReadMesh(filename, options);
+                                   num_tris = mesh.TriangleCount();
+                                   mesh_bytes = mesh.MemoryBytes();
+                               },
+                               5);
+    }
+    else if (mode == "stl_reader"s)
+    {
+        time = bench::BestTime([&]
+                               { num_tris = GetTrianglesStlReader(filename).size(); }, 5);
+    }
+    else
+    {
+        std::cerr << "Unknown mode: "s << mode << std::endl;
+        return 1;
+    }
+
+    std::cout << "File: "s << filename << std::endl;
+    std::cout << "Mode: "s << mode << std::endl;
+    std::cout << "Threads: "s << (num_threads == 0 ? "all"s : std::to_string(num_threads)) << std::endl;
+    std::cout << "Triangles: "s << num_tris << std::endl;
+    std::cout << "Load time: "s << time << " seconds"s << std::endl;
+    if (mesh_bytes != 0)
+    {
+        std::cout << "Mesh size: "s << mesh_bytes / 1024 << " KB"s << std::endl;
+    }
+    std::cout << "Peak RSS: "s << bench::PeakRSSKb() << " KB (before load "s << rss_before << " KB)"s << std::endl;
+
+    return 0;
+}
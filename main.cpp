@@ -3,7 +3,10 @@
 #include "Vector.hpp"
 #include "ReadSTL.hpp"
 #include "Distance.hpp"
+#include "MeshCache.hpp"
+#include "Parallel.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <fstream>
@@ -31,16 +34,27 @@ int main()
     // std::cout << "Input second file name - ";
     // std::getline(std::cin, file_2);
 
+    // Разобранные тела и деревья хранятся в кэше, повторный запуск их не пересобирает
+    MeshCache cache("stl_cache"s);
+
+    // Тела загружаются одновременно: дерево одного строится, пока разбирается другое.
+    // Каждое тело получает половину ядер, чтобы вместе они не занимали потоков больше ядер
     const auto start_read = steady_clock::now();
-    std::vector<Triangle> triangles_1 = GetTriangles(body_1);
-    std::vector<Triangle> triangles_2 = GetTriangles(body_2);
+    CachedBody cached_1, cached_2;
+    const ReadOptions read_options{.num_threads = std::max<size_t>(parallel::DefaultThreadCount() / 2, 1)};
+    parallel::ParallelFor(
+        2, [&](const size_t body)
+        { (body == 0 ? cached_1 : cached_2) = cache.Load(body == 0 ? body_1 : body_2, read_options); },
+        2);
     const auto end_read = steady_clock::now();
     const auto read_time = duration<double>(end_read - start_read);
-    std::cout << "Elemements in 1 body "s << body_1 << ": "s << triangles_1.size() << std::endl;
-    std::cout << "Elemements in 2 body "s << body_2 << ": "s << triangles_2.size() << std::endl;
+    std::cout << "Elemements in 1 body "s << body_1 << ": "s << cached_1.mesh->TriangleCount()
+              << (cached_1.from_cache ? " (cache)"s : ""s) << std::endl;
+    std::cout << "Elemements in 2 body "s << body_2 << ": "s << cached_2.mesh->TriangleCount()
+              << (cached_2.from_cache ? " (cache)"s : ""s) << std::endl;
     std::cout << "Read time: "s << read_time.count() << " seconds" << std::endl;
 
-    Distance container(triangles_1, triangles_2);
+    Distance container(cached_1.mesh, cached_2.mesh);
 
     const auto start_calculate = steady_clock::now();
     // AABBTree tree_1(triangles_1);
@@ -48,7 +62,7 @@ int main()
     // double distance = 0.0;
     // const Triangle *tr_1 = nullptr, *tr_2 = nullptr;
     // tree_1.FindClosestTriangles(tree_2, tr_1, tr_2, distance);
-    const double distance = container.FindDistanceBetweenBody();
+    const double distance = container.FindDistanceBetweenBody(*cached_1.tree, *cached_2.tree);
     const auto end_calculate = steady_clock::now();
     const auto calculate_time = duration<double>(end_calculate - start_calculate);
     std::cout << "Calculate time: "s << calculate_time.count() << " seconds"s << std::endl;
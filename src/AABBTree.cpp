@@ -1,183 +1,1575 @@
 #include "AABBTree.hpp"
 #include "MathOperations.hpp"
+#include "Parallel.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <functional>
 #include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 
 namespace math
 {
-    AABBTree::AABBTree(const std::vector<Triangle> &triangles)
+    using namespace std::string_literals;
+
+    namespace
+    {
+        // Округление до float в сторону -inf и +inf
+        float RoundDown(const double value)
+        {
+            float result = static_cast<float>(value);
+            if (static_cast<double>(result) > value)
+            {
+                result = std::nextafter(result, -std::numeric_limits<float>::infinity());
+            }
+            return result;
+        }
+
+        float RoundUp(const double value)
+        {
+            float result = static_cast<float>(value);
+            if (static_cast<double>(result) < value)
+            {
+                result = std::nextafter(result, std::numeric_limits<float>::infinity());
+            }
+            return result;
+        }
+
+        // Половина площади поверхности бокса
+        double HalfArea(const std::array<double, 3> &min_bounds, const std::array<double, 3> &max_bounds)
+        {
+            const double dx = max_bounds[0] - min_bounds[0];
+            const double dy = max_bounds[1] - min_bounds[1];
+            const double dz = max_bounds[2] - min_bounds[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+
+        void Extend(std::array<double, 3> &min_bounds, std::array<double, 3> &max_bounds,
+                    const std::array<double, 3> &other_min, const std::array<double, 3> &other_max)
+        {
+            for (size_t i = 0; i != 3; ++i)
+            {
+                min_bounds[i] = std::min(min_bounds[i], other_min[i]);
+                max_bounds[i] = std::max(max_bounds[i], other_max[i]);
+            }
+        }
+
+        // Биты 10-битного числа, разнесённые через два
+        uint32_t ExpandBits(uint32_t value)
+        {
+            value = (value * 0x00010001u) & 0xFF0000FFu;
+            value = (value * 0x00000101u) & 0x0F00F00Fu;
+            value = (value * 0x00000011u) & 0xC30C30C3u;
+            value = (value * 0x00000005u) & 0x49249249u;
+            return value;
+        }
+
+        struct ChildPair
+        {
+            double distance;
+            uint32_t node1;
+            uint32_t node2;
+        };
+
+        constexpr std::array<double, 3> kEmptyMin = {std::numeric_limits<double>::max(),
+                                                     std::numeric_limits<double>::max(),
+                                                     std::numeric_limits<double>::max()};
+        constexpr std::array<double, 3> kEmptyMax = {std::numeric_limits<double>::lowest(),
+                                                     std::numeric_limits<double>::lowest(),
+                                                     std::numeric_limits<double>::lowest()};
+
+        // Атомарное уменьшение значения до value
+        void StoreMin(std::atomic<double> &target, const double value)
+        {
+            double current = target.load(std::memory_order_relaxed);
+            while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+    } // namespace
+
+    /**
+     * Данные треугольников, посчитанные один раз перед построением
+     */
+    struct AABBTree::BuildData
+    {
+        BuildMethod method;
+        size_t max_leaf_size;
+        size_t num_threads;
+        std::vector<std::array<double, 3>> centroids;
+        std::vector<std::array<double, 3>> min_bounds;
+        std::vector<std::array<double, 3>> max_bounds;
+        std::vector<uint32_t> morton_codes; // Для LBVH: коды в порядке primitives_
+    };
+
+    AABBTree::AABBTree(const std::vector<Triangle> &triangles, const AABBTreeOptions &options)
+        : AABBTree(std::make_shared<const Mesh>(Mesh::FromTriangles(triangles)), options) {}
+
+    AABBTree::AABBTree(std::shared_ptr<const Mesh> mesh, const AABBTreeOptions &options) : mesh_(std::move(mesh))
+    {
+        const size_t num_triangles = mesh_->TriangleCount();
+        if (num_triangles == 0)
+        {
+            return;
+        }
+
+        if (options.max_leaf_size == 0 || options.max_leaf_size > kMaxLeafSize)
+        {
+            throw std::invalid_argument("Leaf size must be between 1 and "s + std::to_string(kMaxLeafSize));
+        }
+
+        BuildData data;
+        data.method = options.method;
+        data.max_leaf_size = options.max_leaf_size;
+        if (data.method == BuildMethod::Auto)
+        {
+            data.method = num_triangles >= kSahMinTriangles ? BuildMethod::SAH : BuildMethod::Median;
+        }
+
+        // Потоки окупаются только на крупных сетках
+        data.num_threads = num_triangles >= kParallelBuildMin ? parallel::ResolveThreadCount(options.num_threads) : 1;
+
+        primitives_.resize(num_triangles);
+        std::iota(primitives_.begin(), primitives_.end(), 0u);
+        ComputeBuildData(data);
+
+        if (data.method == BuildMethod::LBVH)
+        {
+            data.morton_codes.resize(num_triangles);
+            SortMorton(data, 0, num_triangles);
+        }
+
+        if (data.num_threads == 1)
+        {
+            // Узлов не больше 2n - 1, лишняя память освобождается после построения
+            nodes_.reserve(2 * num_triangles - 1);
+            BuildTree(data, nodes_, 0, num_triangles);
+            nodes_.shrink_to_fit();
+        }
+        else
+        {
+            BuildParallel(data);
+        }
+
+        PackLeaves();
+        ComputeDepth();
+    }
+
+    AABBTree::AABBTree(std::shared_ptr<const Mesh> mesh,
+                       const AABBTreeNode *nodes, size_t num_nodes,
+                       const uint32_t *primitives, size_t num_primitives)
+        : mesh_(std::move(mesh)),
+          nodes_(nodes, nodes + num_nodes),
+          primitives_(primitives, primitives + num_primitives)
+    {
+        for (const uint32_t triangle : primitives_)
+        {
+            if (triangle >= mesh_->TriangleCount())
+            {
+                throw std::invalid_argument("Corrupted AABB tree: bad triangle index"s);
+            }
+        }
+
+        // Потомки всегда имеют большие номера, чем родитель, поэтому обход конечен
+        for (size_t i = 0; i != nodes_.size(); ++i)
+        {
+            const AABBTreeNode &node = nodes_[i];
+            if (node.IsLeaf())
+            {
+                if (node.count > kMaxLeafSize)
+                {
+                    throw std::invalid_argument("Corrupted AABB tree: leaf too large"s);
+                }
+                if (static_cast<size_t>(node.offset) + node.count > primitives_.size())
+                {
+                    throw std::invalid_argument("Corrupted AABB tree: leaf range out of range"s);
+                }
+            }
+            else if (i + 1 >= nodes_.size() || node.offset <= i + 1 || node.offset >= nodes_.size())
+            {
+                throw std::invalid_argument("Corrupted AABB tree: bad child index"s);
+            }
+        }
+
+        PackLeaves();
+        ComputeDepth();
+    }
+
+    const Mesh &AABBTree::GetMesh() const { return *mesh_; }
+
+    const std::vector<AABBTreeNode> &AABBTree::Nodes() const { return nodes_; }
+
+    const std::vector<uint32_t> &AABBTree::Primitives() const { return primitives_; }
+
+    size_t AABBTree::MemoryBytes() const
+    {
+        return nodes_.capacity() * sizeof(AABBTreeNode) + primitives_.capacity() * sizeof(uint32_t) +
+               leaf_coords_.capacity() * sizeof(double);
+    }
+
+    void AABBTree::ComputeBuildData(BuildData &data) const
+    {
+        const size_t num_triangles = mesh_->TriangleCount();
+        data.centroids.resize(num_triangles);
+        data.min_bounds.resize(num_triangles);
+        data.max_bounds.resize(num_triangles);
+        parallel::ParallelForRange(
+            num_triangles, data.num_threads,
+            [&](const size_t begin, const size_t end, size_t)
+            {
+                for (size_t i = begin; i != end; ++i)
+                {
+                    mesh_->TriangleBounds(i, data.min_bounds[i], data.max_bounds[i]);
+                    const Vector centroid = mesh_->GetMidlePoint(i);
+                    data.centroids[i] = {centroid[0], centroid[1], centroid[2]};
+                }
+            },
+            data.num_threads);
+    }
+
+    void AABBTree::PackLeaves(const size_t num_threads)
+    {
+        // Листья пишут в непересекающиеся участки, поэтому обрабатываются независимо
+        leaf_coords_.assign(9 * primitives_.size(), 0.0);
+        parallel::ParallelForRange(
+            nodes_.size(), num_threads,
+            [&](const size_t begin, const size_t end, size_t)
+            {
+                for (size_t index = begin; index != end; ++index)
+                {
+                    const AABBTreeNode &node = nodes_[index];
+                    if (!node.IsLeaf())
+                    {
+                        continue;
+                    }
+                    PackLeaf(*mesh_, primitives_.data() + node.offset, node.count,
+                             leaf_coords_.data() + 9 * static_cast<size_t>(node.offset));
+                }
+            },
+            num_threads);
+    }
+
+    void AABBTree::PackLeaf(const Mesh &mesh, const uint32_t *primitives, const size_t count, double *coords)
+    {
+        for (size_t lane = 0; lane != count; ++lane)
+        {
+            for (size_t corner = 0; corner != 3; ++corner)
+            {
+                const uint32_t vertex = mesh.Index(primitives[lane], corner);
+                for (size_t axis = 0; axis != 3; ++axis)
+                {
+                    coords[(3 * corner + axis) * count + lane] = mesh.Coord(vertex, axis);
+                }
+            }
+        }
+    }
+
+    void AABBTree::ComputeDepth()
+    {
+        // Потомки идут после родителя, поэтому глубины известны к моменту их обработки
+        std::vector<uint32_t> depths(nodes_.size(), 0);
+        depth_ = 0;
+        for (size_t index = 0; index != nodes_.size(); ++index)
+        {
+            const AABBTreeNode &node = nodes_[index];
+            if (node.IsLeaf())
+            {
+                depth_ = std::max(depth_, depths[index]);
+                continue;
+            }
+            depths[index + 1] = depths[index] + 1;
+            depths[node.offset] = depths[index] + 1;
+        }
+    }
+
+    size_t AABBTree::Refit(std::shared_ptr<const Mesh> mesh, const AABBTreeRefitOptions &options)
+    {
+        if (mesh->TriangleCount() != mesh_->TriangleCount())
+        {
+            throw std::invalid_argument("Refit requires the same triangles: "s + std::to_string(mesh->TriangleCount()) +
+                                        " instead of "s + std::to_string(mesh_->TriangleCount()));
+        }
+        mesh_ = std::move(mesh);
+        if (nodes_.empty())
+        {
+            return 0;
+        }
+
+        const size_t num_triangles = primitives_.size();
+        const size_t num_threads =
+            num_triangles >= kParallelBuildMin ? parallel::ResolveThreadCount(options.build.num_threads) : 1;
+        RefitBounds(num_threads);
+
+        std::vector<uint32_t> roots;
+        if (options.rebuild_overlap < 1.0)
+        {
+            FindDegraded(0, options.rebuild_overlap, roots);
+        }
+        if (roots.empty())
+        {
+            PackLeaves(num_threads);
+            return 0;
+        }
+
+        if (options.build.max_leaf_size == 0 || options.build.max_leaf_size > kMaxLeafSize)
+        {
+            throw std::invalid_argument("Leaf size must be between 1 and "s + std::to_string(kMaxLeafSize));
+        }
+        BuildData data;
+        data.method = options.build.method;
+        data.max_leaf_size = options.build.max_leaf_size;
+        data.num_threads = num_threads;
+        if (data.method == BuildMethod::Auto)
+        {
+            data.method = num_triangles >= kSahMinTriangles ? BuildMethod::SAH : BuildMethod::Median;
+        }
+        ComputeBuildData(data);
+        if (data.method == BuildMethod::LBVH)
+        {
+            data.morton_codes.resize(num_triangles);
+        }
+
+        // Поддеревья строятся заново одновременно, каждое в одном потоке: они читают
+        // общие данные треугольников и переставляют непересекающиеся участки primitives_
+        data.num_threads = 1;
+        std::vector<std::vector<AABBTreeNode>> rebuilt(roots.size());
+        parallel::ParallelFor(
+            roots.size(),
+            [&](const size_t task)
+            {
+                const auto [start, end] = PrimitiveRange(roots[task]);
+                if (data.method == BuildMethod::LBVH)
+                {
+                    SortMorton(data, start, end);
+                }
+                rebuilt[task].reserve(2 * (end - start) - 1);
+                BuildTree(data, rebuilt[task], start, end);
+            },
+            num_threads);
+
+        // Сборка нового массива в порядке обхода в глубину: узлы выше перестроенных
+        // поддеревьев копируются (их границы не меняются), поддеревья вставляются целиком
+        std::vector<AABBTreeNode> nodes;
+        nodes.reserve(nodes_.size());
+        size_t next_root = 0;
+        const auto emit = [&](const auto &self, const uint32_t old_index) -> void
+        {
+            const uint32_t index = static_cast<uint32_t>(nodes.size());
+            if (next_root != roots.size() && roots[next_root] == old_index)
+            {
+                for (AABBTreeNode node : rebuilt[next_root])
+                {
+                    if (!node.IsLeaf())
+                    {
+                        node.offset += index;
+                    }
+                    nodes.push_back(node);
+                }
+                rebuilt[next_root++] = {};
+                return;
+            }
+
+            nodes.push_back(nodes_[old_index]);
+            if (nodes_[old_index].IsLeaf())
+            {
+                return;
+            }
+            self(self, old_index + 1);
+            nodes[index].offset = static_cast<uint32_t>(nodes.size());
+            self(self, nodes_[old_index].offset);
+        };
+        emit(emit, 0);
+        nodes_.swap(nodes);
+        nodes_.shrink_to_fit();
+
+        PackLeaves(num_threads);
+        ComputeDepth();
+        return roots.size();
+    }
+
+    void AABBTree::RefitBounds(const size_t num_threads)
+    {
+        // Узлы поддерева лежат подряд, потомки - после родителя, поэтому обратный проход
+        // по участку пересчитывает поддерево снизу вверх
+        const auto refit_range = [this](const uint32_t begin, const uint32_t end)
+        {
+            for (uint32_t index = end; index-- != begin;)
+            {
+                AABBTreeNode &node = nodes_[index];
+                if (!node.IsLeaf())
+                {
+                    SetInterior(nodes_, index, node.offset);
+                    continue;
+                }
+                std::array<double, 3> min_bounds = kEmptyMin, max_bounds = kEmptyMax;
+                for (uint32_t i = node.offset; i != node.offset + node.count; ++i)
+                {
+                    std::array<double, 3> triangle_min{}, triangle_max{};
+                    mesh_->TriangleBounds(primitives_[i], triangle_min, triangle_max);
+                    Extend(min_bounds, max_bounds, triangle_min, triangle_max);
+                }
+                SetBounds(node, min_bounds, max_bounds);
+            }
+        };
+        if (num_threads == 1)
+        {
+            refit_range(0, static_cast<uint32_t>(nodes_.size()));
+            return;
+        }
+
+        // Верхние узлы делятся, как при параллельном построении: самое крупное поддерево
+        // заменяется потомками, пока задач не хватит для балансировки
+        std::vector<uint32_t> tasks = {0}, top;
+        const size_t max_tasks = kTasksPerThread * num_threads;
+        while (tasks.size() < max_tasks)
+        {
+            size_t largest = 0, largest_size = 0;
+            for (size_t i = 0; i != tasks.size(); ++i)
+            {
+                const size_t size = SubtreeEnd(tasks[i]) - tasks[i];
+                if (!nodes_[tasks[i]].IsLeaf() && size > largest_size)
+                {
+                    largest = i;
+                    largest_size = size;
+                }
+            }
+            if (largest_size < kParallelTaskMin)
+            {
+                break;
+            }
+            const uint32_t node = tasks[largest];
+            top.push_back(node);
+            tasks[largest] = node + 1;
+            tasks.push_back(nodes_[node].offset);
+        }
+
+        parallel::ParallelFor(
+            tasks.size(),
+            [&](const size_t task)
+            { refit_range(tasks[task], SubtreeEnd(tasks[task])); },
+            num_threads);
+
+        // Верхние узлы - от более глубоких к корню
+        std::sort(top.begin(), top.end(), std::greater<uint32_t>());
+        for (const uint32_t node : top)
+        {
+            SetInterior(nodes_, node, nodes_[node].offset);
+        }
+    }
+
+    uint32_t AABBTree::SubtreeEnd(uint32_t node) const
+    {
+        // Последний узел поддерева - самый правый лист
+        while (!nodes_[node].IsLeaf())
+        {
+            node = nodes_[node].offset;
+        }
+        return node + 1;
+    }
+
+    std::pair<size_t, size_t> AABBTree::PrimitiveRange(const uint32_t node) const
+    {
+        // Треугольники поддерева лежат подряд от самого левого листа до самого правого
+        uint32_t first = node, last = node;
+        while (!nodes_[first].IsLeaf())
+        {
+            ++first;
+        }
+        while (!nodes_[last].IsLeaf())
+        {
+            last = nodes_[last].offset;
+        }
+        return {nodes_[first].offset, static_cast<size_t>(nodes_[last].offset) + nodes_[last].count};
+    }
+
+    double AABBTree::ChildOverlap(const uint32_t node) const
     {
-        std::vector<Triangle> triangles_copy = triangles;
-        root_ = BuildTree(triangles_copy, 0, triangles_copy.size());
+        const AABBTreeNode &left = nodes_[node + 1];
+        const AABBTreeNode &right = nodes_[nodes_[node].offset];
+        std::array<double, 3> overlap_min{}, overlap_max{}, node_min{}, node_max{};
+        for (size_t i = 0; i != 3; ++i)
+        {
+            overlap_min[i] = std::max(left.min_bounds[i], right.min_bounds[i]);
+            overlap_max[i] = std::min(left.max_bounds[i], right.max_bounds[i]);
+            if (overlap_max[i] < overlap_min[i])
+            {
+                return 0.0;
+            }
+            node_min[i] = nodes_[node].min_bounds[i];
+            node_max[i] = nodes_[node].max_bounds[i];
+        }
+        const double area = HalfArea(node_min, node_max);
+        return area > 0.0 ? HalfArea(overlap_min, overlap_max) / area : 0.0;
     }
 
-    std::unique_ptr<AABBTreeNode> AABBTree::BuildTree(std::vector<Triangle> &triangles,
-                                                      size_t start, size_t end)
+    void AABBTree::FindDegraded(const uint32_t node, const double max_overlap, std::vector<uint32_t> &roots) const
     {
-        if (start >= end)
+        // Поддеревья находятся в порядке обхода в глубину; внутри найденного не ищутся.
+        // Мелкие поддеревья не проверяются: их боксы пересекаются и в свежем дереве,
+        // а перестроение почти ничего не даёт
+        if (nodes_[node].IsLeaf())
+        {
+            return;
+        }
+        const auto [start, end] = PrimitiveRange(node);
+        if (end - start < kSahMinRange)
         {
-            return nullptr;
+            return;
         }
+        if (ChildOverlap(node) > max_overlap)
+        {
+            roots.push_back(node);
+            return;
+        }
+        FindDegraded(node + 1, max_overlap, roots);
+        FindDegraded(nodes_[node].offset, max_overlap, roots);
+    }
 
-        auto node = std::make_unique<AABBTreeNode>();
+    uint32_t AABBTree::BuildTree(BuildData &data, std::vector<AABBTreeNode> &nodes, size_t start, size_t end)
+    {
+        const uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
 
         // Если это листовой узел
-        if (end - start == 1)
+        if (end - start <= data.max_leaf_size)
         {
-            node->triangle = triangles[start];
-            ComputeBounds(triangles[start], node->min_bounds, node->max_bounds);
-            return node;
+            std::array<double, 3> min_bounds = kEmptyMin, max_bounds = kEmptyMax;
+            for (size_t i = start; i != end; ++i)
+            {
+                Extend(min_bounds, max_bounds, data.min_bounds[primitives_[i]], data.max_bounds[primitives_[i]]);
+            }
+            SetBounds(nodes[index], min_bounds, max_bounds);
+            nodes[index].offset = static_cast<uint32_t>(start);
+            nodes[index].count = static_cast<uint32_t>(end - start);
+            return index;
         }
 
-        // Вычисляем общие границы для текущего набора треугольников
-        std::array<double, 3> min_bounds = {std::numeric_limits<double>::max(),
-                                            std::numeric_limits<double>::max(),
-                                            std::numeric_limits<double>::max()};
-        std::array<double, 3> max_bounds = {std::numeric_limits<double>::lowest(),
-                                            std::numeric_limits<double>::lowest(),
-                                            std::numeric_limits<double>::lowest()};
+        const size_t mid = Split(data, start, end, 1);
+
+        // Рекурсивно строим дочерние узлы, левый ложится сразу за родителем
+        BuildTree(data, nodes, start, mid);
+        const uint32_t right = BuildTree(data, nodes, mid, end);
+        SetInterior(nodes, index, right);
+
+        return index;
+    }
+
+    void AABBTree::SetInterior(std::vector<AABBTreeNode> &nodes, const uint32_t index, const uint32_t right)
+    {
+        // Границы узла - объединение границ потомков (округление наружу монотонно,
+        // поэтому результат тот же, что и при обходе всех треугольников)
+        AABBTreeNode &node = nodes[index];
+        const AABBTreeNode &left_node = nodes[index + 1];
+        const AABBTreeNode &right_node = nodes[right];
+        for (size_t i = 0; i != 3; ++i)
+        {
+            node.min_bounds[i] = std::min(left_node.min_bounds[i], right_node.min_bounds[i]);
+            node.max_bounds[i] = std::max(left_node.max_bounds[i], right_node.max_bounds[i]);
+        }
+        node.offset = right;
+        node.count = 0;
+    }
+
+    void AABBTree::BuildParallel(BuildData &data)
+    {
+        // Верхние уровни: узлы, разбитые до запуска задач, и поддеревья-задачи
+        struct TopNode
+        {
+            TopNode(const size_t start, const size_t end) : start(start), end(end) {}
+
+            size_t start;
+            size_t end;
+            bool split = false;
+            size_t left = 0;
+            size_t right = 0;
+            std::vector<AABBTreeNode> nodes; // Поддерево задачи (номера узлов от его корня)
+        };
+
+        std::vector<TopNode> top;
+        top.emplace_back(0, primitives_.size());
 
-        for (size_t i = start; i < end; ++i)
+        // Самый крупный диапазон разбивается, пока задач не станет достаточно для
+        // балансировки; разбиение крупных диапазонов само идёт в несколько потоков
+        const size_t max_tasks = kTasksPerThread * data.num_threads;
+        for (size_t num_tasks = 1; num_tasks < max_tasks; ++num_tasks)
         {
-            std::array<double, 3> tri_min, tri_max;
-            ComputeBounds(triangles[i], tri_min, tri_max);
+            size_t largest = 0, largest_size = 0;
+            for (size_t i = 0; i != top.size(); ++i)
+            {
+                if (!top[i].split && top[i].end - top[i].start > largest_size)
+                {
+                    largest = i;
+                    largest_size = top[i].end - top[i].start;
+                }
+            }
+            if (largest_size < std::max(kParallelTaskMin, data.max_leaf_size + 1))
+            {
+                break;
+            }
+
+            const size_t start = top[largest].start, end = top[largest].end;
+            const size_t mid = Split(data, start, end, data.num_threads);
+            top[largest].split = true;
+            top[largest].left = top.size();
+            top[largest].right = top.size() + 1;
+            top.emplace_back(start, mid);
+            top.emplace_back(mid, end);
+        }
 
-            for (size_t j = 0; j < 3; ++j)
+        // Поддеревья строятся одновременно, крупные - первыми
+        std::vector<size_t> tasks;
+        for (size_t i = 0; i != top.size(); ++i)
+        {
+            if (!top[i].split)
             {
-                min_bounds[j] = std::min(min_bounds[j], tri_min[j]);
-                max_bounds[j] = std::max(max_bounds[j], tri_max[j]);
+                tasks.push_back(i);
             }
         }
+        std::sort(tasks.begin(), tasks.end(),
+                  [&top](const size_t a, const size_t b)
+                  { return top[a].end - top[a].start > top[b].end - top[b].start; });
+        parallel::ParallelFor(
+            tasks.size(),
+            [&](const size_t task)
+            {
+                TopNode &node = top[tasks[task]];
+                node.nodes.reserve(2 * (node.end - node.start) - 1);
+                BuildTree(data, node.nodes, node.start, node.end);
+            },
+            data.num_threads);
 
-        node->min_bounds = min_bounds;
-        node->max_bounds = max_bounds;
+        // Сборка в один массив в том же порядке обхода в глубину, что и при
+        // построении в одном потоке
+        size_t num_nodes = 0;
+        for (const TopNode &node : top)
+        {
+            num_nodes += node.split ? 1 : node.nodes.size();
+        }
+        nodes_.reserve(num_nodes);
+        const auto emit = [&](const auto &self, const size_t top_index) -> void
+        {
+            TopNode &node = top[top_index];
+            const uint32_t index = static_cast<uint32_t>(nodes_.size());
+            if (!node.split)
+            {
+                for (AABBTreeNode subtree_node : node.nodes)
+                {
+                    if (!subtree_node.IsLeaf())
+                    {
+                        subtree_node.offset += index;
+                    }
+                    nodes_.push_back(subtree_node);
+                }
+                node.nodes = {};
+                return;
+            }
 
-        // Сортируем треугольники по средней точке вдоль одной из осей (например, X)
-        size_t axis = 1; // Можно выбрать ось с наибольшим размером
-        size_t mid = start + (end - start) / 2;
+            nodes_.emplace_back();
+            self(self, node.left);
+            const uint32_t right = static_cast<uint32_t>(nodes_.size());
+            self(self, node.right);
+            SetInterior(nodes_, index, right);
+        };
+        emit(emit, 0);
+    }
 
-        std::nth_element(triangles.begin() + start, triangles.begin() + mid, triangles.begin() + end,
-                         [axis](const Triangle &a, const Triangle &b)
-                         {
-                             return a.GetMidlePoint()[axis] < b.GetMidlePoint()[axis];
-                         });
+    size_t AABBTree::Split(BuildData &data, size_t start, size_t end, size_t num_threads)
+    {
+        switch (data.method)
+        {
+        case BuildMethod::SAH:
+            return SplitSAH(data, start, end, num_threads);
+        case BuildMethod::LBVH:
+            return SplitMorton(data, start, end);
+        default:
+            return SplitMedian(data, start, end);
+        }
+    }
 
-        // Рекурсивно строим дочерние узлы
-        node->left = BuildTree(triangles, start, mid);
-        node->right = BuildTree(triangles, mid, end);
+    size_t AABBTree::SplitMedian(BuildData &data, size_t start, size_t end)
+    {
+        // Сортируем треугольники по средней точке вдоль оси Y
+        const size_t axis = 1;
+        const size_t mid = start + (end - start) / 2;
 
-        return node;
+        const auto &centroids = data.centroids;
+        std::nth_element(primitives_.begin() + static_cast<std::ptrdiff_t>(start),
+                         primitives_.begin() + static_cast<std::ptrdiff_t>(mid),
+                         primitives_.begin() + static_cast<std::ptrdiff_t>(end),
+                         [axis, &centroids](const uint32_t a, const uint32_t b)
+                         { return centroids[a][axis] < centroids[b][axis]; });
+        return mid;
     }
 
-    void AABBTree::ComputeBounds(const Triangle &triangle,
-                                 std::array<double, 3> &min_bounds,
-                                 std::array<double, 3> &max_bounds)
+    size_t AABBTree::SplitSAH(BuildData &data, size_t start, size_t end, size_t num_threads)
     {
-        min_bounds = {std::numeric_limits<double>::max(),
-                      std::numeric_limits<double>::max(),
-                      std::numeric_limits<double>::max()};
-        max_bounds = {std::numeric_limits<double>::lowest(),
-                      std::numeric_limits<double>::lowest(),
-                      std::numeric_limits<double>::lowest()};
+        struct Bin
+        {
+            std::array<double, 3> min_bounds = kEmptyMin;
+            std::array<double, 3> max_bounds = kEmptyMax;
+            size_t count = 0;
+        };
+        using AxisBins = std::array<std::array<Bin, kSahBins>, 3>;
 
-        for (size_t i = 0; i < 3; ++i)
+        // Крупные диапазоны обрабатываются по частям в нескольких потоках. Части
+        // объединяются через min/max и сумму счётчиков, поэтому результат не
+        // зависит от числа потоков
+        const size_t count = end - start;
+        const size_t num_chunks = count >= kParallelSplitMin ? num_threads : 1;
+
+        const auto &centroids = data.centroids;
+        std::vector<std::array<double, 3>> chunk_min(num_chunks, kEmptyMin), chunk_max(num_chunks, kEmptyMax);
+        parallel::ParallelForRange(
+            count, num_chunks,
+            [&](const size_t begin, const size_t chunk_end, const size_t chunk)
+            {
+                for (size_t i = start + begin; i != start + chunk_end; ++i)
+                {
+                    Extend(chunk_min[chunk], chunk_max[chunk], centroids[primitives_[i]], centroids[primitives_[i]]);
+                }
+            },
+            num_threads);
+        std::array<double, 3> centroid_min = kEmptyMin, centroid_max = kEmptyMax;
+        for (size_t chunk = 0; chunk != num_chunks; ++chunk)
+        {
+            Extend(centroid_min, centroid_max, chunk_min[chunk], chunk_max[chunk]);
+        }
+
+        // Малые поддеревья делятся пополам вдоль самой длинной оси центроидов:
+        // корзины для них стоят дороже, чем дают
+        if (count < kSahMinRange)
+        {
+            size_t axis = 0;
+            for (size_t i = 1; i != 3; ++i)
+            {
+                if (centroid_max[i] - centroid_min[i] > centroid_max[axis] - centroid_min[axis])
+                {
+                    axis = i;
+                }
+            }
+            const size_t mid = start + count / 2;
+            std::nth_element(primitives_.begin() + static_cast<std::ptrdiff_t>(start),
+                             primitives_.begin() + static_cast<std::ptrdiff_t>(mid),
+                             primitives_.begin() + static_cast<std::ptrdiff_t>(end),
+                             [axis, &centroids](const uint32_t a, const uint32_t b)
+                             { return centroids[a][axis] < centroids[b][axis]; });
+            return mid;
+        }
+
+        std::array<double, 3> scale{};
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            const double extent = centroid_max[axis] - centroid_min[axis];
+            scale[axis] = extent > 0.0 ? static_cast<double>(kSahBins) / extent : 0.0;
+        }
+        const auto bin_of = [&](const uint32_t triangle, const size_t axis)
+        {
+            return std::min(kSahBins - 1,
+                            static_cast<size_t>((centroids[triangle][axis] - centroid_min[axis]) * scale[axis]));
+        };
+
+        std::vector<AxisBins> chunk_bins(num_chunks);
+        parallel::ParallelForRange(
+            count, num_chunks,
+            [&](const size_t begin, const size_t chunk_end, const size_t chunk)
+            {
+                AxisBins &bins = chunk_bins[chunk];
+                for (size_t i = start + begin; i != start + chunk_end; ++i)
+                {
+                    const uint32_t triangle = primitives_[i];
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        Bin &bin = bins[axis][bin_of(triangle, axis)];
+                        Extend(bin.min_bounds, bin.max_bounds, data.min_bounds[triangle], data.max_bounds[triangle]);
+                        ++bin.count;
+                    }
+                }
+            },
+            num_threads);
+        AxisBins bins = chunk_bins[0];
+        for (size_t chunk = 1; chunk != num_chunks; ++chunk)
+        {
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                for (size_t bin = 0; bin != kSahBins; ++bin)
+                {
+                    const Bin &other = chunk_bins[chunk][axis][bin];
+                    Extend(bins[axis][bin].min_bounds, bins[axis][bin].max_bounds, other.min_bounds, other.max_bounds);
+                    bins[axis][bin].count += other.count;
+                }
+            }
+        }
+
+        // Лучшее разбиение: стоимость - сумма площадей потомков, взвешенных числом треугольников
+        double best_cost = std::numeric_limits<double>::max();
+        size_t best_axis = 0, best_bin = 0;
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            if (scale[axis] == 0.0)
+            {
+                continue;
+            }
+
+            // Площади правых частей при проходе справа налево
+            std::array<double, kSahBins> right_area{};
+            std::array<size_t, kSahBins> right_count{};
+            std::array<double, 3> right_min = kEmptyMin, right_max = kEmptyMax;
+            size_t num_right = 0;
+            for (size_t bin = kSahBins - 1; bin != 0; --bin)
+            {
+                Extend(right_min, right_max, bins[axis][bin].min_bounds, bins[axis][bin].max_bounds);
+                num_right += bins[axis][bin].count;
+                right_area[bin] = num_right != 0 ? HalfArea(right_min, right_max) : 0.0;
+                right_count[bin] = num_right;
+            }
+
+            std::array<double, 3> left_min = kEmptyMin, left_max = kEmptyMax;
+            size_t num_left = 0;
+            for (size_t bin = 0; bin + 1 != kSahBins; ++bin)
+            {
+                Extend(left_min, left_max, bins[axis][bin].min_bounds, bins[axis][bin].max_bounds);
+                num_left += bins[axis][bin].count;
+                if (num_left == 0 || right_count[bin + 1] == 0)
+                {
+                    continue;
+                }
+                const double cost = HalfArea(left_min, left_max) * static_cast<double>(num_left) +
+                                    right_area[bin + 1] * static_cast<double>(right_count[bin + 1]);
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = bin;
+                }
+            }
+        }
+
+        // Все центроиды совпадают - делим пополам
+        if (best_cost == std::numeric_limits<double>::max())
         {
-            const Vector &point = triangle.GetPoint(i);
-            for (size_t j = 0; j < 3; ++j)
+            return SplitMedian(data, start, end);
+        }
+
+        return StablePartition(start, end,
+                               [&](const uint32_t triangle)
+                               { return bin_of(triangle, best_axis) <= best_bin; },
+                               num_chunks);
+    }
+
+    void AABBTree::SortMorton(BuildData &data, const size_t start, const size_t end)
+    {
+        // Бокс центроидов участка: по частям, затем объединение
+        const size_t count = end - start;
+        const auto &centroids = data.centroids;
+        std::vector<std::array<double, 3>> chunk_min(data.num_threads, kEmptyMin),
+            chunk_max(data.num_threads, kEmptyMax);
+        parallel::ParallelForRange(
+            count, data.num_threads,
+            [&](const size_t begin, const size_t chunk_end, const size_t chunk)
+            {
+                for (size_t i = start + begin; i != start + chunk_end; ++i)
+                {
+                    Extend(chunk_min[chunk], chunk_max[chunk], centroids[primitives_[i]], centroids[primitives_[i]]);
+                }
+            },
+            data.num_threads);
+        std::array<double, 3> centroid_min = kEmptyMin, centroid_max = kEmptyMax;
+        for (size_t chunk = 0; chunk != data.num_threads; ++chunk)
+        {
+            Extend(centroid_min, centroid_max, chunk_min[chunk], chunk_max[chunk]);
+        }
+
+        // 30-битные коды: по 10 бит на ось, разряды осей x, y, z чередуются
+        constexpr double kGrid = 1023.0;
+        std::array<double, 3> scale{};
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            const double extent = centroid_max[axis] - centroid_min[axis];
+            scale[axis] = extent > 0.0 ? kGrid / extent : 0.0;
+        }
+        std::vector<uint32_t> codes(count);
+        std::vector<uint32_t> triangles(primitives_.begin() + static_cast<std::ptrdiff_t>(start),
+                                        primitives_.begin() + static_cast<std::ptrdiff_t>(end));
+        parallel::ParallelForRange(
+            count, data.num_threads,
+            [&](const size_t begin, const size_t chunk_end, size_t)
             {
-                min_bounds[j] = std::min(min_bounds[j], point[j]);
-                max_bounds[j] = std::max(max_bounds[j], point[j]);
+                for (size_t i = begin; i != chunk_end; ++i)
+                {
+                    uint32_t code = 0;
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        const double cell = std::clamp((centroids[triangles[i]][axis] - centroid_min[axis]) * scale[axis],
+                                                       0.0, kGrid);
+                        code = (code << 1) | ExpandBits(static_cast<uint32_t>(cell));
+                    }
+                    codes[i] = code;
+                }
+            },
+            data.num_threads);
+
+        parallel::ParallelRadixSort(codes, triangles, data.num_threads, data.num_threads);
+        std::copy(triangles.begin(), triangles.end(), primitives_.begin() + static_cast<std::ptrdiff_t>(start));
+        std::copy(codes.begin(), codes.end(), data.morton_codes.begin() + static_cast<std::ptrdiff_t>(start));
+    }
+
+    size_t AABBTree::SplitMorton(const BuildData &data, size_t start, size_t end)
+    {
+        // Совпадающие коды делятся пополам
+        const std::vector<uint32_t> &codes = data.morton_codes;
+        const uint32_t first = codes[start];
+        const uint32_t last = codes[end - 1];
+        if (first == last)
+        {
+            return start + (end - start) / 2;
+        }
+
+        // Граница - последний код с тем же старшим различающимся разрядом, что у первого.
+        // Коды отсортированы, поэтому она ищется двоичным поиском и узел не переставляет треугольники
+        const int prefix = std::countl_zero(first ^ last);
+        size_t split = start;
+        size_t step = end - 1 - start;
+        do
+        {
+            step = (step + 1) / 2;
+            const size_t candidate = split + step;
+            if (candidate < end - 1 && std::countl_zero(first ^ codes[candidate]) > prefix)
+            {
+                split = candidate;
             }
+        } while (step > 1);
+        return split + 1;
+    }
+
+    template <class Predicate>
+    size_t AABBTree::StablePartition(size_t start, size_t end, Predicate &&predicate, size_t num_chunks)
+    {
+        const auto first = primitives_.begin() + static_cast<std::ptrdiff_t>(start);
+        const auto last = primitives_.begin() + static_cast<std::ptrdiff_t>(end);
+        if (num_chunks <= 1)
+        {
+            return static_cast<size_t>(std::stable_partition(first, last, predicate) - primitives_.begin());
+        }
+
+        // Параллельный вариант даёт тот же порядок: каждая часть считает свои левые
+        // элементы, затем элементы раскладываются по смещениям частей
+        const size_t count = end - start;
+        std::vector<size_t> num_left(num_chunks, 0);
+        parallel::ParallelForRange(
+            count, num_chunks,
+            [&](const size_t begin, const size_t chunk_end, const size_t chunk)
+            {
+                for (size_t i = start + begin; i != start + chunk_end; ++i)
+                {
+                    num_left[chunk] += predicate(primitives_[i]) ? 1 : 0;
+                }
+            },
+            num_chunks);
+
+        std::vector<size_t> left_offset(num_chunks), right_offset(num_chunks);
+        size_t total_left = 0;
+        for (size_t chunk = 0; chunk != num_chunks; ++chunk)
+        {
+            left_offset[chunk] = total_left;
+            total_left += num_left[chunk];
+        }
+        for (size_t chunk = 0; chunk != num_chunks; ++chunk)
+        {
+            const size_t chunk_begin = count * chunk / num_chunks;
+            right_offset[chunk] = total_left + chunk_begin - left_offset[chunk];
+        }
+
+        std::vector<uint32_t> partitioned(count);
+        parallel::ParallelForRange(
+            count, num_chunks,
+            [&](const size_t begin, const size_t chunk_end, const size_t chunk)
+            {
+                size_t left = left_offset[chunk], right = right_offset[chunk];
+                for (size_t i = start + begin; i != start + chunk_end; ++i)
+                {
+                    const uint32_t triangle = primitives_[i];
+                    partitioned[predicate(triangle) ? left++ : right++] = triangle;
+                }
+            },
+            num_chunks);
+        std::copy(partitioned.begin(), partitioned.end(), first);
+
+        return start + total_left;
+    }
+
+    void AABBTree::SetBounds(AABBTreeNode &node,
+                             const std::array<double, 3> &min_bounds, const std::array<double, 3> &max_bounds)
+    {
+        for (size_t i = 0; i != 3; ++i)
+        {
+            node.min_bounds[i] = RoundDown(min_bounds[i]);
+            node.max_bounds[i] = RoundUp(max_bounds[i]);
         }
     }
 
-    double AABBTree::AABBToAABB(const AABBTreeNode *node1, const AABBTreeNode *node2) const
+    double AABBTree::AABBToAABB(const AABBTreeNode &node1, const AABBTreeNode &node2)
     {
         double distance = 0.0;
 
         for (size_t i = 0; i < 3; ++i)
         {
-            if (node1->max_bounds[i] < node2->min_bounds[i])
+            if (node1.max_bounds[i] < node2.min_bounds[i])
             {
-                distance += std::pow(node2->min_bounds[i] - node1->max_bounds[i], 2);
+                distance += std::pow(static_cast<double>(node2.min_bounds[i]) - node1.max_bounds[i], 2);
             }
-            else if (node2->max_bounds[i] < node1->min_bounds[i])
+            else if (node2.max_bounds[i] < node1.min_bounds[i])
             {
-                distance += std::pow(node1->min_bounds[i] - node2->max_bounds[i], 2);
+                distance += std::pow(static_cast<double>(node1.min_bounds[i]) - node2.max_bounds[i], 2);
             }
         }
 
         return std::sqrt(distance);
     }
 
-    void AABBTree::FindClosestRecursive(const AABBTreeNode *node1, const AABBTreeNode *node2,
-                                        const Triangle *&closest1, const Triangle *&closest2,
-                                        double &min_distance) const
+    // Пары треугольников, ожидающие пакетного ядра: координаты структурой массивов
+    // и номера треугольников в порядке добавления
+    struct AABBTree::TriangleBatch
+    {
+        std::array<double, 9 * kTriangleBatchWidth> coords1{};
+        std::array<double, 9 * kTriangleBatchWidth> coords2{};
+        std::array<std::array<size_t, 2>, kTriangleBatchWidth> triangles{};
+        size_t size = 0;
+    };
+
+    void AABBTree::AddLeafPair(const AABBTree &other, const AABBTreeNode &leaf1, const AABBTreeNode &leaf2,
+                               TriangleBatch &batch, size_t &closest1, size_t &closest2, double &min_distance,
+                               AABBTreeQueryStats *stats) const
     {
-        if (!node1 || !node2)
+        AddLeafPair(leaf_coords_.data() + 9 * static_cast<size_t>(leaf1.offset), primitives_.data() + leaf1.offset,
+                    leaf1.count, other.leaf_coords_.data() + 9 * static_cast<size_t>(leaf2.offset),
+                    other.primitives_.data() + leaf2.offset, leaf2.count, batch, closest1, closest2, min_distance,
+                    stats);
+    }
+
+    void AABBTree::AddLeafPair(const double *coords1, const uint32_t *primitives1, const size_t count1,
+                               const double *coords2, const uint32_t *primitives2, const size_t count2,
+                               TriangleBatch &batch, size_t &closest1, size_t &closest2, double &min_distance,
+                               AABBTreeQueryStats *stats)
+    {
+
+        // Боксы треугольников второго листа по дорожкам
+        std::array<std::array<double, kMaxLeafSize>, 3> min2{}, max2{};
+        for (size_t axis = 0; axis != 3; ++axis)
         {
-            return;
+            const double *a = coords2 + axis * count2;
+            const double *b = coords2 + (3 + axis) * count2;
+            const double *c = coords2 + (6 + axis) * count2;
+            for (size_t lane = 0; lane != count2; ++lane)
+            {
+                min2[axis][lane] = std::min(std::min(a[lane], b[lane]), c[lane]);
+                max2[axis][lane] = std::max(std::max(a[lane], b[lane]), c[lane]);
+            }
+        }
+
+        // Квадраты расстояний между боксами всех пар треугольников - нижние границы
+        // расстояний. Цикл по дорожкам без ветвлений компилятор векторизует
+        std::array<double, kMaxLeafSize * kMaxLeafSize> lower{};
+        for (size_t i = 0; i != count1; ++i)
+        {
+            double *row = lower.data() + i * count2;
+            for (size_t lane = 0; lane != count2; ++lane)
+            {
+                row[lane] = 0.0;
+            }
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                const double a = coords1[axis * count1 + i];
+                const double b = coords1[(3 + axis) * count1 + i];
+                const double c = coords1[(6 + axis) * count1 + i];
+                const double min1 = std::min(std::min(a, b), c);
+                const double max1 = std::max(std::max(a, b), c);
+                for (size_t lane = 0; lane != count2; ++lane)
+                {
+                    const double gap = std::max(std::max(min2[axis][lane] - max1, min1 - max2[axis][lane]), 0.0);
+                    row[lane] += gap * gap;
+                }
+            }
         }
 
-        // Вычисляем минимальное расстояние между AABB узлами
-        double distance = AABBToAABB(node1, node2);
+        // Точные расстояния - только для пар, бокс которых ближе текущего минимума,
+        // в порядке возрастания нижней границы
+        std::array<uint8_t, kMaxLeafSize * kMaxLeafSize> order{};
+        size_t num_candidates = 0;
+        const double min_squared = min_distance * min_distance;
+        for (size_t pair = 0; pair != count1 * count2; ++pair)
+        {
+            if (lower[pair] < min_squared)
+            {
+                order[num_candidates++] = static_cast<uint8_t>(pair);
+            }
+        }
+        // Равные границы упорядочиваются по номеру пары, чтобы порядок не зависел
+        // от набора кандидатов (на этом основано совпадение параллельного поиска с последовательным)
+        std::sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(num_candidates),
+                  [&lower](const uint8_t a, const uint8_t b)
+                  { return lower[a] < lower[b] || (lower[a] == lower[b] && a < b); });
+
+        // Кандидаты в порядке возрастания границы добавляются в пакет, пока бокс ближе
+        // текущего минимума; полный пакет сразу считается и может уменьшить минимум
+        size_t num_added = 0;
+        for (size_t candidate = 0;
+             candidate != num_candidates && lower[order[candidate]] < min_distance * min_distance; ++candidate)
+        {
+            const size_t pair = order[candidate];
+            const size_t i = pair / count2, j = pair % count2;
+            for (size_t row = 0; row != 9; ++row)
+            {
+                batch.coords1[row * kTriangleBatchWidth + batch.size] = coords1[row * count1 + i];
+                batch.coords2[row * kTriangleBatchWidth + batch.size] = coords2[row * count2 + j];
+            }
+            batch.triangles[batch.size++] = {primitives1[i], primitives2[j]};
+            ++num_added;
+            if (batch.size == kTriangleBatchWidth)
+            {
+                FlushBatch(batch, closest1, closest2, min_distance, stats);
+            }
+        }
 
-        // Если расстояние больше текущего минимального, пропускаем узлы
-        if (distance >= min_distance)
+        if (stats)
+        {
+            stats->culled_pairs += count1 * count2 - num_added;
+        }
+    }
+
+    void AABBTree::FlushBatch(TriangleBatch &batch, size_t &closest1, size_t &closest2, double &min_distance,
+                              AABBTreeQueryStats *stats)
+    {
+        if (batch.size == 0)
         {
             return;
         }
 
-        // Если оба узла листовые, вычисляем расстояние между треугольниками
-        if (node1->IsLeaf() && node2->IsLeaf())
+        // Результаты применяются в порядке добавления, поэтому найденная пара та же,
+        // что и при расчёте по одной. Текущий минимум передаётся ядру: пакет, все пары
+        // которого разделены плоскостью грани не ближе него, не считается
+        std::array<double, kTriangleBatchWidth> distances{};
+        TriangleDistances(batch.coords1.data(), batch.coords2.data(), kTriangleBatchWidth, batch.size,
+                          distances.data(), min_distance);
+        for (size_t k = 0; k != batch.size; ++k)
+        {
+            if (distances[k] < min_distance)
+            {
+                min_distance = distances[k];
+                closest1 = batch.triangles[k][0];
+                closest2 = batch.triangles[k][1];
+            }
+        }
+        if (stats)
+        {
+            stats->triangle_pairs += batch.size;
+        }
+        batch.size = 0;
+    }
+
+    void AABBTree::LeafToLeaf(const AABBTree &other, const AABBTreeNode &leaf1, const AABBTreeNode &leaf2,
+                              size_t &closest1, size_t &closest2, double &min_distance,
+                              AABBTreeQueryStats *stats) const
+    {
+        TriangleBatch batch;
+        AddLeafPair(other, leaf1, leaf2, batch, closest1, closest2, min_distance, stats);
+        FlushBatch(batch, closest1, closest2, min_distance, stats);
+    }
+
+    void AABBTree::LeafToLeaf(const double *coords1, const uint32_t *primitives1, const size_t count1,
+                              const double *coords2, const uint32_t *primitives2, const size_t count2,
+                              size_t &closest1, size_t &closest2, double &min_distance, AABBTreeQueryStats *stats)
+    {
+        TriangleBatch batch;
+        AddLeafPair(coords1, primitives1, count1, coords2, primitives2, count2, batch, closest1, closest2,
+                    min_distance, stats);
+        FlushBatch(batch, closest1, closest2, min_distance, stats);
+    }
+
+    size_t AABBTree::ChildPairs(const AABBTree &other, const uint32_t node1, const uint32_t node2,
+                                std::array<std::array<uint32_t, 2>, 4> &pairs,
+                                std::array<double, 4> &distances) const
+    {
+        // Левый потомок - следующий узел
+        const AABBTreeNode &box1 = nodes_[node1];
+        const AABBTreeNode &box2 = other.nodes_[node2];
+        if (box1.IsLeaf() || box2.IsLeaf())
+        {
+            if (box1.IsLeaf())
+            {
+                pairs[0] = {node1, node2 + 1};
+                pairs[1] = {node1, box2.offset};
+            }
+            else
+            {
+                pairs[0] = {node1 + 1, node2};
+                pairs[1] = {box1.offset, node2};
+            }
+            for (size_t i = 0; i != 2; ++i)
+            {
+                distances[i] = AABBToAABB(nodes_[pairs[i][0]], other.nodes_[pairs[i][1]]);
+            }
+            return 2;
+        }
+
+        // Сначала более близкие пары: раньше найденный минимум отсекает больше узлов
+        std::array<ChildPair, 4> sorted = {{{0.0, node1 + 1, node2 + 1},
+                                            {0.0, node1 + 1, box2.offset},
+                                            {0.0, box1.offset, node2 + 1},
+                                            {0.0, box1.offset, box2.offset}}};
+        for (ChildPair &pair : sorted)
+        {
+            pair.distance = AABBToAABB(nodes_[pair.node1], other.nodes_[pair.node2]);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const ChildPair &a, const ChildPair &b)
+                         { return a.distance < b.distance; });
+        for (size_t i = 0; i != 4; ++i)
+        {
+            pairs[i] = {sorted[i].node1, sorted[i].node2};
+            distances[i] = sorted[i].distance;
+        }
+        return 4;
+    }
+
+    void AABBTree::FindClosestIterative(const AABBTree &other, const uint32_t node1, const uint32_t node2,
+                                        size_t &closest1, size_t &closest2, double &min_distance,
+                                        AABBTreeQueryStats *stats, SharedBounds *shared, const size_t task) const
+    {
+        // Пара отсекается, если её боксы не ближе текущего минимума или минимума подзадач,
+        // идущих раньше в порядке обхода: при равенстве выигрывает более ранняя пара.
+        // Минимум более поздних подзадач отсекает только строго более далёкие узлы
+        const auto pruned = [&](const double distance)
+        {
+            return distance >= min_distance ||
+                   (shared && (distance >= shared->earlier[task].load(std::memory_order_relaxed) ||
+                               distance > shared->all.load(std::memory_order_relaxed)));
+        };
+
+        // Явный стек пар узлов. С каждого уровня в нём остаётся не больше трёх
+        // непройденных пар, так что глубины деревьев ограничивают его размер;
+        // память выделяется, только если он не помещается в массив на стеке потока
+        std::array<ChildPair, kTraversalStackSize> local_stack;
+        std::vector<ChildPair> heap_stack;
+        ChildPair *stack = local_stack.data();
+        const size_t capacity = 3 * (static_cast<size_t>(depth_) + other.depth_) + 1;
+        if (capacity > kTraversalStackSize)
+        {
+            heap_stack.resize(capacity);
+            stack = heap_stack.data();
+        }
+        size_t size = 0;
+
+        // Пары треугольников копятся в пакете через границы листов и считаются, когда
+        // он заполнится, и в конце обхода. Пока пакет не посчитан, узлы отсекаются по
+        // прежнему, не меньшему минимуму - лишь слабее, но без потери ближайшей пары
+        TriangleBatch batch;
+        const auto update = [&](const auto &compute)
+        {
+            // Пары треугольников отсекаются и минимумом более ранних подзадач. Минимум
+            // более поздних ядру не передаётся: пара на том же расстоянии ещё может выиграть,
+            // а разделение плоскостью, которым ядро отсекает пары, точно лишь до округления
+            const double start =
+                shared ? std::min(min_distance, shared->earlier[task].load(std::memory_order_relaxed)) : min_distance;
+            double bound = start;
+            size_t found1 = closest1, found2 = closest2;
+            compute(found1, found2, bound);
+            if (bound < start)
+            {
+                min_distance = bound;
+                closest1 = found1;
+                closest2 = found2;
+                if (shared)
+                {
+                    StoreMin(shared->all, min_distance);
+                    for (size_t later = task + 1; later != shared->earlier.size(); ++later)
+                    {
+                        StoreMin(shared->earlier[later], min_distance);
+                    }
+                }
+            }
+        };
+
+        const double root_distance = AABBToAABB(nodes_[node1], other.nodes_[node2]);
+        if (stats)
+        {
+            ++stats->node_pairs;
+        }
+        if (!pruned(root_distance))
+        {
+            stack[size++] = {root_distance, node1, node2};
+        }
+
+        while (size != 0)
         {
-            Triangle tr_1 = node1->triangle;
-            Triangle tr_2 = node2->triangle;
-            double gjk = dist::GJK::Distance(tr_1, tr_2);
-            double vert = MinVertexDistance(tr_1, tr_2);
-            double segments = MinSegmentDistance(tr_1, tr_2);
-            std::vector<double> dist_tr = {gjk, vert, segments};
-            double triangle_distance = *std::min_element(dist_tr.begin(), dist_tr.end());
+            // Минимум мог уменьшиться, пока пара лежала в стеке
+            const ChildPair pair = stack[--size];
+            if (pruned(pair.distance))
+            {
+                continue;
+            }
+            if (stats)
+            {
+                ++stats->expanded_pairs;
+            }
 
-            if (triangle_distance < min_distance)
+            // Если оба узла листовые, вычисляем расстояние между треугольниками
+            const AABBTreeNode &box1 = nodes_[pair.node1];
+            const AABBTreeNode &box2 = other.nodes_[pair.node2];
+            if (box1.IsLeaf() && box2.IsLeaf())
             {
-                min_distance = triangle_distance;
-                closest1 = &node1->triangle;
-                closest2 = &node2->triangle;
+                update([&](size_t &found1, size_t &found2, double &bound)
+                       { AddLeafPair(other, box1, box2, batch, found1, found2, bound, stats); });
+                continue;
             }
+
+            // Более близкие пары кладутся последними и снимаются первыми
+            std::array<std::array<uint32_t, 2>, 4> pairs;
+            std::array<double, 4> distances;
+            const size_t num_pairs = ChildPairs(other, pair.node1, pair.node2, pairs, distances);
+            if (stats)
+            {
+                stats->node_pairs += num_pairs;
+            }
+            for (size_t i = num_pairs; i-- != 0;)
+            {
+                if (!pruned(distances[i]))
+                {
+                    stack[size++] = {distances[i], pairs[i][0], pairs[i][1]};
+                }
+            }
+        }
+        update([&](size_t &found1, size_t &found2, double &bound)
+               { FlushBatch(batch, found1, found2, bound, stats); });
+    }
+
+    void AABBTree::FindClosestTriangles(const AABBTree &other, size_t &closest1,
+                                        size_t &closest2, double &min_distance,
+                                        AABBTreeQueryStats *stats) const
+    {
+        closest1 = kNoTriangle;
+        closest2 = kNoTriangle;
+        min_distance = std::numeric_limits<double>::max();
+
+        if (nodes_.empty() || other.nodes_.empty())
+        {
+            return;
+        }
+
+        FindClosestIterative(other, 0, 0, closest1, closest2, min_distance, stats);
+    }
+
+    void AABBTree::FindClosestTrianglesParallel(const AABBTree &other, size_t &closest1,
+                                                size_t &closest2, double &min_distance,
+                                                size_t num_threads, AABBTreeQueryStats *stats) const
+    {
+        num_threads = parallel::ResolveThreadCount(num_threads);
+        if (num_threads == 1 || nodes_.empty() || other.nodes_.empty())
+        {
+            FindClosestTriangles(other, closest1, closest2, min_distance, stats);
             return;
         }
 
-        // Рекурсивно проверяем дочерние узлы
-        if (node1->IsLeaf())
+        // Первый лист обхода в глубину даёт начальный минимум: его находит и
+        // последовательный поиск, раньше всех остальных пар треугольников
+        std::array<uint32_t, 2> first = {0, 0};
+        while (!nodes_[first[0]].IsLeaf() || !other.nodes_[first[1]].IsLeaf())
+        {
+            std::array<std::array<uint32_t, 2>, 4> pairs;
+            std::array<double, 4> distances;
+            const size_t num_pairs = ChildPairs(other, first[0], first[1], pairs, distances);
+            first = pairs[0];
+            if (stats)
+            {
+                stats->node_pairs += num_pairs;
+                ++stats->expanded_pairs;
+            }
+        }
+        size_t seed1 = kNoTriangle, seed2 = kNoTriangle;
+        double seed_distance = std::numeric_limits<double>::max();
+        LeafToLeaf(other, nodes_[first[0]], other.nodes_[first[1]], seed1, seed2, seed_distance, stats);
+
+        // Подзадачи - пары узлов, раскрытые по уровням с сохранением порядка обхода
+        // в глубину; пары, боксы которых не ближе начального минимума, отбрасываются.
+        // Последовательный поиск выбирает первую в этом порядке пару треугольников на
+        // минимальном расстоянии, поэтому результаты сравниваются по (расстоянию, номеру
+        // подзадачи), а начальный минимум идёт раньше всех подзадач
+        std::vector<std::array<uint32_t, 2>> tasks;
+        if (AABBToAABB(nodes_[0], other.nodes_[0]) < seed_distance)
         {
-            FindClosestRecursive(node1, node2->left.get(), closest1, closest2, min_distance);
-            FindClosestRecursive(node1, node2->right.get(), closest1, closest2, min_distance);
+            tasks.push_back({0, 0});
         }
-        else if (node2->IsLeaf())
+        const size_t target_tasks = kQueryTasksPerThread * num_threads;
+        bool expanded = true;
+        while (expanded && !tasks.empty() && tasks.size() < target_tasks)
         {
-            FindClosestRecursive(node1->left.get(), node2, closest1, closest2, min_distance);
-            FindClosestRecursive(node1->right.get(), node2, closest1, closest2, min_distance);
+            expanded = false;
+            std::vector<std::array<uint32_t, 2>> next;
+            next.reserve(4 * tasks.size());
+            for (const std::array<uint32_t, 2> &task : tasks)
+            {
+                if (nodes_[task[0]].IsLeaf() && other.nodes_[task[1]].IsLeaf())
+                {
+                    next.push_back(task);
+                    continue;
+                }
+                std::array<std::array<uint32_t, 2>, 4> pairs;
+                std::array<double, 4> distances;
+                const size_t num_pairs = ChildPairs(other, task[0], task[1], pairs, distances);
+                for (size_t i = 0; i != num_pairs; ++i)
+                {
+                    if (distances[i] < seed_distance)
+                    {
+                        next.push_back(pairs[i]);
+                    }
+                }
+                expanded = true;
+                if (stats)
+                {
+                    stats->node_pairs += num_pairs;
+                    ++stats->expanded_pairs;
+                }
+            }
+            tasks.swap(next);
         }
-        else
+
+        struct TaskResult
+        {
+            double distance = std::numeric_limits<double>::max();
+            size_t closest1 = kNoTriangle;
+            size_t closest2 = kNoTriangle;
+        };
+        std::vector<TaskResult> results(tasks.size());
+        std::vector<AABBTreeQueryStats> thread_stats(num_threads);
+        SharedBounds shared{seed_distance, std::vector<std::atomic<double>>(tasks.size())};
+        for (std::atomic<double> &bound : shared.earlier)
+        {
+            bound.store(seed_distance, std::memory_order_relaxed);
+        }
+        const auto run_task = [&](const size_t task, const size_t thread_index)
+        {
+            TaskResult &result = results[task];
+            FindClosestIterative(other, tasks[task][0], tasks[task][1], result.closest1, result.closest2,
+                                 result.distance, stats ? &thread_stats[thread_index] : nullptr, &shared, task);
+        };
+
+        // Первая подзадача продолжает последовательный обход с начального листа и
+        // выполняется до запуска остальных: её минимум сразу отсекает все более поздние,
+        // а для касающихся тел обычно равен нулю и отсекает их целиком
+        if (!tasks.empty())
+        {
+            run_task(0, 0);
+        }
+        if (tasks.size() > 1)
+        {
+            parallel::ParallelForStealing(
+                tasks.size() - 1, [&](const size_t task, const size_t thread_index)
+                { run_task(task + 1, thread_index); }, num_threads);
+        }
+
+        closest1 = seed1;
+        closest2 = seed2;
+        min_distance = seed_distance;
+        for (const TaskResult &result : results)
+        {
+            if (result.distance < min_distance)
+            {
+                min_distance = result.distance;
+                closest1 = result.closest1;
+                closest2 = result.closest2;
+            }
+        }
+        if (stats)
         {
-            FindClosestRecursive(node1->left.get(), node2->left.get(), closest1, closest2, min_distance);
-            FindClosestRecursive(node1->left.get(), node2->right.get(), closest1, closest2, min_distance);
-            FindClosestRecursive(node1->right.get(), node2->left.get(), closest1, closest2, min_distance);
-            FindClosestRecursive(node1->right.get(), node2->right.get(), closest1, closest2, min_distance);
+            for (const AABBTreeQueryStats &thread : thread_stats)
+            {
+                stats->node_pairs += thread.node_pairs;
+                stats->expanded_pairs += thread.expanded_pairs;
+                stats->triangle_pairs += thread.triangle_pairs;
+                stats->culled_pairs += thread.culled_pairs;
+            }
         }
     }
 
-    void AABBTree::FindClosestTriangles(const AABBTree &other, const Triangle *&closest1,
-                                        const Triangle *&closest2, double &min_distance) const
+    void AABBTree::FindClosestTrianglesBestFirst(const AABBTree &other, size_t &closest1,
+                                                 size_t &closest2, double &min_distance,
+                                                 AABBTreeQueryStats *stats) const
     {
-        closest1 = nullptr;
-        closest2 = nullptr;
+        closest1 = kNoTriangle;
+        closest2 = kNoTriangle;
         min_distance = std::numeric_limits<double>::max();
 
-        FindClosestRecursive(root_.get(), other.root_.get(), closest1, closest2, min_distance);
+        if (nodes_.empty() || other.nodes_.empty())
+        {
+            return;
+        }
+
+        // Куча пар узлов с ближайшей парой в вершине. Из равноудалённых пар
+        // (например, пересекающихся боксов касающихся тел) первой раскрывается
+        // добавленная последней: поиск уходит вглубь, как при обходе в глубину
+        struct QueuedPair
+        {
+            ChildPair pair;
+            size_t order;
+        };
+        const auto later = [](const QueuedPair &a, const QueuedPair &b)
+        {
+            return a.pair.distance > b.pair.distance ||
+                   (a.pair.distance == b.pair.distance && a.order < b.order);
+        };
+        std::vector<QueuedPair> heap;
+        size_t num_pushed = 0;
+        const auto push = [&](const uint32_t node1, const uint32_t node2)
+        {
+            const double distance = AABBToAABB(nodes_[node1], other.nodes_[node2]);
+            if (stats)
+            {
+                ++stats->node_pairs;
+            }
+            if (distance < min_distance)
+            {
+                heap.push_back({{distance, node1, node2}, num_pushed++});
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        };
+
+        push(0, 0);
+        while (!heap.empty() && heap.front().pair.distance < min_distance)
+        {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            const ChildPair pair = heap.back().pair;
+            heap.pop_back();
+            if (stats)
+            {
+                ++stats->expanded_pairs;
+            }
+
+            const AABBTreeNode &box1 = nodes_[pair.node1];
+            const AABBTreeNode &box2 = other.nodes_[pair.node2];
+            if (box1.IsLeaf() && box2.IsLeaf())
+            {
+                LeafToLeaf(other, box1, box2, closest1, closest2, min_distance, stats);
+            }
+            else if (box1.IsLeaf())
+            {
+                push(pair.node1, pair.node2 + 1);
+                push(pair.node1, box2.offset);
+            }
+            else if (box2.IsLeaf())
+            {
+                push(pair.node1 + 1, pair.node2);
+                push(box1.offset, pair.node2);
+            }
+            else
+            {
+                push(pair.node1 + 1, pair.node2 + 1);
+                push(pair.node1 + 1, box2.offset);
+                push(box1.offset, pair.node2 + 1);
+                push(box1.offset, box2.offset);
+            }
+        }
     }
 
 } // namespace math
@@ -1,51 +1,258 @@
 #pragma once
 
+#include "Mesh.hpp"
 #include "Triangle.hpp"
-#include "GJK.hpp"
 
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace math
 {
+    template <size_t Width>
+    class WideAABBTree;
+    template <typename T>
+    class QuantizedAABBTree;
+
+    /**
+     * Узел дерева (32 байта). Узлы лежат в одном массиве в порядке обхода в глубину:
+     * левый потомок внутреннего узла идёт сразу за ним, правый - по номеру offset.
+     * Лист ссылается на count номеров треугольников, начиная с offset, в массиве
+     * Primitives() дерева.
+     *
+     * Границы хранятся во float и округлены наружу, поэтому бокс всегда
+     * содержит свои треугольники и расстояние между боксами не превышает
+     * расстояния между их содержимым
+     */
     struct AABBTreeNode
     {
-        std::unique_ptr<AABBTreeNode> left;
-        std::unique_ptr<AABBTreeNode> right;
+        float min_bounds[3];
+        float max_bounds[3];
+        uint32_t offset; // Правый потомок (внутренний узел) или первый треугольник (лист)
+        uint32_t count;  // Число треугольников листа (0 - внутренний узел)
 
-        Triangle triangle;
+        bool IsLeaf() const { return count != 0; }
+    };
 
-        std::array<double, 3> min_bounds;
-        std::array<double, 3> max_bounds;
+    /**
+     * Способ разбиения узлов при построении дерева
+     */
+    enum class BuildMethod
+    {
+        Median, // Пополам по числу треугольников вдоль оси Y
+        SAH,    // Эвристика площади поверхности по корзинам центроидов
+        LBVH,   // По кодам Мортона центроидов: быстрое построение, дерево хуже SAH
+        Auto    // SAH для сеток от kSahMinTriangles треугольников, иначе Median
+    };
 
-        AABBTreeNode() = default;
+    struct AABBTreeOptions
+    {
+        BuildMethod method = BuildMethod::Auto;
+        size_t max_leaf_size = 4; // Наибольшее число треугольников листа (от 1 до AABBTree::kMaxLeafSize)
+        size_t num_threads = 0; // Число потоков построения (0 - все ядра), на дерево не влияет
+    };
 
-        bool IsLeaf() const { return !left && !right; }
+    struct AABBTreeRefitOptions
+    {
+        // Поддерево перестраивается, если пересечение боксов потомков его корня занимает
+        // большую долю площади корня (1 - только обновление границ)
+        double rebuild_overlap = 1.0;
+        AABBTreeOptions build; // Построение перестраиваемых поддеревьев и число потоков
     };
 
+    /**
+     * Счётчики работы поиска ближайшей пары
+     */
+    struct AABBTreeQueryStats
+    {
+        size_t node_pairs = 0;     // Проверенные пары узлов
+        size_t expanded_pairs = 0; // Раскрытые пары узлов (не отсечённые по расстоянию)
+        size_t triangle_pairs = 0; // Вычисленные расстояния между треугольниками
+        size_t culled_pairs = 0;   // Пары треугольников листьев, отсечённые по их боксам
+    };
+
+    /**
+     * AABB-дерево над индексированной сеткой. Листья хранят до kMaxLeafSize номеров
+     * треугольников, а сетка разделяется через shared_ptr. Координаты вершин
+     * треугольников каждого листа дополнительно упакованы подряд в виде структуры
+     * массивов, чтобы пара листьев проверялась одним проходом по всем парам треугольников.
+     * Расстояния между треугольниками считаются в double и для float-сетки
+     * (расширение float до double точное), так что найденное расстояние
+     * точно для хранимых координат
+     */
     class AABBTree
     {
     private:
-        std::unique_ptr<AABBTreeNode> root_;
+        std::shared_ptr<const Mesh> mesh_;
+        std::vector<AABBTreeNode> nodes_;
+        std::vector<uint32_t> primitives_;
+
+        // Вершины треугольников в порядке primitives_: лист из count треугольников
+        // с первым offset занимает 9 * count чисел с позиции 9 * offset - массивы
+        // ax[count], ay[count], az[count], bx[count], ..., cz[count]
+        std::vector<double> leaf_coords_;
+        uint32_t depth_ = 0; // Наибольшая глубина листа (у корня 0)
+
+        struct BuildData;
+
+        uint32_t BuildTree(BuildData &data, std::vector<AABBTreeNode> &nodes, size_t start, size_t end);
+        void BuildParallel(BuildData &data);
+        static void SetInterior(std::vector<AABBTreeNode> &nodes, uint32_t index, uint32_t right);
+
+        size_t Split(BuildData &data, size_t start, size_t end, size_t num_threads);
+        size_t SplitMedian(BuildData &data, size_t start, size_t end);
+        size_t SplitSAH(BuildData &data, size_t start, size_t end, size_t num_threads);
+        void SortMorton(BuildData &data, size_t start, size_t end);
+        static size_t SplitMorton(const BuildData &data, size_t start, size_t end);
+        template <class Predicate>
+        size_t StablePartition(size_t start, size_t end, Predicate &&predicate, size_t num_chunks);
+        static void SetBounds(AABBTreeNode &node,
+                              const std::array<double, 3> &min_bounds, const std::array<double, 3> &max_bounds);
+
+        void ComputeBuildData(BuildData &data) const;
+        void PackLeaves(size_t num_threads = 1);
+        void ComputeDepth();
 
-        std::unique_ptr<AABBTreeNode> BuildTree(std::vector<Triangle> &triangles,
-                                                size_t start, size_t end);
-        void ComputeBounds(const Triangle &triangle,
-                           std::array<double, 3> &min_bounds, std::array<double, 3> &max_bounds);
+        void RefitBounds(size_t num_threads);
+        uint32_t SubtreeEnd(uint32_t node) const;
+        std::pair<size_t, size_t> PrimitiveRange(uint32_t node) const;
+        double ChildOverlap(uint32_t node) const;
+        void FindDegraded(uint32_t node, double max_overlap, std::vector<uint32_t> &roots) const;
 
-        double AABBToAABB(const AABBTreeNode *node1, const AABBTreeNode *node2) const;
+        static double AABBToAABB(const AABBTreeNode &node1, const AABBTreeNode &node2);
 
-        void FindClosestRecursive(const AABBTreeNode *node1, const AABBTreeNode *node2,
-                                  const Triangle *&closest1, const Triangle *&closest2,
-                                  double &min_distance) const;
+        template <size_t Width>
+        friend class WideAABBTree;
+        friend class OBBTree;
+        template <typename T>
+        friend class QuantizedAABBTree;
+
+        // Пакет пар треугольников для ядра TriangleDistances (определён в AABBTree.cpp)
+        struct TriangleBatch;
+
+        // Вершины count треугольников с номерами primitives структурой массивов (9 * count чисел)
+        static void PackLeaf(const Mesh &mesh, const uint32_t *primitives, size_t count, double *coords);
+
+        // Пары треугольников двух листов, бокс которых ближе min_distance, добавляются
+        // в пакет; каждый заполненный пакет сразу считается. Лист задаётся упакованными
+        // вершинами и номерами своих count треугольников
+        static void AddLeafPair(const double *coords1, const uint32_t *primitives1, size_t count1,
+                                const double *coords2, const uint32_t *primitives2, size_t count2,
+                                TriangleBatch &batch, size_t &closest1, size_t &closest2, double &min_distance,
+                                AABBTreeQueryStats *stats);
+        void AddLeafPair(const AABBTree &other, const AABBTreeNode &leaf1, const AABBTreeNode &leaf2,
+                         TriangleBatch &batch, size_t &closest1, size_t &closest2, double &min_distance,
+                         AABBTreeQueryStats *stats) const;
+
+        static void FlushBatch(TriangleBatch &batch, size_t &closest1, size_t &closest2, double &min_distance,
+                               AABBTreeQueryStats *stats);
+
+        // Все пары треугольников двух листов одним или несколькими пакетами
+        static void LeafToLeaf(const double *coords1, const uint32_t *primitives1, size_t count1,
+                               const double *coords2, const uint32_t *primitives2, size_t count2,
+                               size_t &closest1, size_t &closest2, double &min_distance,
+                               AABBTreeQueryStats *stats);
+        void LeafToLeaf(const AABBTree &other, const AABBTreeNode &leaf1, const AABBTreeNode &leaf2,
+                        size_t &closest1, size_t &closest2, double &min_distance,
+                        AABBTreeQueryStats *stats) const;
+
+        size_t ChildPairs(const AABBTree &other, uint32_t node1, uint32_t node2,
+                          std::array<std::array<uint32_t, 2>, 4> &pairs, std::array<double, 4> &distances) const;
+
+        // Границы, общие для подзадач параллельного поиска: минимум всех подзадач и для
+        // каждой подзадачи - минимум подзадач, идущих раньше неё в порядке обхода
+        struct SharedBounds
+        {
+            std::atomic<double> all;
+            std::vector<std::atomic<double>> earlier;
+        };
+
+        void FindClosestIterative(const AABBTree &other, uint32_t node1, uint32_t node2,
+                                  size_t &closest1, size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats, SharedBounds *shared = nullptr,
+                                  size_t task = 0) const;
 
     public:
-        AABBTree(const std::vector<Triangle> &triangles);
+        static constexpr size_t kNoTriangle = std::numeric_limits<size_t>::max();
+        static constexpr size_t kMaxLeafSize = 8;
+        static constexpr size_t kSahMinTriangles = 1024; // Меньше - SAH не окупает построение
+        static constexpr size_t kSahBins = 16;
+        static constexpr size_t kSahMinRange = 32; // Меньшие диапазоны делятся пополам
+        static constexpr size_t kParallelBuildMin = 16384;  // Меньшие сетки строятся в одном потоке
+        static constexpr size_t kParallelSplitMin = 65536;  // Меньшие диапазоны разбиваются в одном потоке
+        static constexpr size_t kParallelTaskMin = 1024;    // Меньшие поддеревья не делятся на задачи
+        static constexpr size_t kTasksPerThread = 4;
+        static constexpr size_t kQueryTasksPerThread = 32; // Подзадач параллельного поиска на поток
+        static constexpr size_t kTraversalStackSize = 256;  // Пар узлов в стеке обхода без выделения памяти
+
+        AABBTree(const std::vector<Triangle> &triangles, const AABBTreeOptions &options = {});
+        explicit AABBTree(std::shared_ptr<const Mesh> mesh, const AABBTreeOptions &options = {});
+
+        /**
+         * Восстановление дерева из готовых массивов узлов и номеров треугольников
+         * (например, из кэша) без сортировки и пересчёта границ. Массивы проверяются,
+         * при нарушении структуры (в том числе при листе больше kMaxLeafSize)
+         * выбрасывается std::invalid_argument
+         */
+        AABBTree(std::shared_ptr<const Mesh> mesh,
+                 const AABBTreeNode *nodes, size_t num_nodes,
+                 const uint32_t *primitives, size_t num_primitives);
         ~AABBTree() = default;
 
-        void FindClosestTriangles(const AABBTree &other, const Triangle *&closest1,
-                                  const Triangle *&closest2, double &min_distance) const;
+        /**
+         * Обновление дерева после перемещения вершин при той же топологии сетки (те же
+         * треугольники с теми же номерами вершин): границы узлов пересчитываются снизу
+         * вверх за O(N), независимые поддеревья - в нескольких потоках. Если задан
+         * options.rebuild_overlap < 1, поддеревья, у корня которых боксы потомков
+         * пересекаются сильнее, строятся заново (верхние узлы при этом не меняются).
+         * Возвращает число перестроенных поддеревьев. Если число треугольников другое,
+         * выбрасывается std::invalid_argument
+         */
+        size_t Refit(std::shared_ptr<const Mesh> mesh, const AABBTreeRefitOptions &options = {});
+
+        const Mesh &GetMesh() const;
+        const std::vector<AABBTreeNode> &Nodes() const;
+        const std::vector<uint32_t> &Primitives() const;
+
+        /**
+         * Объём памяти дерева в байтах (без сетки)
+         */
+        size_t MemoryBytes() const;
+
+        /**
+         * Ближайшая пара треугольников двух деревьев: номера треугольников в сетках
+         * (kNoTriangle, если одно из деревьев пустое) и расстояние между ними.
+         * Если передан stats, в него добавляются счётчики проверенных пар
+         */
+        void FindClosestTriangles(const AABBTree &other, size_t &closest1,
+                                  size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats = nullptr) const;
+
+        /**
+         * То же на num_threads потоках (0 - все ядра). Начальный минимум даёт первый
+         * лист обхода в глубину; пары узлов верхних уровней, боксы которых ближе него,
+         * раздаются потокам с перехватом работы, найденные минимумы общие для всех
+         * потоков и сразу отсекают узлы в остальных. Результат (расстояние и пара
+         * треугольников) совпадает с FindClosestTriangles при любом числе потоков
+         */
+        void FindClosestTrianglesParallel(const AABBTree &other, size_t &closest1,
+                                          size_t &closest2, double &min_distance,
+                                          size_t num_threads = 0,
+                                          AABBTreeQueryStats *stats = nullptr) const;
+
+        /**
+         * То же с обходом по наилучшей паре: пары узлов хранятся в очереди
+         * с приоритетом по расстоянию между боксами, всегда раскрывается
+         * ближайшая. Поиск заканчивается, как только ближайшая оставшаяся пара
+         * не ближе найденного минимума
+         */
+        void FindClosestTrianglesBestFirst(const AABBTree &other, size_t &closest1,
+                                           size_t &closest2, double &min_distance,
+                                           AABBTreeQueryStats *stats = nullptr) const;
     };
 
 } // namespace math
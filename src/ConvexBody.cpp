@@ -0,0 +1,432 @@
+#include "ConvexBody.hpp"
+#include "Vec3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace std::string_literals;
+
+namespace dist
+{
+    namespace
+    {
+        using math::vec3::Cross;
+        using math::vec3::Dot;
+        using math::vec3::Point;
+        using math::vec3::Sub;
+
+        // Допуск оболочки в долях суммы наибольших модулей координат по осям
+        constexpr double kRelativeTolerance = 1e-10;
+
+        // Грань оболочки с единичной внешней нормалью и точками, лежащими над ней
+        struct HullFace
+        {
+            std::array<uint32_t, 3> vertices;
+            Point normal;
+            double offset;
+            std::vector<uint32_t> outside;
+            bool alive = true;
+        };
+
+        HullFace MakeFace(const std::vector<Point> &points, const uint32_t a, const uint32_t b, const uint32_t c)
+        {
+            HullFace face{{a, b, c}, Cross(Sub(points[b], points[a]), Sub(points[c], points[a])), 0.0, {}, true};
+            const double length = std::sqrt(Dot(face.normal, face.normal));
+            if (length > 0.0)
+            {
+                for (double &coord : face.normal)
+                {
+                    coord /= length;
+                }
+            }
+            face.offset = Dot(face.normal, points[a]);
+            return face;
+        }
+
+        double Height(const HullFace &face, const Point &point) { return Dot(face.normal, point) - face.offset; }
+
+        // Ключ ориентированного ребра a -> b
+        uint64_t EdgeKey(const uint32_t a, const uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; }
+    } // namespace
+
+    ConvexBody::ConvexBody(const std::vector<math::Vector> &points)
+    {
+        std::vector<Point> coords(points.size());
+        for (size_t i = 0; i != points.size(); ++i)
+        {
+            coords[i] = {points[i][0], points[i][1], points[i][2]};
+        }
+        Build(coords);
+    }
+
+    ConvexBody::ConvexBody(const math::Mesh &mesh)
+    {
+        std::vector<Point> coords(mesh.VertexCount());
+        for (uint32_t i = 0; i != coords.size(); ++i)
+        {
+            coords[i] = {mesh.Coord(i, 0), mesh.Coord(i, 1), mesh.Coord(i, 2)};
+        }
+        Build(coords);
+    }
+
+    void ConvexBody::Build(const std::vector<Point> &points)
+    {
+        if (points.empty())
+        {
+            throw std::invalid_argument("Convex body needs at least one point"s);
+        }
+        if (points.size() > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::invalid_argument("Too many points for a convex body: "s + std::to_string(points.size()));
+        }
+        const uint32_t num_points = static_cast<uint32_t>(points.size());
+
+        // Плоское облако: вершины - все точки, соседства нет
+        const auto flat = [&]
+        {
+            vertices_ = points;
+            source_.resize(points.size());
+            std::iota(source_.begin(), source_.end(), 0u);
+            neighbor_offsets_.clear();
+            neighbors_.clear();
+            face_count_ = 0;
+            tolerance_ = 0.0;
+        };
+
+        double scale = 0.0;
+        std::array<uint32_t, 6> extremes{};
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            double largest = 0.0;
+            for (uint32_t i = 0; i != num_points; ++i)
+            {
+                largest = std::max(largest, std::abs(points[i][axis]));
+                if (points[i][axis] < points[extremes[2 * axis]][axis])
+                {
+                    extremes[2 * axis] = i;
+                }
+                if (points[i][axis] > points[extremes[2 * axis + 1]][axis])
+                {
+                    extremes[2 * axis + 1] = i;
+                }
+            }
+            scale += largest;
+        }
+        const double tolerance = kRelativeTolerance * scale;
+
+        // Начальный тетраэдр: самая длинная пара крайних точек, самая далёкая от её
+        // прямой точка и самая далёкая от получившейся плоскости
+        std::array<uint32_t, 4> base{};
+        double best = 0.0;
+        for (const uint32_t i : extremes)
+        {
+            for (const uint32_t j : extremes)
+            {
+                const Point d = Sub(points[j], points[i]);
+                if (Dot(d, d) > best)
+                {
+                    best = Dot(d, d);
+                    base[0] = i;
+                    base[1] = j;
+                }
+            }
+        }
+        if (std::sqrt(best) <= tolerance)
+        {
+            flat();
+            return;
+        }
+
+        const Point line = Sub(points[base[1]], points[base[0]]);
+        best = 0.0;
+        for (uint32_t i = 0; i != num_points; ++i)
+        {
+            const Point normal = Cross(line, Sub(points[i], points[base[0]]));
+            if (Dot(normal, normal) > best)
+            {
+                best = Dot(normal, normal);
+                base[2] = i;
+            }
+        }
+        if (std::sqrt(best / Dot(line, line)) <= tolerance)
+        {
+            flat();
+            return;
+        }
+
+        const HullFace plane = MakeFace(points, base[0], base[1], base[2]);
+        best = 0.0;
+        for (uint32_t i = 0; i != num_points; ++i)
+        {
+            if (std::abs(Height(plane, points[i])) > best)
+            {
+                best = std::abs(Height(plane, points[i]));
+                base[3] = i;
+            }
+        }
+        if (best <= tolerance)
+        {
+            flat();
+            return;
+        }
+
+        // Грань ссылается на соседей через ключи рёбер: у соседа по ребру a -> b есть ребро b -> a
+        std::vector<HullFace> faces;
+        std::unordered_map<uint64_t, uint32_t> edges;
+        const auto add_face = [&](HullFace face)
+        {
+            const uint32_t index = static_cast<uint32_t>(faces.size());
+            for (size_t i = 0; i != 3; ++i)
+            {
+                edges[EdgeKey(face.vertices[i], face.vertices[(i + 1) % 3])] = index;
+            }
+            faces.push_back(std::move(face));
+        };
+
+        Point centroid{};
+        for (const uint32_t i : base)
+        {
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                centroid[axis] += 0.25 * points[i][axis];
+            }
+        }
+        constexpr std::array<std::array<uint8_t, 3>, 4> kBaseFaces = {{{0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3}}};
+        for (const std::array<uint8_t, 3> &corners : kBaseFaces)
+        {
+            HullFace face = MakeFace(points, base[corners[0]], base[corners[1]], base[corners[2]]);
+            if (Height(face, centroid) > 0.0)
+            {
+                face = MakeFace(points, base[corners[0]], base[corners[2]], base[corners[1]]);
+            }
+            add_face(std::move(face));
+        }
+
+        for (uint32_t i = 0; i != num_points; ++i)
+        {
+            for (HullFace &face : faces)
+            {
+                if (Height(face, points[i]) > tolerance)
+                {
+                    face.outside.push_back(i);
+                    break;
+                }
+            }
+        }
+
+        // Новые грани добавляются в конец, поэтому одного прохода достаточно:
+        // точки переходят только к граням, которые ещё впереди
+        std::vector<uint32_t> visit_stamp, visible, orphans;
+        std::vector<char> is_visible;
+        std::vector<std::array<uint32_t, 2>> horizon;
+        for (uint32_t current = 0; current != faces.size(); ++current)
+        {
+            if (!faces[current].alive || faces[current].outside.empty())
+            {
+                continue;
+            }
+
+            // Самая далёкая из точек над гранью
+            uint32_t eye = faces[current].outside[0];
+            for (const uint32_t i : faces[current].outside)
+            {
+                if (Height(faces[current], points[i]) > Height(faces[current], points[eye]))
+                {
+                    eye = i;
+                }
+            }
+
+            // Видимые из неё грани - связная область вокруг текущей, горизонт - её граница
+            visit_stamp.resize(faces.size(), std::numeric_limits<uint32_t>::max());
+            is_visible.resize(faces.size(), 0);
+            visible.assign(1, current);
+            visit_stamp[current] = current;
+            is_visible[current] = 1;
+            horizon.clear();
+            for (size_t k = 0; k != visible.size(); ++k)
+            {
+                const std::array<uint32_t, 3> corners = faces[visible[k]].vertices;
+                for (size_t i = 0; i != 3; ++i)
+                {
+                    const uint32_t a = corners[i], b = corners[(i + 1) % 3];
+                    const auto neighbor = edges.find(EdgeKey(b, a));
+                    if (neighbor == edges.end())
+                    {
+                        horizon.push_back({a, b});
+                        continue;
+                    }
+                    const uint32_t other = neighbor->second;
+                    if (visit_stamp[other] != current)
+                    {
+                        visit_stamp[other] = current;
+                        is_visible[other] = Height(faces[other], points[eye]) > tolerance;
+                        if (is_visible[other])
+                        {
+                            visible.push_back(other);
+                        }
+                    }
+                    if (!is_visible[other])
+                    {
+                        horizon.push_back({a, b});
+                    }
+                }
+            }
+
+            orphans.clear();
+            for (const uint32_t index : visible)
+            {
+                HullFace &face = faces[index];
+                face.alive = false;
+                for (size_t i = 0; i != 3; ++i)
+                {
+                    const auto edge = edges.find(EdgeKey(face.vertices[i], face.vertices[(i + 1) % 3]));
+                    if (edge != edges.end() && edge->second == index)
+                    {
+                        edges.erase(edge);
+                    }
+                }
+                for (const uint32_t i : face.outside)
+                {
+                    if (i != eye)
+                    {
+                        orphans.push_back(i);
+                    }
+                }
+                std::vector<uint32_t>().swap(face.outside);
+            }
+
+            // Грани от рёбер горизонта к новой вершине сохраняют ориентацию удалённых
+            const size_t first_new = faces.size();
+            for (const std::array<uint32_t, 2> &edge : horizon)
+            {
+                add_face(MakeFace(points, edge[0], edge[1], eye));
+            }
+            for (const uint32_t i : orphans)
+            {
+                for (size_t index = first_new; index != faces.size(); ++index)
+                {
+                    if (Height(faces[index], points[i]) > tolerance)
+                    {
+                        faces[index].outside.push_back(i);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Вершины оболочки и соседство: каждое ребро замкнутой оболочки входит в две
+        // грани с противоположными направлениями, так что исходящие рёбра вершины
+        // перечисляют её соседей по одному разу
+        std::vector<uint32_t> remap(points.size(), std::numeric_limits<uint32_t>::max());
+        std::vector<uint32_t> degree;
+        face_count_ = 0;
+        for (const HullFace &face : faces)
+        {
+            if (!face.alive)
+            {
+                continue;
+            }
+            ++face_count_;
+            for (const uint32_t i : face.vertices)
+            {
+                if (remap[i] == std::numeric_limits<uint32_t>::max())
+                {
+                    remap[i] = static_cast<uint32_t>(vertices_.size());
+                    vertices_.push_back(points[i]);
+                    source_.push_back(i);
+                    degree.push_back(0);
+                }
+                ++degree[remap[i]];
+            }
+        }
+
+        neighbor_offsets_.assign(vertices_.size() + 1, 0);
+        for (size_t i = 0; i != vertices_.size(); ++i)
+        {
+            neighbor_offsets_[i + 1] = neighbor_offsets_[i] + degree[i];
+        }
+        neighbors_.resize(neighbor_offsets_.back());
+        std::vector<uint32_t> cursor(neighbor_offsets_.begin(), neighbor_offsets_.end() - 1);
+        for (const HullFace &face : faces)
+        {
+            if (!face.alive)
+            {
+                continue;
+            }
+            for (size_t i = 0; i != 3; ++i)
+            {
+                neighbors_[cursor[remap[face.vertices[i]]]++] = remap[face.vertices[(i + 1) % 3]];
+            }
+        }
+        tolerance_ = tolerance;
+    }
+
+    uint32_t ConvexBody::VertexCount() const { return static_cast<uint32_t>(vertices_.size()); }
+
+    const Point &ConvexBody::Vertex(const uint32_t index) const { return vertices_[index]; }
+
+    const std::vector<uint32_t> &ConvexBody::SourceIndices() const { return source_; }
+
+    const std::vector<uint32_t> &ConvexBody::NeighborOffsets() const { return neighbor_offsets_; }
+
+    const std::vector<uint32_t> &ConvexBody::Neighbors() const { return neighbors_; }
+
+    size_t ConvexBody::FaceCount() const { return face_count_; }
+
+    double ConvexBody::Tolerance() const { return tolerance_; }
+
+    uint32_t ConvexBody::Support(const Point &direction, const uint32_t start, size_t *steps) const
+    {
+        // Плоское облако - перебор всех точек
+        if (neighbor_offsets_.empty())
+        {
+            uint32_t best = 0;
+            double best_dot = Dot(vertices_[0], direction);
+            for (uint32_t i = 1; i != vertices_.size(); ++i)
+            {
+                const double dot = Dot(vertices_[i], direction);
+                if (dot > best_dot)
+                {
+                    best_dot = dot;
+                    best = i;
+                }
+            }
+            if (steps)
+            {
+                *steps += vertices_.size();
+            }
+            return best;
+        }
+
+        // Подъём к лучшему соседу, пока он есть
+        uint32_t best = start < vertices_.size() ? start : 0;
+        double best_dot = Dot(vertices_[best], direction);
+        size_t visited = 1;
+        for (bool moved = true; moved;)
+        {
+            moved = false;
+            const uint32_t from = best;
+            for (uint32_t k = neighbor_offsets_[from]; k != neighbor_offsets_[from + 1]; ++k)
+            {
+                const double dot = Dot(vertices_[neighbors_[k]], direction);
+                if (dot > best_dot)
+                {
+                    best_dot = dot;
+                    best = neighbors_[k];
+                    moved = true;
+                }
+            }
+            visited += neighbor_offsets_[from + 1] - neighbor_offsets_[from];
+        }
+        if (steps)
+        {
+            *steps += visited;
+        }
+        return best;
+    }
+} // namespace dist
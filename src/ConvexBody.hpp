@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "Vector.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dist
+{
+    /**
+     * Выпуклая оболочка облака точек для GJK. Строится quickhull с допуском Tolerance():
+     * точки, лежащие ближе допуска к оболочке или внутри неё, отбрасываются, так что
+     * любая исходная точка находится не дальше Tolerance() от оболочки. Хранятся только
+     * вершины оболочки и их соседство по рёбрам оболочки (в сжатом виде: соседи вершины i -
+     * Neighbors()[NeighborOffsets()[i] .. NeighborOffsets()[i + 1])).
+     * Опорная функция поднимается от начальной вершины к соседу с большей проекцией:
+     * на выпуклом многограннике локальный максимум глобален, и при близком начальном
+     * направлении обходится несколько вершин вместо всех.
+     * Плоское, вырожденное в отрезок или точку облако оболочки не имеет - тогда вершинами
+     * служат все точки, а опорная функция перебирает их
+     */
+    class ConvexBody
+    {
+    public:
+        using Point = std::array<double, 3>;
+
+        /**
+         * Оболочка точек (например, Distance::GetPointsBody). Для пустого набора
+         * выбрасывается std::invalid_argument
+         */
+        explicit ConvexBody(const std::vector<math::Vector> &points);
+
+        /**
+         * Оболочка вершин сетки
+         */
+        explicit ConvexBody(const math::Mesh &mesh);
+
+        uint32_t VertexCount() const;
+        const Point &Vertex(uint32_t index) const;
+
+        /**
+         * Номер исходной точки (вершины сетки) для каждой вершины оболочки
+         */
+        const std::vector<uint32_t> &SourceIndices() const;
+
+        const std::vector<uint32_t> &NeighborOffsets() const;
+        const std::vector<uint32_t> &Neighbors() const;
+
+        /**
+         * Число граней оболочки (0 для плоского облака)
+         */
+        size_t FaceCount() const;
+
+        /**
+         * Наибольшее расстояние исходной точки до оболочки
+         */
+        double Tolerance() const;
+
+        /**
+         * Номер вершины, наиболее далёкой в направлении direction; подъём начинается
+         * с вершины start (номер вне оболочки - с нулевой). steps, если задан,
+         * увеличивается на число просмотренных вершин
+         */
+        uint32_t Support(const Point &direction, uint32_t start, size_t *steps = nullptr) const;
+
+    private:
+        std::vector<Point> vertices_;
+        std::vector<uint32_t> source_;
+        std::vector<uint32_t> neighbor_offsets_;
+        std::vector<uint32_t> neighbors_;
+        size_t face_count_ = 0;
+        double tolerance_ = 0.0;
+
+        void Build(const std::vector<Point> &points);
+    };
+} // namespace dist
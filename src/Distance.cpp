@@ -1,7 +1,10 @@
 #include "Distance.hpp"
 #include "AABBTree.hpp"
+#include "ReadSTL.hpp"
+#include "Parallel.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <unordered_set>
 
@@ -10,34 +13,96 @@ namespace dist
 
     using namespace math;
 
-    std::vector<Vector> Distance::CollectPoints(const Body &body) const
+    namespace
     {
-        std::unordered_set<Vector, VectorHash> set_points;
-
-        if (body == Body::Body_1)
+        // Потоки на одно из двух тел, которые читаются или строят деревья одновременно:
+        // половина от num_threads (0 - все ядра), чтобы вместе тела не занимали потоков больше ядер
+        size_t ThreadsPerBody(const size_t num_threads)
         {
-            for (const Triangle &triangle : triangles_1_)
+            return std::max<size_t>(parallel::ResolveThreadCount(num_threads) / 2, 1);
+        }
+    } // namespace
+
+    Distance::Distance(Distance &&other) noexcept = default;
+
+    Distance &Distance::operator=(Distance &&other) noexcept = default;
+
+    Distance::~Distance() = default;
+
+    Distance Distance::Load(const std::string &filename_1, const std::string &filename_2,
+                            const read_stl::ReadOptions &options)
+    {
+        const std::string *filenames[2] = {&filename_1, &filename_2};
+        std::shared_ptr<const Mesh> meshes[2];
+        std::unique_ptr<AABBTree> trees[2];
+
+        // Тела независимы: каждое читается и строит дерево в своём потоке,
+        // разбор и построение внутри тела делят половину потоков
+        read_stl::ReadOptions body_options = options;
+        body_options.num_threads = ThreadsPerBody(options.num_threads);
+        const AABBTreeOptions tree_options{.num_threads = body_options.num_threads};
+        parallel::ParallelFor(
+            2,
+            [&](const size_t body)
             {
-                for (size_t i = 0; i != 3; ++i)
+                meshes[body] = std::make_shared<const Mesh>(read_stl::ReadMesh(*filenames[body], body_options));
+                if (!meshes[body]->Empty())
                 {
-                    set_points.insert(triangle.GetPoint(i));
+                    trees[body] = std::make_unique<AABBTree>(meshes[body], tree_options);
                 }
-            }
-        }
-        else if (body == Body::Body_2)
+            },
+            2);
+
+        Distance distance(std::move(meshes[0]), std::move(meshes[1]));
+        distance.tree_1_ = std::move(trees[0]);
+        distance.tree_2_ = std::move(trees[1]);
+        return distance;
+    }
+
+    void Distance::BuildTrees()
+    {
+        if (tree_1_ && tree_2_)
         {
-            for (const Triangle &triangle : triangles_2_)
+            return;
+        }
+
+        const AABBTreeOptions tree_options{.num_threads = ThreadsPerBody(0)};
+        parallel::ParallelFor(
+            2,
+            [&](const size_t body)
             {
-                for (size_t i = 0; i != 3; ++i)
+                std::unique_ptr<AABBTree> &tree = body == 0 ? tree_1_ : tree_2_;
+                if (!tree)
                 {
-                    set_points.insert(triangle.GetPoint(i));
+                    tree = std::make_unique<AABBTree>(body == 0 ? mesh_1_ : mesh_2_, tree_options);
                 }
-            }
-        }
-        else
+            },
+            2);
+    }
+
+    const Mesh &Distance::GetMesh(const Body &body) const
+    {
+        switch (body)
         {
+        case Body::Body_1:
+            return *mesh_1_;
+        case Body::Body_2:
+            return *mesh_2_;
+
+        default:
             throw std::logic_error("Unknown body type!"s);
         }
+    }
+
+    std::vector<Vector> Distance::CollectPoints(const Body &body) const
+    {
+        const Mesh &mesh = GetMesh(body);
+        std::unordered_set<Vector, VectorHash> set_points;
+
+        for (size_t i = 0; i != mesh.VertexCount(); ++i)
+        {
+            set_points.insert(mesh.GetVertex(i));
+        }
 
         std::vector<Vector> result(set_points.begin(), set_points.end());
         return result;
@@ -45,26 +110,13 @@ namespace dist
 
     std::vector<math::MiddlePoint> Distance::CalculationMiddlePoints(const Body &body) const
     {
+        const Mesh &mesh = GetMesh(body);
         std::vector<math::MiddlePoint> result;
+        result.reserve(mesh.TriangleCount());
 
-        switch (body)
+        for (size_t i = 0; i != mesh.TriangleCount(); ++i)
         {
-        case Body::Body_1:
-            for (const Triangle &triangle : triangles_1_)
-            {
-                result.emplace_back(MiddlePoint{triangle.GetNum(), triangle.GetMidlePoint()});
-            }
-            break;
-        case Body::Body_2:
-            for (const Triangle &triangle : triangles_2_)
-            {
-                result.emplace_back(MiddlePoint{triangle.GetNum(), triangle.GetMidlePoint()});
-            }
-            break;
-
-        default:
-            throw std::logic_error("Unknown argument in CalcalationMiddlePoints!"s);
-            break;
+            result.emplace_back(MiddlePoint{i, mesh.GetMidlePoint(i)});
         }
 
         return result;
@@ -72,41 +124,27 @@ namespace dist
 
     std::vector<Triangle> Distance::FindIncidentTriangles(const Body &body, const Vector &target) const
     {
-        std::unordered_set<Triangle, TriangleHash> set_triangles;
+        const Mesh &mesh = GetMesh(body);
+        std::vector<Triangle> result;
 
-        switch (body)
+        for (size_t i = 0; i != mesh.TriangleCount(); ++i)
         {
-        case Body::Body_1:
-            for (const Triangle &triangle : triangles_1_)
-            {
-                if (triangle.IsContainPoint(target.GetNum()))
-                {
-                    set_triangles.insert(triangle);
-                }
-            }
-            break;
-        case Body::Body_2:
-            for (const Triangle &triangle : triangles_2_)
+            for (size_t j = 0; j != 3; ++j)
             {
-                if (triangle.IsContainPoint(target.GetNum()))
+                if (mesh.Index(i, j) == target.GetNum())
                 {
-                    set_triangles.insert(triangle);
+                    result.push_back(mesh.GetTriangle(i));
+                    break;
                 }
             }
-            break;
-
-        default:
-            throw std::logic_error("Unknown argument in FindIncidentTriangles!"s);
-            break;
         }
 
-        std::vector<Triangle> result(set_triangles.begin(), set_triangles.end());
         return result;
     }
 
     void Distance::CollectPointsFromBodys()
     {
-        if (triangles_1_.empty() || triangles_2_.empty())
+        if (mesh_1_->Empty() || mesh_2_->Empty())
         {
             throw std::logic_error("Triangles are empty! Cannot collect points."s);
         }
@@ -180,17 +218,107 @@ namespace dist
 
     double Distance::FindDistanceBetweenBody()
     {
-        AABBTree tree_1(triangles_1_);
-        AABBTree tree_2(triangles_2_);
+        BuildTrees();
+
+        return FindDistanceBetweenBody(*tree_1_, *tree_2_);
+    }
+
+    double Distance::ConvexLowerBound()
+    {
+        if (!hull_1_ || !hull_2_)
+        {
+            hull_1_ = std::make_unique<ConvexBody>(*mesh_1_);
+            hull_2_ = std::make_unique<ConvexBody>(*mesh_2_);
+        }
+
+        std::array<double, 3> axis{};
+        if (GJK::Distance(*hull_1_, *hull_2_, hull_simplex_, std::numeric_limits<double>::infinity(), nullptr,
+                          &axis) == 0.0)
+        {
+            return 0.0;
+        }
+
+        // Первое тело лежит по направлению axis от второго
+        const auto projections = [&axis](const Mesh &mesh)
+        {
+            std::pair<double, double> range = {std::numeric_limits<double>::max(),
+                                               std::numeric_limits<double>::lowest()};
+            for (uint32_t i = 0; i != mesh.VertexCount(); ++i)
+            {
+                const double projection = axis[0] * mesh.Coord(i, 0) + axis[1] * mesh.Coord(i, 1) +
+                                          axis[2] * mesh.Coord(i, 2);
+                range.first = std::min(range.first, projection);
+                range.second = std::max(range.second, projection);
+            }
+            return range;
+        };
+        const double gap = projections(*mesh_1_).first - projections(*mesh_2_).second;
+        const double length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        return std::max(gap / length, 0.0);
+    }
+
+    double Distance::ErrorBound() const
+    {
+        return mesh_1_->RoundingError() + mesh_2_->RoundingError();
+    }
 
+    double Distance::FindDistanceBetweenBody(const AABBTree &tree_1, const AABBTree &tree_2)
+    {
         double distance = 0.0;
-        const Triangle *tr_1 = nullptr, *tr_2 = nullptr;
+        size_t tr_1 = AABBTree::kNoTriangle, tr_2 = AABBTree::kNoTriangle;
         tree_1.FindClosestTriangles(tree_2, tr_1, tr_2, distance);
+        if (tr_1 == AABBTree::kNoTriangle || tr_2 == AABBTree::kNoTriangle)
+        {
+            throw std::invalid_argument("Bodys cannot be empty!"s);
+        }
 
-        closest_triangle_1_ = *tr_1;
-        closest_triangle_2_ = *tr_2;
+        closest_triangle_1_ = tree_1.GetMesh().GetTriangle(tr_1);
+        closest_triangle_2_ = tree_2.GetMesh().GetTriangle(tr_2);
 
         return distance;
     }
 
+    double Distance::FindDistanceToStream(const AABBTree &tree, read_stl::StlStream &stream,
+                                          size_t &closest_1, size_t &closest_2)
+    {
+        double min_distance = std::numeric_limits<double>::max();
+        closest_1 = AABBTree::kNoTriangle;
+        closest_2 = AABBTree::kNoTriangle;
+
+        std::vector<Triangle> batch;
+        while (stream.NextBatch(batch))
+        {
+            AABBTree batch_tree(batch);
+
+            double distance = 0.0;
+            size_t tr_1 = AABBTree::kNoTriangle, tr_2 = AABBTree::kNoTriangle;
+            tree.FindClosestTriangles(batch_tree, tr_1, tr_2, distance);
+            if (tr_1 == AABBTree::kNoTriangle || tr_2 == AABBTree::kNoTriangle)
+            {
+                continue;
+            }
+
+            // Номер треугольника порции в потоке хранит сам треугольник
+            if (distance < min_distance)
+            {
+                min_distance = distance;
+                closest_1 = tr_1;
+                closest_2 = batch[tr_2].GetNum();
+            }
+        }
+
+        if (closest_1 == AABBTree::kNoTriangle)
+        {
+            throw std::invalid_argument("Bodys cannot be empty!"s);
+        }
+
+        return min_distance;
+    }
+
+    double Distance::FindDistanceToStream(const AABBTree &tree, read_stl::StlStream &stream)
+    {
+        size_t closest_1 = AABBTree::kNoTriangle, closest_2 = AABBTree::kNoTriangle;
+        return FindDistanceToStream(tree, stream, closest_1, closest_2);
+    }
+
 } // namespace dist
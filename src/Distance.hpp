@@ -2,16 +2,29 @@
 
 #include "Vector.hpp"
 #include "Triangle.hpp"
+#include "Mesh.hpp"
 #include "MathOperations.hpp"
 #include "KDTree.hpp"
 #include "GJK.hpp"
 #include "MiddlePoint.hpp"
 
+#include <memory>
 #include <vector>
 #include <stdexcept>
 #include <string>
 #include <iostream>
 
+namespace math
+{
+    class AABBTree;
+} // namespace math
+
+namespace read_stl
+{
+    class StlStream;
+    struct ReadOptions;
+} // namespace read_stl
+
 namespace dist
 {
     using namespace std::string_literals;
@@ -25,8 +38,17 @@ namespace dist
     class Distance
     {
     private:
-        std::vector<math::Triangle> triangles_1_;
-        std::vector<math::Triangle> triangles_2_;
+        std::shared_ptr<const math::Mesh> mesh_1_;
+        std::shared_ptr<const math::Mesh> mesh_2_;
+
+        // Деревья тел (строятся при первом вычислении или при загрузке в Load)
+        std::unique_ptr<math::AABBTree> tree_1_;
+        std::unique_ptr<math::AABBTree> tree_2_;
+
+        // Выпуклые оболочки вершин тел (строятся при первом вызове ConvexLowerBound)
+        std::unique_ptr<ConvexBody> hull_1_;
+        std::unique_ptr<ConvexBody> hull_2_;
+        GJKSimplex hull_simplex_;
 
         std::vector<math::Vector> points_body_1_;
         std::vector<math::Vector> points_body_2_;
@@ -37,23 +59,84 @@ namespace dist
         std::vector<math::Vector> CollectPoints(const Body &body) const;
         std::vector<math::MiddlePoint> CalculationMiddlePoints(const Body &body) const;
         std::vector<math::Triangle> FindIncidentTriangles(const Body &body, const math::Vector &target) const;
+        const math::Mesh &GetMesh(const Body &body) const;
+        void BuildTrees();
 
     public:
-        Distance(const std::vector<math::Triangle> &triangles_1, const std::vector<math::Triangle> &triangles_2) : triangles_1_(triangles_1),
-                                                                                                                   triangles_2_(triangles_2)
+        Distance(const std::vector<math::Triangle> &triangles_1, const std::vector<math::Triangle> &triangles_2)
+            : Distance(std::make_shared<const math::Mesh>(math::Mesh::FromTriangles(triangles_1)),
+                       std::make_shared<const math::Mesh>(math::Mesh::FromTriangles(triangles_2)))
         {
-            if (triangles_1_.empty() || triangles_2_.empty())
+        }
+
+        /**
+         * Тела, заданные сетками. Сетки не копируются и могут разделяться с деревьями
+         */
+        Distance(std::shared_ptr<const math::Mesh> mesh_1, std::shared_ptr<const math::Mesh> mesh_2)
+            : mesh_1_(std::move(mesh_1)), mesh_2_(std::move(mesh_2))
+        {
+            if (!mesh_1_ || !mesh_2_ || mesh_1_->Empty() || mesh_2_->Empty())
             {
                 throw std::invalid_argument("Bodys cannot be empty!"s);
             }
         }
 
+        Distance(Distance &&other) noexcept;
+        Distance &operator=(Distance &&other) noexcept;
+        ~Distance();
+
+        /**
+         * Конвейерная загрузка двух тел: каждое тело читается и сразу получает
+         * своё дерево в отдельном потоке, так что построение дерева одного тела
+         * идёт одновременно с разбором другого. options.num_threads (0 - все ядра) -
+         * потоки на оба тела: разбор и построение дерева каждого тела получают половину.
+         * Ошибки чтения передаются исключениями
+         */
+        static Distance Load(const std::string &filename_1, const std::string &filename_2,
+                             const read_stl::ReadOptions &options);
+
         void CollectPointsFromBodys();
         const std::vector<math::Vector> &GetPointsBody(const Body &body) const;
 
         std::pair<math::Vector, math::Vector> ClosestPointsKDTree() const;
 
+        /**
+         * Расстояние между телами. Если деревья ещё не построены, они строятся
+         * одновременно в двух потоках (каждое - на половине ядер) и сохраняются
+         * для повторных вызовов
+         */
         double FindDistanceBetweenBody();
+
+        /**
+         * Нижняя оценка расстояния между телами без обхода деревьев: GJK по выпуклым
+         * оболочкам вершин тел даёт направление, и оценка - зазор между проекциями
+         * всех вершин тел на него, поэтому допуск оболочек её не нарушает.
+         * 0, если оболочки пересекаются
+         */
+        double ConvexLowerBound();
+
+        /**
+         * Граница погрешности найденного расстояния относительно исходной геометрии:
+         * сумма Mesh::RoundingError() тел (0, если обе сетки хранятся в double
+         * или получены из бинарного STL без сварки с допуском)
+         */
+        double ErrorBound() const;
+
+        /**
+         * Расстояние между телами по уже построенным деревьям (например, из MeshCache)
+         */
+        double FindDistanceBetweenBody(const math::AABBTree &tree_1, const math::AABBTree &tree_2);
+
+        /**
+         * Расстояние от тела, заданного деревом, до тела из потокового STL-файла.
+         * Для каждой порции строится своё дерево, поэтому второе тело целиком
+         * в памяти не хранится. closest_1 - номер ближайшего треугольника в сетке дерева,
+         * closest_2 - номер ближайшего треугольника в потоке (в порядке чтения).
+         * Если дерево пустое или в потоке нет треугольников, выбрасывается std::invalid_argument
+         */
+        static double FindDistanceToStream(const math::AABBTree &tree, read_stl::StlStream &stream,
+                                           size_t &closest_1, size_t &closest_2);
+        static double FindDistanceToStream(const math::AABBTree &tree, read_stl::StlStream &stream);
     };
 
 } // namespace dist
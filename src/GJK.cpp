@@ -1,144 +1,394 @@
 #include "GJK.hpp"
-#include <limits>
+#include "MathOperations.hpp"
+#include "Vec3.hpp"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace dist
 {
     using namespace math;
 
-    Vector GJK::Support(const Triangle &a, const Triangle &b, const Vector &direction)
+    namespace
     {
-        // Найти самую дальнюю точку на треугольнике A в направлении direction
-        Vector farthest_A = a.GetPoint(0);
-        double max_dot_A = farthest_A * direction;
+        using vec3::Along;
+        using vec3::Cross;
+        using vec3::Dot;
+        using vec3::Point;
+        using vec3::Sub;
+
+        // Относительная точность сходимости: итерация не приближает симплекс к началу
+        // координат больше чем на эту долю квадрата расстояния
+        constexpr double kRelativeTolerance = 1e-12;
 
-        for (size_t i = 1; i < 3; ++i)
+        // Квадрат расстояния, меньший этой доли квадрата размера симплекса, считается касанием
+        constexpr double kZeroTolerance = 1e-24;
+
+        // Треугольник как выпуклая оболочка трёх вершин
+        struct TriangleShape
         {
-            Vector point = a.GetPoint(i);
-            double dot = point * direction;
-            if (dot > max_dot_A)
+            std::array<Point, 3> points;
+
+            explicit TriangleShape(const Triangle &triangle)
             {
-                max_dot_A = dot;
-                farthest_A = point;
+                for (size_t i = 0; i != 3; ++i)
+                {
+                    const Vector &point = triangle.GetPoint(i);
+                    points[i] = {point[0], point[1], point[2]};
+                }
             }
-        }
 
-        // Найти самую дальнюю точку на треугольнике B в противоположном направлении
-        Vector farthest_B = b.GetPoint(0);
-        double max_dot_B = farthest_B * (-direction);
+            uint32_t VertexCount() const { return 3; }
 
-        for (size_t i = 1; i < 3; ++i)
-        {
-            Vector point = b.GetPoint(i);
-            double dot = point * (-direction);
-            if (dot > max_dot_B)
+            const Point &Vertex(const uint32_t index) const { return points[index]; }
+
+            // Номер вершины, наиболее далёкой в направлении direction (трёх вершин
+            // достаточно перебрать, начальная вершина не нужна)
+            uint32_t Support(const Point &direction, uint32_t, size_t *) const
             {
-                max_dot_B = dot;
-                farthest_B = point;
+                uint32_t best = 0;
+                double best_dot = Dot(points[0], direction);
+                for (uint32_t i = 1; i != 3; ++i)
+                {
+                    const double dot = Dot(points[i], direction);
+                    if (dot > best_dot)
+                    {
+                        best_dot = dot;
+                        best = i;
+                    }
+                }
+                return best;
             }
-        }
+        };
 
-        // Возвращаем разность между двумя точками
-        return farthest_A - farthest_B;
-    }
-
-    bool HandleSimplex(std::vector<Vector> &simplex, Vector &direction)
-    {
-        // Обработка симплекса в зависимости от его размера
-        if (simplex.size() == 2)
+        // Точки симплекса вместе с номерами вершин тел, на которых они построены
+        struct SimplexPoints
         {
-            // Симплекс — отрезок
-            Vector a = simplex[1];
-            Vector b = simplex[0];
-            Vector ab = b - a;
-            Vector ao = -a;
-
-            // Направление перпендикулярно отрезку AB в сторону начала координат
-            direction = ab % (ao % ab);
-            return false;
-        }
-        else if (simplex.size() == 3)
+            std::array<Point, 4> points;
+            GJKSimplex &simplex;
+
+            // Оставить в симплексе только вершины с номерами kept (по возрастанию)
+            void Keep(const std::array<uint8_t, 4> &kept, const size_t count)
+            {
+                for (size_t i = 0; i != count; ++i)
+                {
+                    points[i] = points[kept[i]];
+                    simplex.vertices[i] = simplex.vertices[kept[i]];
+                }
+                simplex.size = count;
+            }
+        };
+
+        // Ближайшая к началу координат точка отрезка или треугольника из вершин simplex
+        // с номерами indices (Эриксон, 5.1.2 и 5.1.5); в kept - вершины, на которые она опирается
+        Point ClosestOnTriangle(const std::array<Point, 4> &points, const std::array<uint8_t, 3> &indices,
+                                std::array<uint8_t, 4> &kept, size_t &num_kept)
         {
-            // Симплекс — треугольник
-            Vector a = simplex[2];
-            Vector b = simplex[1];
-            Vector c = simplex[0];
-            Vector ab = b - a;
-            Vector ac = c - a;
-            Vector ao = -a;
+            const Point &a = points[indices[0]];
+            const Point &b = points[indices[1]];
+            const Point &c = points[indices[2]];
+            const Point ab = Sub(b, a), ac = Sub(c, a);
 
-            // Нормаль к плоскости треугольника
-            Vector abc = ab % ac;
+            const auto vertex = [&](const size_t i)
+            {
+                kept[0] = indices[i];
+                num_kept = 1;
+                return points[indices[i]];
+            };
+            const auto edge = [&](const size_t i, const size_t j, const Point &start, const Point &d, const double t)
+            {
+                kept[0] = std::min(indices[i], indices[j]);
+                kept[1] = std::max(indices[i], indices[j]);
+                num_kept = 2;
+                return Along(start, d, t);
+            };
 
-            // Проверяем, в какую сторону направлено направление
-            if ((abc % ac) * ao > 0)
+            const double d1 = -Dot(ab, a), d2 = -Dot(ac, a);
+            if (d1 <= 0.0 && d2 <= 0.0)
             {
-                // Точка находится за ребром AC
-                simplex.erase(simplex.begin() + 1); // Удаляем B
-                direction = ac % (ao % ac);
+                return vertex(0);
             }
-            else if ((ab % abc) * ao > 0)
+            const double d3 = -Dot(ab, b), d4 = -Dot(ac, b);
+            if (d3 >= 0.0 && d4 <= d3)
             {
-                // Точка находится за ребром AB
-                simplex.erase(simplex.begin()); // Удаляем C
-                direction = ab % (ao % ab);
+                return vertex(1);
             }
-            else
+            const double vc = d1 * d4 - d3 * d2;
+            if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
             {
-                // Точка находится внутри треугольника
-                direction = abc;
-                if (abc * ao < 0)
+                return edge(0, 1, a, ab, d1 / (d1 - d3));
+            }
+            const double d5 = -Dot(ab, c), d6 = -Dot(ac, c);
+            if (d6 >= 0.0 && d5 <= d6)
+            {
+                return vertex(2);
+            }
+            const double vb = d5 * d2 - d1 * d6;
+            if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+            {
+                return edge(0, 2, a, ac, d2 / (d2 - d6));
+            }
+            const double va = d3 * d6 - d5 * d4;
+            if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+            {
+                return edge(1, 2, b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            }
+
+            const double sum = va + vb + vc;
+            if (sum <= 0.0)
+            {
+                // Вырожденный (отрезок) треугольник, начало координат напротив середины
+                // отрезка: ближайшая из точек рёбер
+                std::array<uint8_t, 4> edge_kept{};
+                size_t edge_count = 0;
+                Point best = vertex(0);
+                for (size_t i = 0; i != 3; ++i)
+                {
+                    const size_t j = (i + 1) % 3;
+                    const Point &p = points[indices[i]];
+                    const Point d = Sub(points[indices[j]], p);
+                    const double length = Dot(d, d);
+                    const double t = length > 0.0 ? std::clamp(-Dot(p, d) / length, 0.0, 1.0) : 0.0;
+                    const Point candidate = edge(i, j, p, d, t);
+                    if (Dot(candidate, candidate) < Dot(best, best))
+                    {
+                        best = candidate;
+                        edge_kept = kept;
+                        edge_count = num_kept;
+                    }
+                }
+                if (edge_count == 0)
                 {
-                    direction = -abc;
+                    return vertex(0);
                 }
+                kept = edge_kept;
+                num_kept = edge_count;
+                return best;
             }
-            return false;
-        }
-        else if (simplex.size() == 4)
-        {
-            // Симплекс — тетраэдр
-            return true; // Пересечение найдено
+
+            kept = {indices[0], indices[1], indices[2], 0};
+            std::sort(kept.begin(), kept.begin() + 3);
+            num_kept = 3;
+            const double denom = 1.0 / sum;
+            return Along(Along(a, ab, vb * denom), ac, vc * denom);
         }
 
-        return false;
-    }
+        // Ближайшая к началу координат точка симплекса, симплекс сокращается до вершин,
+        // на которые она опирается. false - начало координат внутри тетраэдра
+        bool ReduceSimplex(SimplexPoints &simplex, Point &closest)
+        {
+            std::array<Point, 4> &points = simplex.points;
+            std::array<uint8_t, 4> kept{};
+            size_t num_kept = 0;
+            switch (simplex.simplex.size)
+            {
+            case 1:
+                closest = points[0];
+                return true;
+            case 2:
+            {
+                const Point d = Sub(points[1], points[0]);
+                const double length = Dot(d, d);
+                const double t = length > 0.0 ? -Dot(points[0], d) / length : 0.0;
+                if (t <= 0.0)
+                {
+                    simplex.Keep({0, 0, 0, 0}, 1);
+                }
+                else if (t >= 1.0)
+                {
+                    simplex.Keep({1, 0, 0, 0}, 1);
+                }
+                else
+                {
+                    closest = Along(points[0], d, t);
+                    return true;
+                }
+                closest = points[0];
+                return true;
+            }
+            case 3:
+                closest = ClosestOnTriangle(points, {0, 1, 2}, kept, num_kept);
+                simplex.Keep(kept, num_kept);
+                return true;
+            default:
+                break;
+            }
 
-    double GJK::Distance(const Triangle &a, const Triangle &b)
-    {
-        // Начальное направление
-        Vector direction = a.GetPoint(0) - b.GetPoint(0);
+            // Тетраэдр: грани, с внешней стороны которых лежит начало координат (для
+            // плоского тетраэдра - все грани), и ближайшая из их точек
+            constexpr std::array<std::array<uint8_t, 4>, 4> kFaces = {{{0, 1, 2, 3}, {0, 1, 3, 2},
+                                                                       {0, 2, 3, 1}, {1, 2, 3, 0}}};
+            double best_squared = std::numeric_limits<double>::max();
+            bool outside = false;
+            for (const std::array<uint8_t, 4> &face : kFaces)
+            {
+                const Point &a = points[face[0]];
+                const Point normal = Cross(Sub(points[face[1]], a), Sub(points[face[2]], a));
+                const double origin_side = -Dot(a, normal);
+                const double opposite_side = Dot(Sub(points[face[3]], a), normal);
+                if (origin_side * opposite_side > 0.0)
+                {
+                    continue;
+                }
+                outside = true;
+                std::array<uint8_t, 4> face_kept{};
+                size_t face_count = 0;
+                const Point candidate = ClosestOnTriangle(points, {face[0], face[1], face[2]}, face_kept, face_count);
+                if (Dot(candidate, candidate) < best_squared)
+                {
+                    best_squared = Dot(candidate, candidate);
+                    closest = candidate;
+                    kept = face_kept;
+                    num_kept = face_count;
+                }
+            }
+            if (!outside)
+            {
+                return false;
+            }
+            simplex.Keep(kept, num_kept);
+            return true;
+        }
 
-        // Если начальное направление равно нулю, задаём произвольное
-        if (direction * direction == 0)
+        // GJK по опорным функциям двух выпуклых тел с начальным симплексом simplex.
+        // В axis, если задан, записывается ближайшая точка разности тел
+        template <typename ShapeA, typename ShapeB>
+        double RunGJK(const ShapeA &shape_a, const ShapeB &shape_b, GJKSimplex &simplex, const double bound,
+                      GJKStats *stats, Point *axis = nullptr)
         {
-            direction = Vector{1.0, 0.0, 0.0};
-        }
+            if (stats)
+            {
+                ++stats->queries;
+            }
 
-        // Построение симплекса
-        std::vector<Vector> simplex;
-        simplex.push_back(Support(a, b, direction));
+            // Начальный симплекс проверяется: номера вершин могли остаться от других тел
+            const auto valid = [&](const std::array<uint32_t, 2> &vertex)
+            { return vertex[0] < shape_a.VertexCount() && vertex[1] < shape_b.VertexCount(); };
+            if (simplex.size == 0 || simplex.size > 4 ||
+                !std::all_of(simplex.vertices.begin(), simplex.vertices.begin() + static_cast<std::ptrdiff_t>(simplex.size),
+                             valid))
+            {
+                simplex.vertices[0] = {0, 0};
+                simplex.size = 1;
+            }
 
-        // Инвертируем направление
-        direction = -simplex[0];
+            SimplexPoints points{{}, simplex};
+            for (size_t i = 0; i != simplex.size; ++i)
+            {
+                points.points[i] = Sub(shape_a.Vertex(simplex.vertices[i][0]), shape_b.Vertex(simplex.vertices[i][1]));
+            }
 
-        while (true)
-        {
-            // Добавляем новую точку в симплекс
-            Vector new_point = Support(a, b, direction);
+            // Опорная вершина ищется от предыдущей опорной вершины того же тела
+            std::array<uint32_t, 2> start = simplex.vertices[simplex.size - 1];
+            size_t *steps = stats ? &stats->support_steps : nullptr;
 
-            // Если новая точка не проходит проверку, возвращаем расстояние
-            if (new_point * direction <= 0)
+            Point closest{};
+            const auto result = [&](const double distance)
             {
-                return std::sqrt(direction * direction);
+                if (axis)
+                {
+                    *axis = distance > 0.0 ? closest : Point{};
+                }
+                return distance;
+            };
+            if (!ReduceSimplex(points, closest))
+            {
+                return result(0.0);
             }
+            double lower = 0.0;
+            for (size_t iteration = 0; iteration != GJK::kMaxIterations; ++iteration)
+            {
+                const double squared = Dot(closest, closest);
+                double scale = 0.0;
+                for (size_t i = 0; i != simplex.size; ++i)
+                {
+                    scale = std::max(scale, Dot(points.points[i], points.points[i]));
+                }
+                if (squared <= kZeroTolerance * scale)
+                {
+                    return result(0.0);
+                }
 
-            simplex.push_back(new_point);
+                // Опорная точка разности Минковского в направлении к началу координат
+                const Point direction = {-closest[0], -closest[1], -closest[2]};
+                const std::array<uint32_t, 2> vertex = {shape_a.Support(direction, start[0], steps),
+                                                        shape_b.Support(closest, start[1], steps)};
+                start = vertex;
+                const Point support = Sub(shape_a.Vertex(vertex[0]), shape_b.Vertex(vertex[1]));
+                if (stats)
+                {
+                    ++stats->iterations;
+                }
 
-            // Обновляем симплекс и направление
-            if (HandleSimplex(simplex, direction))
+                // Вся разность Минковского лежит по ту же сторону плоскости с нормалью closest
+                // через опорную точку, что и симплекс: её расстояние до начала координат -
+                // нижняя оценка искомого
+                const double along = Dot(closest, support);
+                if (along > 0.0 && along * along >= bound * bound * squared)
+                {
+                    return result(std::max(along / std::sqrt(squared), bound));
+                }
+                if (along > 0.0)
+                {
+                    lower = std::max(lower, along / std::sqrt(squared));
+                }
+
+                // Опорная точка не приближает симплекс к началу координат - минимум найден
+                const bool repeated = std::any_of(simplex.vertices.begin(),
+                                                  simplex.vertices.begin() + static_cast<std::ptrdiff_t>(simplex.size),
+                                                  [&vertex](const std::array<uint32_t, 2> &known)
+                                                  { return known == vertex; });
+                if (repeated || squared - along <= kRelativeTolerance * squared)
+                {
+                    return result(std::sqrt(squared));
+                }
+
+                points.points[simplex.size] = support;
+                simplex.vertices[simplex.size] = vertex;
+                ++simplex.size;
+                if (!ReduceSimplex(points, closest))
+                {
+                    return result(0.0);
+                }
+            }
+
+            // Точность не достигнута: лучшая из доказанных нижних оценок
+            return result(lower);
+        }
+    } // namespace
+
+    double GJK::Distance(const Triangle &a, const Triangle &b, const double bound)
+    {
+        GJKSimplex simplex;
+        return Distance(a, b, simplex, bound);
+    }
+
+    double GJK::Distance(const Triangle &a, const Triangle &b, GJKSimplex &simplex, const double bound,
+                         GJKStats *stats)
+    {
+        // Пара, которая не может улучшить результат вызывающего
+        if (bound != std::numeric_limits<double>::infinity())
+        {
+            const double separation = PlaneSeparation(a, b);
+            if (separation >= bound)
             {
-                return 0.0; // Треугольники пересекаются
+                return separation;
             }
         }
+
+        return RunGJK(TriangleShape(a), TriangleShape(b), simplex, bound, stats);
+    }
+
+    double GJK::Distance(const ConvexBody &a, const ConvexBody &b, const double bound)
+    {
+        GJKSimplex simplex;
+        return Distance(a, b, simplex, bound);
+    }
+
+    double GJK::Distance(const ConvexBody &a, const ConvexBody &b, GJKSimplex &simplex, const double bound,
+                         GJKStats *stats, std::array<double, 3> *axis)
+    {
+        return RunGJK(a, b, simplex, bound, stats, axis);
     }
-} // namespace dist
\ No newline at end of file
+} // namespace dist
@@ -1,19 +1,80 @@
 #pragma once
 
+#include "ConvexBody.hpp"
 #include "Triangle.hpp"
 #include "Vector.hpp"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
 namespace dist
 {
-    class GJK
+    /**
+     * Симплекс GJK: до четырёх точек разности Минковского, каждая задана номерами
+     * вершин первого и второго тела. Хранится на месте, без выделения памяти.
+     * После запроса в нём остаются точки, на которые опирается ближайшая точка;
+     * переданный в следующий запрос к тем же или немного сдвинутым телам, он служит
+     * начальным, и поиск сходится за одну-две итерации
+     */
+    struct GJKSimplex
+    {
+        std::array<std::array<uint32_t, 2>, 4> vertices{};
+        size_t size = 0;
+    };
+
+    /**
+     * Счётчики запросов GJK
+     */
+    struct GJKStats
     {
-    private:
-        static math::Vector Support(const math::Triangle &a, const math::Triangle &b, const math::Vector &direction);
+        size_t queries = 0;
+        size_t iterations = 0;    // Вычисленные опорные точки
+        size_t support_steps = 0; // Вершины, просмотренные опорными функциями выпуклых тел
+    };
 
+    class GJK
+    {
     public:
+        static constexpr size_t kMaxIterations = 64;
+
         GJK();
         ~GJK();
 
-        static double Distance(const math::Triangle &a, const math::Triangle &b);
+        /**
+         * Расстояние между треугольниками. bound - текущий лучший результат вызывающего:
+         * если треугольники разделены плоскостью одного из них не ближе bound
+         * (math::PlaneSeparation), итерации не выполняются и возвращается эта оценка
+         */
+        static double Distance(const math::Triangle &a, const math::Triangle &b,
+                               double bound = std::numeric_limits<double>::infinity());
+
+        /**
+         * То же с начальным симплексом simplex (пустой - начать с разности первых вершин),
+         * в который записывается итоговый. Поиск прекращается и с возвратом нижней оценки
+         * (не меньше bound), как только опорная точка доказывает, что расстояние не меньше bound
+         */
+        static double Distance(const math::Triangle &a, const math::Triangle &b, GJKSimplex &simplex,
+                               double bound = std::numeric_limits<double>::infinity(),
+                               GJKStats *stats = nullptr);
+
+        /**
+         * Расстояние между выпуклыми оболочками (с точностью до их Tolerance()).
+         * Опорные вершины ищутся подъёмом от опорных вершин прошлой итерации,
+         * а в первой - от вершин начального симплекса
+         */
+        static double Distance(const ConvexBody &a, const ConvexBody &b,
+                               double bound = std::numeric_limits<double>::infinity());
+
+        /**
+         * То же с начальным симплексом, как для треугольников. В axis, если задан,
+         * записывается разность ближайших точек оболочек (от b к a; нулевая при касании).
+         * Если за kMaxIterations итераций точность не достигнута, возвращается лучшая
+         * доказанная нижняя оценка
+         */
+        static double Distance(const ConvexBody &a, const ConvexBody &b, GJKSimplex &simplex,
+                               double bound = std::numeric_limits<double>::infinity(),
+                               GJKStats *stats = nullptr, std::array<double, 3> *axis = nullptr);
     };
 } // namespace dist
@@ -7,67 +7,114 @@ namespace math
 {
     using namespace std::string_literals;
 
+    KDTree::KDTree(std::vector<Vector> &points)
+        : mesh_(std::make_shared<const Mesh>(Mesh::FromPoints(points))), k_(3)
+    {
+        nums_.reserve(points.size());
+        for (const Vector &point : points)
+        {
+            nums_.push_back(point.GetNum());
+        }
+
+        order_.resize(mesh_->VertexCount());
+        for (size_t i = 0; i != order_.size(); ++i)
+        {
+            order_[i] = static_cast<uint32_t>(i);
+        }
+        BuildTree(0, order_.size(), 0);
+    }
+
+    KDTree::KDTree(std::shared_ptr<const Mesh> mesh)
+        : mesh_(std::move(mesh)), k_(3)
+    {
+        order_.resize(mesh_->VertexCount());
+        for (size_t i = 0; i != order_.size(); ++i)
+        {
+            order_[i] = static_cast<uint32_t>(i);
+        }
+        BuildTree(0, order_.size(), 0);
+    }
+
     Vector KDTree::NearestNeighbor(const Vector &target) const
     {
-        if (!root_)
+        if (order_.empty())
         {
             throw std::runtime_error("KDTree is empty. Cannot find nearest neighbor."s);
         }
 
-        Vector best;
+        uint32_t best = order_.front();
         double best_dist = std::numeric_limits<double>::max();
-        NearestNeighborSearch(root_.get(), target, 0, best, best_dist);
-        return best;
+        NearestNeighborSearch(0, order_.size(), target, 0, best, best_dist);
+
+        Vector result = mesh_->GetVertex(best);
+        if (!nums_.empty())
+        {
+            result.SetNum(nums_[best]);
+        }
+        return result;
     }
 
-    std::unique_ptr<KDTree::Node> KDTree::BuildTree(std::vector<Vector>::iterator begin, std::vector<Vector>::iterator end, size_t depth)
+    void KDTree::BuildTree(size_t begin, size_t end, size_t depth)
     {
         if (begin >= end)
-            return nullptr;
+            return;
 
         size_t axis = depth % k_;
-        auto mid = begin + (end - begin) / 2;
-
-        std::nth_element(begin, mid, end, [axis](const Vector &a, const Vector &b)
-                         { return a[axis] < b[axis]; });
+        size_t mid = begin + (end - begin) / 2;
 
-        auto node = std::make_unique<Node>(*mid);
-        node->left = BuildTree(begin, mid, depth + 1);
-        node->right = BuildTree(mid + 1, end, depth + 1);
+        const Mesh &mesh = *mesh_;
+        std::nth_element(order_.begin() + static_cast<std::ptrdiff_t>(begin),
+                         order_.begin() + static_cast<std::ptrdiff_t>(mid),
+                         order_.begin() + static_cast<std::ptrdiff_t>(end),
+                         [axis, &mesh](const uint32_t a, const uint32_t b)
+                         { return mesh.Coord(a, axis) < mesh.Coord(b, axis); });
 
-        return node;
+        BuildTree(begin, mid, depth + 1);
+        BuildTree(mid + 1, end, depth + 1);
     }
 
-    void KDTree::NearestNeighborSearch(const Node *node, const Vector &target, size_t depth, Vector &best, double &best_dist) const
+    void KDTree::NearestNeighborSearch(size_t begin, size_t end, const Vector &target, size_t depth,
+                                       uint32_t &best, double &best_dist) const
     {
-        if (!node)
+        if (begin >= end)
             return;
 
+        const size_t mid = begin + (end - begin) / 2;
+        const uint32_t node = order_[mid];
+
         // Вычисление расстояния
         double dist = 0;
         for (size_t i = 0; i < 3; ++i)
         {
-            dist += std::pow(node->point[i] - target[i], 2);
+            dist += std::pow(mesh_->Coord(node, i) - target[i], 2);
         }
 
         if (dist < best_dist && dist > 0)
         {
-            best = node->point;
+            best = node;
             best_dist = dist;
         }
 
         size_t axis = depth % k_;
-        double diff = target[axis] - node->point[axis];
+        double diff = target[axis] - mesh_->Coord(node, axis);
         double diff_squared = diff * diff;
 
-        const Node *first = diff < 0 ? node->left.get() : node->right.get();
-        const Node *second = diff < 0 ? node->right.get() : node->left.get();
-
-        NearestNeighborSearch(first, target, depth + 1, best, best_dist);
-
-        if (diff_squared < best_dist)
+        // Левое поддерево - [begin, mid), правое - [mid + 1, end)
+        if (diff < 0)
+        {
+            NearestNeighborSearch(begin, mid, target, depth + 1, best, best_dist);
+            if (diff_squared < best_dist)
+            {
+                NearestNeighborSearch(mid + 1, end, target, depth + 1, best, best_dist);
+            }
+        }
+        else
         {
-            NearestNeighborSearch(second, target, depth + 1, best, best_dist);
+            NearestNeighborSearch(mid + 1, end, target, depth + 1, best, best_dist);
+            if (diff_squared < best_dist)
+            {
+                NearestNeighborSearch(begin, mid, target, depth + 1, best, best_dist);
+            }
         }
     }
 } // namespace math
@@ -1,38 +1,36 @@
 #pragma once
 
+#include "Mesh.hpp"
 #include "Vector.hpp"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 namespace math
 {
+    /**
+     * KD-дерево над вершинами сетки. Узлы не хранятся отдельно: дерево задаётся
+     * перестановкой номеров вершин, где медиана каждого диапазона - его узел,
+     * а координаты читаются прямо из сетки без копирования
+     */
     class KDTree
     {
     private:
-        struct Node
-        {
-            Vector point;
-            std::unique_ptr<Node> left;
-            std::unique_ptr<Node> right;
+        std::shared_ptr<const Mesh> mesh_;
+        std::vector<size_t> nums_;   // Номера исходных точек (если дерево строилось по векторам)
+        std::vector<uint32_t> order_; // Перестановка вершин
+        size_t k_;                    // Размерность пространства (в данном случае 3)
 
-            Node(const Vector &p) : point(p), left(nullptr), right(nullptr) {}
-        };
+        void BuildTree(size_t begin, size_t end, size_t depth);
 
-        std::unique_ptr<Node> root_;
-        size_t k_; // Размерность пространства (в данном случае 3)
-
-        std::unique_ptr<Node> BuildTree(std::vector<Vector>::iterator begin, std::vector<Vector>::iterator end, size_t depth);
-
-        void NearestNeighborSearch(const Node *node, const Vector &target, size_t depth, Vector &best, double &best_dist) const;
+        void NearestNeighborSearch(size_t begin, size_t end, const Vector &target, size_t depth,
+                                   uint32_t &best, double &best_dist) const;
 
     public:
-        KDTree(std::vector<Vector> &points)
-            : root_(nullptr), k_(3)
-        {
-            root_ = BuildTree(points.begin(), points.end(), 0);
-        }
+        KDTree(std::vector<Vector> &points);
+        explicit KDTree(std::shared_ptr<const Mesh> mesh);
 
         Vector NearestNeighbor(const Vector &target) const;
     };
@@ -0,0 +1,179 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace read_stl
+{
+    using namespace std::string_literals;
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string &filename)
+    {
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Cannot open file: "s + filename);
+        }
+        file_handle_ = file;
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            Close();
+            throw std::runtime_error("Cannot get size of file: "s + filename);
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+
+        // Пустой файл отобразить нельзя, но это не ошибка
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            Close();
+            throw std::runtime_error("Cannot map file: "s + filename);
+        }
+        mapping_handle_ = mapping;
+
+        data_ = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data_ == nullptr)
+        {
+            Close();
+            throw std::runtime_error("Cannot map file: "s + filename);
+        }
+    }
+
+    void MappedFile::Close() noexcept
+    {
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_handle_ != nullptr)
+        {
+            CloseHandle(static_cast<HANDLE>(mapping_handle_));
+        }
+        if (file_handle_ != nullptr)
+        {
+            CloseHandle(static_cast<HANDLE>(file_handle_));
+        }
+        data_ = nullptr;
+        size_ = 0;
+        mapping_handle_ = nullptr;
+        file_handle_ = nullptr;
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          file_handle_(std::exchange(other.file_handle_, nullptr)),
+          mapping_handle_(std::exchange(other.mapping_handle_, nullptr)) {}
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            file_handle_ = std::exchange(other.file_handle_, nullptr);
+            mapping_handle_ = std::exchange(other.mapping_handle_, nullptr);
+        }
+        return *this;
+    }
+
+    bool MappedFile::IsOpen() const { return file_handle_ != nullptr; }
+#else
+    MappedFile::MappedFile(const std::string &filename)
+    {
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("Cannot open file: "s + filename);
+        }
+
+        struct stat file_stat;
+        if (::fstat(fd_, &file_stat) != 0)
+        {
+            Close();
+            throw std::runtime_error("Cannot get size of file: "s + filename);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+
+        // Пустой файл отобразить нельзя, но это не ошибка
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        void *ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (ptr == MAP_FAILED)
+        {
+            Close();
+            throw std::runtime_error("Cannot map file: "s + filename);
+        }
+        data_ = static_cast<const char *>(ptr);
+
+        // Файл читается последовательно от начала до конца
+        ::madvise(ptr, size_, MADV_SEQUENTIAL);
+    }
+
+    void MappedFile::Close() noexcept
+    {
+        if (data_ != nullptr)
+        {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+        fd_ = -1;
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          fd_(std::exchange(other.fd_, -1)) {}
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            fd_ = std::exchange(other.fd_, -1);
+        }
+        return *this;
+    }
+
+    bool MappedFile::IsOpen() const { return fd_ >= 0; }
+#endif
+
+    MappedFile::~MappedFile() { Close(); }
+
+    const char *MappedFile::Data() const { return data_; }
+
+    size_t MappedFile::Size() const { return size_; }
+
+} // namespace read_stl
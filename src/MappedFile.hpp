@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace read_stl
+{
+    /**
+     * Отображение файла в память только для чтения (mmap / MapViewOfFile).
+     * Данные доступны напрямую, без копирования в промежуточный буфер.
+     */
+    class MappedFile
+    {
+    private:
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+
+#ifdef _WIN32
+        void *file_handle_ = nullptr;
+        void *mapping_handle_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+
+        void Close() noexcept;
+
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string &filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &other) = delete;
+        MappedFile &operator=(const MappedFile &other) = delete;
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        const char *Data() const;
+        size_t Size() const;
+        bool IsOpen() const;
+    };
+
+} // namespace read_stl
@@ -1,12 +1,679 @@
 #include "MathOperations.hpp"
+#include "Vec3.hpp"
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 namespace math
 {
+    namespace
+    {
+        using vec3::Along;
+        using vec3::Cross;
+        using vec3::Dot;
+        using vec3::Point;
+        using vec3::Sub;
+
+        // Ближайшие точки отрезков [p1, q1] и [p2, q2], возвращает квадрат расстояния
+        double ClosestSegmentPoints(const Point &p1, const Point &q1, const Point &p2, const Point &q2,
+                                    Point &c1, Point &c2)
+        {
+            const Point d1 = Sub(q1, p1);
+            const Point d2 = Sub(q2, p2);
+            const Point r = Sub(p1, p2);
+            const double a = Dot(d1, d1);
+            const double e = Dot(d2, d2);
+            const double f = Dot(d2, r);
+
+            double s = 0.0, t = 0.0;
+            if (a == 0.0)
+            {
+                t = e > 0.0 ? std::clamp(f / e, 0.0, 1.0) : 0.0;
+            }
+            else
+            {
+                const double c = Dot(d1, r);
+                if (e == 0.0)
+                {
+                    s = std::clamp(-c / a, 0.0, 1.0);
+                }
+                else
+                {
+                    // Параметр на первом отрезке для прямых, затем уточнение по второму
+                    const double b = Dot(d1, d2);
+                    const double denom = a * e - b * b;
+                    s = denom > 0.0 ? std::clamp((b * f - c * e) / denom, 0.0, 1.0) : 0.0;
+                    t = (b * s + f) / e;
+                    if (t < 0.0)
+                    {
+                        t = 0.0;
+                        s = std::clamp(-c / a, 0.0, 1.0);
+                    }
+                    else if (t > 1.0)
+                    {
+                        t = 1.0;
+                        s = std::clamp((b - c) / a, 0.0, 1.0);
+                    }
+                }
+            }
+
+            c1 = Along(p1, d1, s);
+            c2 = Along(p2, d2, t);
+            const Point diff = Sub(c1, c2);
+            return Dot(diff, diff);
+        }
+
+        // Лежит ли точка плоскости треугольника внутри него (с границей)
+        bool InsideTriangle(const TrianglePoints &tr, const Point &normal, const Point &point)
+        {
+            for (size_t i = 0; i != 3; ++i)
+            {
+                const Point &a = tr[i];
+                const Point &b = tr[(i + 1) % 3];
+                if (Dot(Cross(Sub(b, a), Sub(point, a)), normal) < 0.0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        TrianglePoints ToPoints(const Triangle &triangle)
+        {
+            TrianglePoints points;
+            for (size_t i = 0; i != 3; ++i)
+            {
+                for (size_t axis = 0; axis != 3; ++axis)
+                {
+                    points[i][axis] = triangle.GetPoint(i)[axis];
+                }
+            }
+            return points;
+        }
+
+        // Плоскость грани tr_b и высоты над ней вершин tr_a (в длинах нормали)
+        struct FacePlane
+        {
+            Point normal;
+            double normal_squared;
+            std::array<double, 3> heights;
+        };
+
+        FacePlane MakeFacePlane(const TrianglePoints &tr_a, const TrianglePoints &tr_b)
+        {
+            FacePlane plane{};
+            plane.normal = Cross(Sub(tr_b[1], tr_b[0]), Sub(tr_b[2], tr_b[0]));
+            plane.normal_squared = Dot(plane.normal, plane.normal);
+            for (size_t i = 0; i != 3; ++i)
+            {
+                plane.heights[i] = Dot(Sub(tr_a[i], tr_b[0]), plane.normal);
+            }
+            return plane;
+        }
+
+        // Квадрат нижней оценки расстояния по плоскости грани: если вершины tr_a лежат
+        // строго по одну сторону плоскости tr_b, весь tr_a не ближе к ней, чем ближайшая
+        // из вершин, а tr_b лежит в этой плоскости. Иначе оценка 0
+        double SlabSquared(const FacePlane &plane)
+        {
+            const std::array<double, 3> &h = plane.heights;
+            const bool above = h[0] > 0.0 && h[1] > 0.0 && h[2] > 0.0;
+            const bool below = h[0] < 0.0 && h[1] < 0.0 && h[2] < 0.0;
+            if (plane.normal_squared == 0.0 || !(above || below))
+            {
+                return 0.0;
+            }
+            const double nearest = std::min({std::abs(h[0]), std::abs(h[1]), std::abs(h[2])});
+            return nearest * nearest / plane.normal_squared;
+        }
+
+        // Пары вершина - грань и рёбра, проходящие сквозь грань: вершины и рёбра tr_a
+        // против грани tr_b с плоскостью plane. Возвращает true, если ребро пересекает грань
+        bool VertexFaceDistance(const TrianglePoints &tr_a, const TrianglePoints &tr_b, const FacePlane &plane,
+                                double &min_squared, Point &closest_a, Point &closest_b)
+        {
+            const Point &normal = plane.normal;
+            const double normal_squared = plane.normal_squared;
+            if (normal_squared == 0.0)
+            {
+                return false;
+            }
+
+            const std::array<double, 3> &heights = plane.heights;
+            for (size_t i = 0; i != 3; ++i)
+            {
+                const double squared = heights[i] * heights[i] / normal_squared;
+                if (squared < min_squared)
+                {
+                    const Point projection = Along(tr_a[i], normal, -heights[i] / normal_squared);
+                    if (InsideTriangle(tr_b, normal, projection))
+                    {
+                        min_squared = squared;
+                        closest_a = tr_a[i];
+                        closest_b = projection;
+                    }
+                }
+            }
+
+            for (size_t i = 0; i != 3; ++i)
+            {
+                const size_t j = (i + 1) % 3;
+                if ((heights[i] < 0.0 && heights[j] > 0.0) || (heights[i] > 0.0 && heights[j] < 0.0))
+                {
+                    const Point crossing = Along(tr_a[i], Sub(tr_a[j], tr_a[i]), heights[i] / (heights[i] - heights[j]));
+                    if (InsideTriangle(tr_b, normal, crossing))
+                    {
+                        min_squared = 0.0;
+                        closest_a = crossing;
+                        closest_b = crossing;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Дорожки пакетного ядра: по одной паре треугольников на дорожку. Сравнения
+        // дают маски, Min и Max повторяют a < b ? a : b и a > b ? a : b, как инструкции SSE и AVX
+#if defined(__AVX2__)
+        struct Lanes
+        {
+            __m256d v;
+        };
+
+        struct Mask
+        {
+            __m256d v;
+        };
+
+        Lanes Load(const double *values) { return {_mm256_loadu_pd(values)}; }
+
+        void Store(const Lanes &a, double *values) { _mm256_storeu_pd(values, a.v); }
+
+        Lanes Broadcast(const double value) { return {_mm256_set1_pd(value)}; }
+
+        Lanes operator+(const Lanes &a, const Lanes &b) { return {_mm256_add_pd(a.v, b.v)}; }
+
+        Lanes operator-(const Lanes &a, const Lanes &b) { return {_mm256_sub_pd(a.v, b.v)}; }
+
+        Lanes operator*(const Lanes &a, const Lanes &b) { return {_mm256_mul_pd(a.v, b.v)}; }
+
+        Lanes operator/(const Lanes &a, const Lanes &b) { return {_mm256_div_pd(a.v, b.v)}; }
+
+        Lanes Negate(const Lanes &a) { return {_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))}; }
+
+        Lanes Min(const Lanes &a, const Lanes &b) { return {_mm256_min_pd(a.v, b.v)}; }
+
+        Lanes Max(const Lanes &a, const Lanes &b) { return {_mm256_max_pd(a.v, b.v)}; }
+
+        Lanes Sqrt(const Lanes &a) { return {_mm256_sqrt_pd(a.v)}; }
+
+        Mask Less(const Lanes &a, const Lanes &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+
+        Mask Greater(const Lanes &a, const Lanes &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+
+        Mask Equal(const Lanes &a, const Lanes &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)}; }
+
+        Mask NoLanes() { return {_mm256_setzero_pd()}; }
+
+        Mask And(const Mask &a, const Mask &b) { return {_mm256_and_pd(a.v, b.v)}; }
+
+        Mask Or(const Mask &a, const Mask &b) { return {_mm256_or_pd(a.v, b.v)}; }
+
+        // Дорожки a, не вошедшие в b
+        Mask AndNot(const Mask &a, const Mask &b) { return {_mm256_andnot_pd(b.v, a.v)}; }
+
+        Lanes Select(const Mask &mask, const Lanes &if_true, const Lanes &if_false)
+        {
+            return {_mm256_blendv_pd(if_false.v, if_true.v, mask.v)};
+        }
+
+        bool AllLanes(const Mask &mask) { return _mm256_movemask_pd(mask.v) == 0xF; }
+#elif defined(__SSE2__) || defined(_M_X64)
+        // Без AVX2 дорожки - две половины по два числа в регистрах SSE2 (есть на любом x86-64)
+        struct Lanes
+        {
+            __m128d low, high;
+        };
+
+        struct Mask
+        {
+            __m128d low, high;
+        };
+
+        template <typename Result, typename Argument, typename Operation>
+        Result PerHalf(const Argument &a, const Argument &b, const Operation &operation)
+        {
+            return {operation(a.low, b.low), operation(a.high, b.high)};
+        }
+
+        Lanes Load(const double *values) { return {_mm_loadu_pd(values), _mm_loadu_pd(values + 2)}; }
+
+        void Store(const Lanes &a, double *values)
+        {
+            _mm_storeu_pd(values, a.low);
+            _mm_storeu_pd(values + 2, a.high);
+        }
+
+        Lanes Broadcast(const double value) { return {_mm_set1_pd(value), _mm_set1_pd(value)}; }
+
+        Lanes operator+(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Lanes>(a, b, [](const __m128d x, const __m128d y)
+                                  { return _mm_add_pd(x, y); });
+        }
+
+        Lanes operator-(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Lanes>(a, b, [](const __m128d x, const __m128d y)
+                                  { return _mm_sub_pd(x, y); });
+        }
+
+        Lanes operator*(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Lanes>(a, b, [](const __m128d x, const __m128d y)
+                                  { return _mm_mul_pd(x, y); });
+        }
+
+        Lanes operator/(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Lanes>(a, b, [](const __m128d x, const __m128d y)
+                                  { return _mm_div_pd(x, y); });
+        }
+
+        Lanes Negate(const Lanes &a)
+        {
+            const __m128d sign = _mm_set1_pd(-0.0);
+            return {_mm_xor_pd(a.low, sign), _mm_xor_pd(a.high, sign)};
+        }
+
+        Lanes Min(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Lanes>(a, b, [](const __m128d x, const __m128d y)
+                                  { return _mm_min_pd(x, y); });
+        }
+
+        Lanes Max(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Lanes>(a, b, [](const __m128d x, const __m128d y)
+                                  { return _mm_max_pd(x, y); });
+        }
+
+        Lanes Sqrt(const Lanes &a) { return {_mm_sqrt_pd(a.low), _mm_sqrt_pd(a.high)}; }
+
+        Mask Less(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Mask>(a, b, [](const __m128d x, const __m128d y)
+                                 { return _mm_cmplt_pd(x, y); });
+        }
+
+        Mask Greater(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Mask>(a, b, [](const __m128d x, const __m128d y)
+                                 { return _mm_cmpgt_pd(x, y); });
+        }
+
+        Mask Equal(const Lanes &a, const Lanes &b)
+        {
+            return PerHalf<Mask>(a, b, [](const __m128d x, const __m128d y)
+                                 { return _mm_cmpeq_pd(x, y); });
+        }
+
+        Mask NoLanes() { return {_mm_setzero_pd(), _mm_setzero_pd()}; }
+
+        Mask And(const Mask &a, const Mask &b)
+        {
+            return PerHalf<Mask>(a, b, [](const __m128d x, const __m128d y)
+                                 { return _mm_and_pd(x, y); });
+        }
+
+        Mask Or(const Mask &a, const Mask &b)
+        {
+            return PerHalf<Mask>(a, b, [](const __m128d x, const __m128d y)
+                                 { return _mm_or_pd(x, y); });
+        }
+
+        // Дорожки a, не вошедшие в b
+        Mask AndNot(const Mask &a, const Mask &b)
+        {
+            return PerHalf<Mask>(a, b, [](const __m128d x, const __m128d y)
+                                 { return _mm_andnot_pd(y, x); });
+        }
+
+        Lanes Select(const Mask &mask, const Lanes &if_true, const Lanes &if_false)
+        {
+            const auto select = [](const __m128d m, const __m128d t, const __m128d f)
+            { return _mm_or_pd(_mm_and_pd(m, t), _mm_andnot_pd(m, f)); };
+            return {select(mask.low, if_true.low, if_false.low), select(mask.high, if_true.high, if_false.high)};
+        }
+
+        bool AllLanes(const Mask &mask) { return (_mm_movemask_pd(mask.low) & _mm_movemask_pd(mask.high)) == 0x3; }
+#else
+        struct Lanes
+        {
+            std::array<double, kTriangleBatchWidth> v;
+        };
+
+        struct Mask
+        {
+            std::array<bool, kTriangleBatchWidth> v;
+        };
+
+        template <typename Result, typename Operation>
+        Result PerLane(const Operation &operation)
+        {
+            Result result;
+            for (size_t lane = 0; lane != kTriangleBatchWidth; ++lane)
+            {
+                result.v[lane] = operation(lane);
+            }
+            return result;
+        }
+
+        Lanes Load(const double *values)
+        {
+            return PerLane<Lanes>([values](const size_t lane)
+                                  { return values[lane]; });
+        }
+
+        void Store(const Lanes &a, double *values) { std::copy(a.v.begin(), a.v.end(), values); }
+
+        Lanes Broadcast(const double value)
+        {
+            return PerLane<Lanes>([value](size_t)
+                                  { return value; });
+        }
+
+        Lanes operator+(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return a.v[lane] + b.v[lane]; });
+        }
+
+        Lanes operator-(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return a.v[lane] - b.v[lane]; });
+        }
+
+        Lanes operator*(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return a.v[lane] * b.v[lane]; });
+        }
+
+        Lanes operator/(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return a.v[lane] / b.v[lane]; });
+        }
+
+        Lanes Negate(const Lanes &a)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return -a.v[lane]; });
+        }
+
+        Lanes Min(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return a.v[lane] < b.v[lane] ? a.v[lane] : b.v[lane]; });
+        }
+
+        Lanes Max(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return a.v[lane] > b.v[lane] ? a.v[lane] : b.v[lane]; });
+        }
+
+        Lanes Sqrt(const Lanes &a)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return std::sqrt(a.v[lane]); });
+        }
+
+        Mask Less(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Mask>([&](const size_t lane)
+                                 { return a.v[lane] < b.v[lane]; });
+        }
+
+        Mask Greater(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Mask>([&](const size_t lane)
+                                 { return a.v[lane] > b.v[lane]; });
+        }
+
+        Mask Equal(const Lanes &a, const Lanes &b)
+        {
+            return PerLane<Mask>([&](const size_t lane)
+                                 { return a.v[lane] == b.v[lane]; });
+        }
+
+        Mask NoLanes() { return Mask{}; }
+
+        Mask And(const Mask &a, const Mask &b)
+        {
+            return PerLane<Mask>([&](const size_t lane)
+                                 { return a.v[lane] && b.v[lane]; });
+        }
+
+        Mask Or(const Mask &a, const Mask &b)
+        {
+            return PerLane<Mask>([&](const size_t lane)
+                                 { return a.v[lane] || b.v[lane]; });
+        }
+
+        // Дорожки a, не вошедшие в b
+        Mask AndNot(const Mask &a, const Mask &b)
+        {
+            return PerLane<Mask>([&](const size_t lane)
+                                 { return a.v[lane] && !b.v[lane]; });
+        }
+
+        Lanes Select(const Mask &mask, const Lanes &if_true, const Lanes &if_false)
+        {
+            return PerLane<Lanes>([&](const size_t lane)
+                                  { return mask.v[lane] ? if_true.v[lane] : if_false.v[lane]; });
+        }
+
+        bool AllLanes(const Mask &mask)
+        {
+            return std::all_of(mask.v.begin(), mask.v.end(), [](const bool lane)
+                               { return lane; });
+        }
+#endif
+
+        using LanePoint = std::array<Lanes, 3>;
+        using LaneTriangle = std::array<LanePoint, 3>;
+
+        LanePoint Sub(const LanePoint &a, const LanePoint &b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+
+        Lanes Dot(const LanePoint &a, const LanePoint &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+        LanePoint Cross(const LanePoint &a, const LanePoint &b)
+        {
+            return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+        }
+
+        LanePoint Along(const LanePoint &a, const LanePoint &d, const Lanes &t)
+        {
+            return {a[0] + t * d[0], a[1] + t * d[1], a[2] + t * d[2]};
+        }
+
+        // std::clamp(t, 0.0, 1.0)
+        Lanes Clamp(const Lanes &t) { return Max(Min(t, Broadcast(1.0)), Broadcast(0.0)); }
+
+        // Квадрат расстояния между отрезками по дорожкам: ветви ClosestSegmentPoints
+        // вычисляются все и выбираются в обратном порядке проверок
+        Lanes SegmentSquared(const LanePoint &p1, const LanePoint &q1, const LanePoint &p2, const LanePoint &q2)
+        {
+            const Lanes zero = Broadcast(0.0);
+            const LanePoint d1 = Sub(q1, p1);
+            const LanePoint d2 = Sub(q2, p2);
+            const LanePoint r = Sub(p1, p2);
+            const Lanes a = Dot(d1, d1);
+            const Lanes e = Dot(d2, d2);
+            const Lanes f = Dot(d2, r);
+            const Lanes c = Dot(d1, r);
+            const Lanes b = Dot(d1, d2);
+
+            // Невырожденные отрезки
+            const Lanes denom = a * e - b * b;
+            Lanes s = Select(Greater(denom, zero), Clamp((b * f - c * e) / denom), zero);
+            Lanes t = (b * s + f) / e;
+            const Mask below = Less(t, zero);
+            const Mask above = Greater(t, Broadcast(1.0));
+            const Lanes s_start = Clamp(Negate(c) / a);
+            s = Select(below, s_start, Select(above, Clamp((b - c) / a), s));
+            t = Select(below, zero, Select(above, Broadcast(1.0), t));
+
+            // Второй отрезок - точка
+            const Mask point2 = Equal(e, zero);
+            s = Select(point2, s_start, s);
+            t = Select(point2, zero, t);
+
+            // Первый отрезок - точка
+            const Mask point1 = Equal(a, zero);
+            s = Select(point1, zero, s);
+            t = Select(point1, Select(Greater(e, zero), Clamp(f / e), zero), t);
+
+            const LanePoint diff = Sub(Along(p1, d1, s), Along(p2, d2, t));
+            return Dot(diff, diff);
+        }
+
+        // Дорожки, на которых точка плоскости треугольника лежит вне него (как InsideTriangle)
+        Mask OutsideTriangle(const LaneTriangle &tr, const LanePoint &normal, const LanePoint &point)
+        {
+            Mask outside = NoLanes();
+            for (size_t i = 0; i != 3; ++i)
+            {
+                const LanePoint &a = tr[i];
+                const LanePoint &b = tr[(i + 1) % 3];
+                outside = Or(outside, Less(Dot(Cross(Sub(b, a), Sub(point, a)), normal), Broadcast(0.0)));
+            }
+            return outside;
+        }
+
+        // Плоскость грани и высоты вершин по дорожкам (как FacePlane)
+        struct LaneFacePlane
+        {
+            LanePoint normal;
+            Lanes normal_squared;
+            std::array<Lanes, 3> heights;
+        };
+
+        LaneFacePlane MakeFacePlane(const LaneTriangle &tr_a, const LaneTriangle &tr_b)
+        {
+            LaneFacePlane plane;
+            plane.normal = Cross(Sub(tr_b[1], tr_b[0]), Sub(tr_b[2], tr_b[0]));
+            plane.normal_squared = Dot(plane.normal, plane.normal);
+            for (size_t i = 0; i != 3; ++i)
+            {
+                plane.heights[i] = Dot(Sub(tr_a[i], tr_b[0]), plane.normal);
+            }
+            return plane;
+        }
+
+        // Квадрат нижней оценки по плоскости грани по дорожкам (как SlabSquared)
+        Lanes SlabSquared(const LaneFacePlane &plane)
+        {
+            const Lanes zero = Broadcast(0.0);
+            const std::array<Lanes, 3> &h = plane.heights;
+            const Mask above = And(And(Greater(h[0], zero), Greater(h[1], zero)), Greater(h[2], zero));
+            const Mask below = And(And(Less(h[0], zero), Less(h[1], zero)), Less(h[2], zero));
+            const Mask separated = AndNot(Or(above, below), Equal(plane.normal_squared, zero));
+            const auto magnitude = [](const Lanes &height)
+            { return Max(height, Negate(height)); };
+            const Lanes nearest = Min(Min(magnitude(h[0]), magnitude(h[1])), magnitude(h[2]));
+            return Select(separated, nearest * nearest / plane.normal_squared, zero);
+        }
+
+        // Пары вершина - грань по дорожкам (как VertexFaceDistance): уменьшает min_squared
+        // и возвращает дорожки, на которых ребро tr_a проходит сквозь грань tr_b
+        Mask VertexFaceSquared(const LaneTriangle &tr_a, const LaneTriangle &tr_b, const LaneFacePlane &plane,
+                               Lanes &min_squared)
+        {
+            const Lanes zero = Broadcast(0.0);
+            const LanePoint &normal = plane.normal;
+            const Lanes &normal_squared = plane.normal_squared;
+            const Mask degenerate = Equal(normal_squared, zero);
+
+            const std::array<Lanes, 3> &heights = plane.heights;
+            for (size_t i = 0; i != 3; ++i)
+            {
+                const Lanes squared = heights[i] * heights[i] / normal_squared;
+                const LanePoint projection = Along(tr_a[i], normal, Negate(heights[i]) / normal_squared);
+                const Mask outside = Or(degenerate, OutsideTriangle(tr_b, normal, projection));
+                min_squared = Select(outside, min_squared, Min(squared, min_squared));
+            }
+
+            Mask crossed = NoLanes();
+            for (size_t i = 0; i != 3; ++i)
+            {
+                const size_t j = (i + 1) % 3;
+                const Mask opposite = Or(And(Less(heights[i], zero), Greater(heights[j], zero)),
+                                         And(Greater(heights[i], zero), Less(heights[j], zero)));
+                const LanePoint crossing = Along(tr_a[i], Sub(tr_a[j], tr_a[i]), heights[i] / (heights[i] - heights[j]));
+                crossed = Or(crossed, AndNot(opposite, OutsideTriangle(tr_b, normal, crossing)));
+            }
+            return AndNot(crossed, degenerate);
+        }
+
+        // Точные расстояния по дорожкам (как TriangleDistance без границы)
+        Lanes ExactDistances(const LaneTriangle &tr_a, const LaneTriangle &tr_b, const LaneFacePlane &plane_b,
+                             const LaneFacePlane &plane_a)
+        {
+            Lanes min_squared = Broadcast(std::numeric_limits<double>::max());
+            const Mask crossed = Or(VertexFaceSquared(tr_a, tr_b, plane_b, min_squared),
+                                    VertexFaceSquared(tr_b, tr_a, plane_a, min_squared));
+            for (size_t i = 0; i != 3; ++i)
+            {
+                for (size_t j = 0; j != 3; ++j)
+                {
+                    min_squared = Min(SegmentSquared(tr_a[i], tr_a[(i + 1) % 3], tr_b[j], tr_b[(j + 1) % 3]),
+                                      min_squared);
+                }
+            }
+            return Select(crossed, Broadcast(0.0), Sqrt(min_squared));
+        }
+
+        // Треугольники kTriangleBatchWidth пар, начиная с first; недостающие дорожки
+        // последнего прохода заполняются первой парой
+        LaneTriangle LoadTriangles(const double *coords, const size_t stride, const size_t first, const size_t count)
+        {
+            LaneTriangle triangles;
+            for (size_t corner = 0; corner != 3; ++corner)
+            {
+                for (size_t axis = 0; axis != 3; ++axis)
+                {
+                    const double *row = coords + (3 * corner + axis) * stride + first;
+                    if (count == kTriangleBatchWidth)
+                    {
+                        triangles[corner][axis] = Load(row);
+                        continue;
+                    }
+                    std::array<double, kTriangleBatchWidth> padded{};
+                    for (size_t lane = 0; lane != kTriangleBatchWidth; ++lane)
+                    {
+                        padded[lane] = row[lane < count ? lane : 0];
+                    }
+                    triangles[corner][axis] = Load(padded.data());
+                }
+            }
+            return triangles;
+        }
+    } // namespace
+
     Vector operator*(const Matrix<double> &mat, const Vector &vec)
     {
         Vector result;
@@ -192,4 +859,131 @@ namespace math
 
         return *std::min_element(segments_dist.begin(), segments_dist.end());
     }
+
+    double TriangleDistance(const TrianglePoints &tr_a, const TrianglePoints &tr_b,
+                            std::array<double, 3> &closest_a, std::array<double, 3> &closest_b, const double bound)
+    {
+        // Треугольники, разделённые плоскостью одного из них не меньше чем на bound,
+        // дальше не считаются
+        const FacePlane plane_b = MakeFacePlane(tr_a, tr_b);
+        const FacePlane plane_a = MakeFacePlane(tr_b, tr_a);
+        const double separation = std::max(SlabSquared(plane_b), SlabSquared(plane_a));
+        if (separation >= bound * bound)
+        {
+            return std::max(std::sqrt(separation), bound);
+        }
+
+        double min_squared = std::numeric_limits<double>::max();
+        if (VertexFaceDistance(tr_a, tr_b, plane_b, min_squared, closest_a, closest_b))
+        {
+            return 0.0;
+        }
+        if (VertexFaceDistance(tr_b, tr_a, plane_a, min_squared, closest_b, closest_a))
+        {
+            return 0.0;
+        }
+
+        for (size_t i = 0; i != 3; ++i)
+        {
+            for (size_t j = 0; j != 3; ++j)
+            {
+                Point point_a, point_b;
+                const double squared = ClosestSegmentPoints(tr_a[i], tr_a[(i + 1) % 3], tr_b[j], tr_b[(j + 1) % 3],
+                                                            point_a, point_b);
+                if (squared < min_squared)
+                {
+                    min_squared = squared;
+                    closest_a = point_a;
+                    closest_b = point_b;
+                }
+            }
+        }
+        return std::sqrt(min_squared);
+    }
+
+    double TriangleDistance(const Triangle &tr_a, const Triangle &tr_b)
+    {
+        std::array<double, 3> closest_a, closest_b;
+        return TriangleDistance(ToPoints(tr_a), ToPoints(tr_b), closest_a, closest_b);
+    }
+
+    double PlaneSeparation(const TrianglePoints &tr_a, const TrianglePoints &tr_b)
+    {
+        return std::sqrt(std::max(SlabSquared(MakeFacePlane(tr_a, tr_b)), SlabSquared(MakeFacePlane(tr_b, tr_a))));
+    }
+
+    double PlaneSeparation(const Triangle &tr_a, const Triangle &tr_b)
+    {
+        return PlaneSeparation(ToPoints(tr_a), ToPoints(tr_b));
+    }
+
+    void TriangleDistances(const double *coords_a, const double *coords_b, const size_t stride, const size_t count,
+                           double *distances, const double bound)
+    {
+        // Пары, не отсечённые оценкой по плоскостям, из проходов с отсечёнными парами
+        // собираются в отдельный пакет, чтобы точный расчёт шёл полными проходами
+        std::array<double, 9 * kTriangleBatchWidth> pending_a{}, pending_b{};
+        std::array<size_t, kTriangleBatchWidth> pending_pairs{};
+        size_t num_pending = 0;
+        std::array<double, kTriangleBatchWidth> result{};
+        const auto flush = [&]
+        {
+            const LaneTriangle tr_a = LoadTriangles(pending_a.data(), kTriangleBatchWidth, 0, num_pending);
+            const LaneTriangle tr_b = LoadTriangles(pending_b.data(), kTriangleBatchWidth, 0, num_pending);
+            std::array<double, kTriangleBatchWidth> exact{};
+            Store(ExactDistances(tr_a, tr_b, MakeFacePlane(tr_a, tr_b), MakeFacePlane(tr_b, tr_a)), exact.data());
+            for (size_t lane = 0; lane != num_pending; ++lane)
+            {
+                distances[pending_pairs[lane]] = exact[lane];
+            }
+            num_pending = 0;
+        };
+
+        const Lanes squared_bound = Broadcast(bound * bound);
+        for (size_t first = 0; first < count; first += kTriangleBatchWidth)
+        {
+            const size_t num_lanes = std::min(kTriangleBatchWidth, count - first);
+            const LaneTriangle tr_a = LoadTriangles(coords_a, stride, first, num_lanes);
+            const LaneTriangle tr_b = LoadTriangles(coords_b, stride, first, num_lanes);
+            const LaneFacePlane plane_b = MakeFacePlane(tr_a, tr_b);
+            const LaneFacePlane plane_a = MakeFacePlane(tr_b, tr_a);
+
+            // Ни одна пара не отсечена - точный расчёт сразу
+            const Lanes separation = Max(SlabSquared(plane_b), SlabSquared(plane_a));
+            const Mask improving = Less(separation, squared_bound);
+            if (AllLanes(improving))
+            {
+                Store(ExactDistances(tr_a, tr_b, plane_b, plane_a), result.data());
+                std::copy(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(num_lanes), distances + first);
+                continue;
+            }
+
+            // Отсечённым парам - оценка (не меньше bound), остальные откладываются
+            Store(Max(Sqrt(separation), Broadcast(bound)), result.data());
+            std::array<double, kTriangleBatchWidth> separated{};
+            Store(Select(improving, Broadcast(0.0), Broadcast(1.0)), separated.data());
+            for (size_t lane = 0; lane != num_lanes; ++lane)
+            {
+                if (separated[lane] != 0.0)
+                {
+                    distances[first + lane] = result[lane];
+                    continue;
+                }
+                for (size_t row = 0; row != 9; ++row)
+                {
+                    pending_a[row * kTriangleBatchWidth + num_pending] = coords_a[row * stride + first + lane];
+                    pending_b[row * kTriangleBatchWidth + num_pending] = coords_b[row * stride + first + lane];
+                }
+                pending_pairs[num_pending++] = first + lane;
+                if (num_pending == kTriangleBatchWidth)
+                {
+                    flush();
+                }
+            }
+        }
+        if (num_pending != 0)
+        {
+            flush();
+        }
+    }
 } // namespace math
@@ -4,6 +4,10 @@
 #include "Matrix.hpp"
 #include "Triangle.hpp"
 
+#include <array>
+#include <cstddef>
+#include <limits>
+
 namespace math
 {
     struct Segment
@@ -26,4 +30,57 @@ namespace math
     double SegmentToSegment(const Segment &seg_a, const Segment &seg_b);
 
     double MinSegmentDistance(const Triangle &tr_a, const Triangle &tr_b);
+
+    /**
+     * Вершины треугольника (координаты x, y, z каждой)
+     */
+    using TrianglePoints = std::array<std::array<double, 3>, 3>;
+
+    /**
+     * Точное расстояние между треугольниками и ближайшие точки на них за один проход
+     * без выделения памяти. Для непересекающихся треугольников минимум достигается
+     * на паре рёбер или на паре вершина - грань, поэтому проверяются 9 пар рёбер
+     * (ближайшие точки отрезков в замкнутом виде) и 6 проекций вершин на плоскость
+     * другого треугольника. Пересечение (ребро, проходящее сквозь грань другого
+     * треугольника) даёт расстояние 0. Вырожденные треугольники (отрезки, точки)
+     * обрабатываются через пары рёбер.
+     * bound - текущий лучший результат вызывающего: если вершины одного треугольника
+     * лежат по одну сторону плоскости другого не ближе bound, расчёт прекращается и
+     * возвращается эта оценка (не меньше bound), ближайшие точки при этом не заполняются
+     */
+    double TriangleDistance(const TrianglePoints &tr_a, const TrianglePoints &tr_b,
+                            std::array<double, 3> &closest_a, std::array<double, 3> &closest_b,
+                            double bound = std::numeric_limits<double>::infinity());
+
+    double TriangleDistance(const Triangle &tr_a, const Triangle &tr_b);
+
+    /**
+     * Дешёвая нижняя оценка расстояния между треугольниками по плоскостям граней:
+     * если вершины одного лежат строго по одну сторону плоскости другого - расстояние
+     * от ближайшей из них до этой плоскости, иначе 0
+     */
+    double PlaneSeparation(const TrianglePoints &tr_a, const TrianglePoints &tr_b);
+
+    double PlaneSeparation(const Triangle &tr_a, const Triangle &tr_b);
+
+    /**
+     * Число пар треугольников, которые пакетное ядро считает за один проход
+     * (4 числа double в регистре AVX2)
+     */
+    inline constexpr size_t kTriangleBatchWidth = 4;
+
+    /**
+     * Пакетный расчёт расстояний между count парами треугольников, заданными структурой
+     * массивов: координата axis вершины corner первого треугольника пары k -
+     * coords_a[(3 * corner + axis) * stride + k], второго - так же в coords_b.
+     * Пары считаются по kTriangleBatchWidth за проход по тем же формулам, что и в
+     * TriangleDistance, но без ветвлений: все случаи вычисляются для каждой дорожки
+     * и выбираются масками. При сборке с ENABLE_AVX2 проход идёт на регистрах AVX2,
+     * без неё - на парах регистров SSE2, на других процессорах - циклами по дорожкам.
+     * Ближайшие точки не возвращаются. Пары, для которых оценка по плоскостям граней,
+     * как в TriangleDistance, не меньше bound, получают эту оценку (не меньше bound),
+     * остальные собираются в полные проходы точного расчёта
+     */
+    void TriangleDistances(const double *coords_a, const double *coords_b, size_t stride, size_t count,
+                           double *distances, double bound = std::numeric_limits<double>::infinity());
 } // namespace math
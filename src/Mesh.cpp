@@ -0,0 +1,324 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace math
+{
+    using namespace std::string_literals;
+
+    Mesh::Mesh(std::vector<double> x, std::vector<double> y, std::vector<double> z,
+               std::vector<uint32_t> indices)
+        : x_(std::move(x)), y_(std::move(y)), z_(std::move(z)), indices_(std::move(indices))
+    {
+        Validate();
+    }
+
+    Mesh::Mesh(std::vector<double> x, std::vector<double> y, std::vector<double> z,
+               std::vector<uint32_t> indices,
+               std::vector<double> nx, std::vector<double> ny, std::vector<double> nz)
+        : Mesh(std::move(x), std::move(y), std::move(z), std::move(indices))
+    {
+        nx_ = std::move(nx);
+        ny_ = std::move(ny);
+        nz_ = std::move(nz);
+        Validate();
+    }
+
+    void Mesh::Validate() const
+    {
+        const size_t num_vertices = VertexCount();
+        const size_t num_x = single_ ? xf_.size() : x_.size();
+        const size_t num_y = single_ ? yf_.size() : y_.size();
+        const size_t num_z = single_ ? zf_.size() : z_.size();
+        if (num_x != num_y || num_x != num_z)
+        {
+            throw std::invalid_argument("Vertex coordinate arrays must have equal size"s);
+        }
+        if (indices_.size() % 3 != 0)
+        {
+            throw std::invalid_argument("Index buffer size must be a multiple of 3"s);
+        }
+        for (const uint32_t index : indices_)
+        {
+            if (index >= num_vertices)
+            {
+                throw std::invalid_argument("Vertex index out of range"s);
+            }
+        }
+
+        const size_t num_nx = single_ ? nxf_.size() : nx_.size();
+        const size_t num_ny = single_ ? nyf_.size() : ny_.size();
+        const size_t num_nz = single_ ? nzf_.size() : nz_.size();
+        if (num_nx + num_ny + num_nz != 0 &&
+            (num_nx != TriangleCount() || num_ny != TriangleCount() || num_nz != TriangleCount()))
+        {
+            throw std::invalid_argument("Normal arrays must have one entry per triangle"s);
+        }
+    }
+
+    Mesh Mesh::FromTriangles(const std::vector<Triangle> &triangles)
+    {
+        const size_t num_tris = triangles.size();
+        std::vector<uint32_t> indices(3 * num_tris);
+        std::vector<double> nx(num_tris), ny(num_tris), nz(num_tris);
+
+        size_t num_vertices = 0;
+        for (const Triangle &triangle : triangles)
+        {
+            for (size_t icorner = 0; icorner != 3; ++icorner)
+            {
+                num_vertices = std::max(num_vertices, triangle.GetPoint(icorner).GetNum() + 1);
+            }
+        }
+
+        // Номера точек используются, только если они согласованы с координатами
+        bool by_nums = num_vertices <= 3 * num_tris;
+        std::vector<double> x, y, z;
+        if (by_nums)
+        {
+            x.assign(num_vertices, 0.0);
+            y.assign(num_vertices, 0.0);
+            z.assign(num_vertices, 0.0);
+            std::vector<bool> filled(num_vertices, false);
+            for (size_t itri = 0; itri != num_tris && by_nums; ++itri)
+            {
+                for (size_t icorner = 0; icorner != 3; ++icorner)
+                {
+                    const Vector &point = triangles[itri].GetPoint(icorner);
+                    const size_t num = point.GetNum();
+                    if (!filled[num])
+                    {
+                        x[num] = point[0];
+                        y[num] = point[1];
+                        z[num] = point[2];
+                        filled[num] = true;
+                    }
+                    else if (x[num] != point[0] || y[num] != point[1] || z[num] != point[2])
+                    {
+                        by_nums = false;
+                        break;
+                    }
+                    indices[3 * itri + icorner] = static_cast<uint32_t>(num);
+                }
+            }
+        }
+
+        if (!by_nums)
+        {
+            x.resize(3 * num_tris);
+            y.resize(3 * num_tris);
+            z.resize(3 * num_tris);
+            for (size_t itri = 0; itri != num_tris; ++itri)
+            {
+                for (size_t icorner = 0; icorner != 3; ++icorner)
+                {
+                    const Vector &point = triangles[itri].GetPoint(icorner);
+                    const size_t corner = 3 * itri + icorner;
+                    x[corner] = point[0];
+                    y[corner] = point[1];
+                    z[corner] = point[2];
+                    indices[corner] = static_cast<uint32_t>(corner);
+                }
+            }
+        }
+
+        for (size_t itri = 0; itri != num_tris; ++itri)
+        {
+            const Vector norm = triangles[itri].GetNorm();
+            nx[itri] = norm[0];
+            ny[itri] = norm[1];
+            nz[itri] = norm[2];
+        }
+
+        return Mesh(std::move(x), std::move(y), std::move(z), std::move(indices),
+                    std::move(nx), std::move(ny), std::move(nz));
+    }
+
+    Mesh Mesh::FromPoints(const std::vector<Vector> &points)
+    {
+        std::vector<double> x(points.size()), y(points.size()), z(points.size());
+        for (size_t i = 0; i != points.size(); ++i)
+        {
+            x[i] = points[i][0];
+            y[i] = points[i][1];
+            z[i] = points[i][2];
+        }
+        return Mesh(std::move(x), std::move(y), std::move(z), {});
+    }
+
+    Mesh Mesh::FromSinglePrecision(std::vector<float> x, std::vector<float> y, std::vector<float> z,
+                                   std::vector<uint32_t> indices,
+                                   std::vector<float> nx, std::vector<float> ny, std::vector<float> nz,
+                                   const double rounding_error)
+    {
+        if (!(rounding_error >= 0.0))
+        {
+            throw std::invalid_argument("Rounding error must be non-negative"s);
+        }
+
+        Mesh mesh;
+        mesh.single_ = true;
+        mesh.xf_ = std::move(x);
+        mesh.yf_ = std::move(y);
+        mesh.zf_ = std::move(z);
+        mesh.indices_ = std::move(indices);
+        mesh.nxf_ = std::move(nx);
+        mesh.nyf_ = std::move(ny);
+        mesh.nzf_ = std::move(nz);
+        mesh.rounding_error_ = rounding_error;
+        mesh.Validate();
+        return mesh;
+    }
+
+    Mesh Mesh::ToSinglePrecision() const
+    {
+        if (single_)
+        {
+            return *this;
+        }
+
+        const auto narrow = [](const std::vector<double> &values)
+        {
+            return std::vector<float>(values.begin(), values.end());
+        };
+
+        Mesh mesh;
+        mesh.single_ = true;
+        mesh.xf_ = narrow(x_);
+        mesh.yf_ = narrow(y_);
+        mesh.zf_ = narrow(z_);
+        mesh.indices_ = indices_;
+        mesh.nxf_ = narrow(nx_);
+        mesh.nyf_ = narrow(ny_);
+        mesh.nzf_ = narrow(nz_);
+
+        // Разность double и его округления до float вычисляется точно,
+        // запас покрывает округления при возведении в квадрат и корне
+        double max_error = 0.0;
+        for (size_t i = 0; i != x_.size(); ++i)
+        {
+            const double dx = x_[i] - mesh.xf_[i];
+            const double dy = y_[i] - mesh.yf_[i];
+            const double dz = z_[i] - mesh.zf_[i];
+            max_error = std::max(max_error, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+        if (max_error > 0.0)
+        {
+            max_error = std::nextafter(max_error * (1.0 + 4.0 * std::numeric_limits<double>::epsilon()),
+                                       std::numeric_limits<double>::infinity());
+        }
+        mesh.rounding_error_ = max_error;
+        return mesh;
+    }
+
+    size_t Mesh::VertexCount() const { return single_ ? xf_.size() : x_.size(); }
+
+    size_t Mesh::TriangleCount() const { return indices_.size() / 3; }
+
+    bool Mesh::HasNormals() const { return single_ ? !nxf_.empty() : !nx_.empty(); }
+
+    bool Mesh::Empty() const { return indices_.empty(); }
+
+    bool Mesh::IsSinglePrecision() const { return single_; }
+
+    double Mesh::RoundingError() const { return rounding_error_; }
+
+    const std::vector<double> &Mesh::X() const { return x_; }
+
+    const std::vector<double> &Mesh::Y() const { return y_; }
+
+    const std::vector<double> &Mesh::Z() const { return z_; }
+
+    const std::vector<uint32_t> &Mesh::Indices() const { return indices_; }
+
+    const std::vector<double> &Mesh::NX() const { return nx_; }
+
+    const std::vector<double> &Mesh::NY() const { return ny_; }
+
+    const std::vector<double> &Mesh::NZ() const { return nz_; }
+
+    const std::vector<float> &Mesh::XF() const { return xf_; }
+
+    const std::vector<float> &Mesh::YF() const { return yf_; }
+
+    const std::vector<float> &Mesh::ZF() const { return zf_; }
+
+    const std::vector<float> &Mesh::NXF() const { return nxf_; }
+
+    const std::vector<float> &Mesh::NYF() const { return nyf_; }
+
+    const std::vector<float> &Mesh::NZF() const { return nzf_; }
+
+    Vector Mesh::GetVertex(const size_t vertex) const
+    {
+        const uint32_t v = static_cast<uint32_t>(vertex);
+        return Vector(vertex, {Coord(v, 0), Coord(v, 1), Coord(v, 2)});
+    }
+
+    Vector Mesh::GetNorm(const size_t triangle) const
+    {
+        if (!HasNormals())
+        {
+            return Vector{0.0, 0.0, 0.0};
+        }
+        if (single_)
+        {
+            return Vector{nxf_[triangle], nyf_[triangle], nzf_[triangle]};
+        }
+        return Vector{nx_[triangle], ny_[triangle], nz_[triangle]};
+    }
+
+    Triangle Mesh::GetTriangle(const size_t triangle) const
+    {
+        return Triangle(triangle, GetNorm(triangle),
+                        GetVertex(Index(triangle, 0)),
+                        GetVertex(Index(triangle, 1)),
+                        GetVertex(Index(triangle, 2)));
+    }
+
+    Vector Mesh::GetMidlePoint(const size_t triangle) const
+    {
+        const uint32_t a = Index(triangle, 0);
+        const uint32_t b = Index(triangle, 1);
+        const uint32_t c = Index(triangle, 2);
+        return Vector({(Coord(a, 0) + Coord(b, 0) + Coord(c, 0)) / 3.0,
+                       (Coord(a, 1) + Coord(b, 1) + Coord(c, 1)) / 3.0,
+                       (Coord(a, 2) + Coord(b, 2) + Coord(c, 2)) / 3.0});
+    }
+
+    void Mesh::TriangleBounds(const size_t triangle,
+                              std::array<double, 3> &min_bounds, std::array<double, 3> &max_bounds) const
+    {
+        const uint32_t a = Index(triangle, 0);
+        const uint32_t b = Index(triangle, 1);
+        const uint32_t c = Index(triangle, 2);
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            min_bounds[axis] = std::min({Coord(a, axis), Coord(b, axis), Coord(c, axis)});
+            max_bounds[axis] = std::max({Coord(a, axis), Coord(b, axis), Coord(c, axis)});
+        }
+    }
+
+    std::vector<Triangle> Mesh::ToTriangles() const
+    {
+        std::vector<Triangle> triangles;
+        triangles.reserve(TriangleCount());
+        for (size_t itri = 0; itri != TriangleCount(); ++itri)
+        {
+            triangles.push_back(GetTriangle(itri));
+        }
+        return triangles;
+    }
+
+    size_t Mesh::MemoryBytes() const
+    {
+        return (x_.size() + y_.size() + z_.size() + nx_.size() + ny_.size() + nz_.size()) * sizeof(double) +
+               (xf_.size() + yf_.size() + zf_.size() + nxf_.size() + nyf_.size() + nzf_.size()) * sizeof(float) +
+               indices_.size() * sizeof(uint32_t);
+    }
+
+} // namespace math
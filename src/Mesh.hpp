@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Triangle.hpp"
+#include "Vector.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math
+{
+    /**
+     * Индексированная сетка в виде структуры массивов: координаты вершин
+     * хранятся отдельными массивами x[], y[], z[], треугольники - тройками
+     * индексов uint32_t, нормали граней (необязательные) - массивами nx[], ny[], nz[].
+     * Общие вершины хранятся один раз, поэтому на грань приходится примерно
+     * втрое меньше памяти, чем у std::vector<Triangle>.
+     * Номер вершины - её индекс, номер треугольника - его позиция.
+     *
+     * Координаты и нормали хранятся в double или (по выбору) во float. STL хранит
+     * числа во float, поэтому для бинарных файлов float-сетка точна и занимает
+     * вдвое меньше памяти. Запросы всегда возвращают double: расширение float
+     * до double точное, так что все вычисления над сеткой идут в double.
+     * Если при переводе во float координаты округлялись (текстовый STL, сварка
+     * с допуском), их наибольшее смещение хранится в RoundingError().
+     */
+    class Mesh
+    {
+    private:
+        std::vector<double> x_, y_, z_;
+        std::vector<uint32_t> indices_;
+        std::vector<double> nx_, ny_, nz_;
+
+        // Хранение во float (x_ ... nz_ при этом пустые)
+        bool single_ = false;
+        std::vector<float> xf_, yf_, zf_;
+        std::vector<float> nxf_, nyf_, nzf_;
+        double rounding_error_ = 0.0;
+
+        void Validate() const;
+
+    public:
+        Mesh() = default;
+        Mesh(std::vector<double> x, std::vector<double> y, std::vector<double> z,
+             std::vector<uint32_t> indices);
+        Mesh(std::vector<double> x, std::vector<double> y, std::vector<double> z,
+             std::vector<uint32_t> indices,
+             std::vector<double> nx, std::vector<double> ny, std::vector<double> nz);
+
+        /**
+         * Сетка из треугольников. Если номера точек согласованы (одинаковый номер -
+         * одинаковые координаты), вершины берутся по номерам, иначе каждый угол
+         * становится отдельной вершиной
+         */
+        static Mesh FromTriangles(const std::vector<Triangle> &triangles);
+
+        /**
+         * Сетка из одних вершин (без треугольников)
+         */
+        static Mesh FromPoints(const std::vector<Vector> &points);
+
+        /**
+         * Сетка с хранением во float (например, из кэша). rounding_error - наибольшее
+         * смещение вершины относительно исходных координат
+         */
+        static Mesh FromSinglePrecision(std::vector<float> x, std::vector<float> y, std::vector<float> z,
+                                        std::vector<uint32_t> indices,
+                                        std::vector<float> nx, std::vector<float> ny, std::vector<float> nz,
+                                        double rounding_error = 0.0);
+
+        /**
+         * Копия сетки с хранением во float. Наибольшее смещение вершины при
+         * округлении считается по факту и попадает в RoundingError()
+         */
+        Mesh ToSinglePrecision() const;
+
+        size_t VertexCount() const;
+        size_t TriangleCount() const;
+        bool HasNormals() const;
+        bool Empty() const;
+        bool IsSinglePrecision() const;
+
+        /**
+         * Верхняя граница смещения любой точки сетки относительно исходной геометрии
+         * (0 для double-сетки). Расстояние между двумя сетками отличается от точного
+         * не более чем на сумму их RoundingError()
+         */
+        double RoundingError() const;
+
+        // Массивы double-сетки (пустые при хранении во float)
+        const std::vector<double> &X() const;
+        const std::vector<double> &Y() const;
+        const std::vector<double> &Z() const;
+        const std::vector<uint32_t> &Indices() const;
+        const std::vector<double> &NX() const;
+        const std::vector<double> &NY() const;
+        const std::vector<double> &NZ() const;
+
+        // Массивы float-сетки (пустые при хранении в double)
+        const std::vector<float> &XF() const;
+        const std::vector<float> &YF() const;
+        const std::vector<float> &ZF() const;
+        const std::vector<float> &NXF() const;
+        const std::vector<float> &NYF() const;
+        const std::vector<float> &NZF() const;
+
+        uint32_t Index(const size_t triangle, const size_t corner) const
+        {
+            return indices_[3 * triangle + corner];
+        }
+
+        double Coord(const uint32_t vertex, const size_t axis) const
+        {
+            if (single_)
+            {
+                return axis == 0 ? xf_[vertex] : (axis == 1 ? yf_[vertex] : zf_[vertex]);
+            }
+            return axis == 0 ? x_[vertex] : (axis == 1 ? y_[vertex] : z_[vertex]);
+        }
+
+        Vector GetVertex(const size_t vertex) const;
+        Vector GetNorm(const size_t triangle) const;
+        Triangle GetTriangle(const size_t triangle) const;
+        Vector GetMidlePoint(const size_t triangle) const;
+
+        /**
+         * Границы треугольника по осям
+         */
+        void TriangleBounds(const size_t triangle,
+                            std::array<double, 3> &min_bounds, std::array<double, 3> &max_bounds) const;
+
+        std::vector<Triangle> ToTriangles() const;
+
+        /**
+         * Объём памяти буферов сетки в байтах
+         */
+        size_t MemoryBytes() const;
+    };
+
+} // namespace math
@@ -0,0 +1,326 @@
+#include "MeshCache.hpp"
+#include "MappedFile.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace read_stl
+{
+    using namespace math;
+    using namespace std::string_literals;
+
+    namespace
+    {
+        constexpr char kCacheMagic[8] = {'S', 'T', 'L', 'D', 'C', 'A', 'C', 'H'};
+        constexpr uint32_t kByteOrderMark = 0x01020304;
+
+        struct CacheHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint64_t source_hash;
+            uint64_t source_size;
+            double weld_tolerance;
+            uint32_t real_size; // Размер числа в буферах сетки: 4 (float) или 8 (double)
+            uint32_t reserved;
+            double rounding_error;
+            uint64_t num_vertices;
+            uint64_t num_triangles;
+            uint64_t num_nodes;
+            uint64_t num_primitives;
+        };
+
+        // Смещения секций файла кэша
+        struct CacheLayout
+        {
+            size_t vertices = 0;
+            size_t indices = 0;
+            size_t normals = 0;
+            size_t nodes = 0;
+            size_t primitives = 0;
+            size_t total = 0;
+        };
+
+        size_t AlignUp(const size_t offset) { return (offset + 7) & ~static_cast<size_t>(7); }
+
+        CacheLayout ComputeLayout(const size_t num_vertices, const size_t num_triangles, const size_t num_nodes,
+                                  const size_t num_primitives, const size_t real_size)
+        {
+            CacheLayout layout;
+            layout.vertices = AlignUp(sizeof(CacheHeader));
+            layout.indices = AlignUp(layout.vertices + 3 * num_vertices * real_size);
+            layout.normals = AlignUp(layout.indices + 3 * num_triangles * sizeof(uint32_t));
+            layout.nodes = AlignUp(layout.normals + 3 * num_triangles * real_size);
+            layout.primitives = AlignUp(layout.nodes + num_nodes * sizeof(AABBTreeNode));
+            layout.total = layout.primitives + num_primitives * sizeof(uint32_t);
+            return layout;
+        }
+
+        template <typename Real>
+        std::vector<Real> ReadArray(const char *data, const size_t index, const size_t count)
+        {
+            std::vector<Real> values(count);
+            std::memcpy(values.data(), data + index * count * sizeof(Real), count * sizeof(Real));
+            return values;
+        }
+
+        template <typename Real>
+        void WriteArray(char *data, const size_t index, const std::vector<Real> &values)
+        {
+            std::memcpy(data + index * values.size() * sizeof(Real), values.data(), values.size() * sizeof(Real));
+        }
+    } // namespace
+
+    uint64_t HashContent(const char *data, const size_t size)
+    {
+        // Раунды в духе xxHash64 по 8-байтовым словам и финальное перемешивание
+        constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+        constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+        constexpr uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+
+        uint64_t hash = kPrime3 ^ (static_cast<uint64_t>(size) * kPrime1);
+        size_t pos = 0;
+        for (; pos + 8 <= size; pos += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + pos, 8);
+            hash ^= std::rotl(word * kPrime2, 31) * kPrime1;
+            hash = std::rotl(hash, 27) * kPrime1 + kPrime3;
+        }
+        for (; pos < size; ++pos)
+        {
+            hash ^= static_cast<uint64_t>(static_cast<unsigned char>(data[pos])) * kPrime3;
+            hash = std::rotl(hash, 11) * kPrime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= kPrime2;
+        hash ^= hash >> 29;
+        hash *= kPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    MeshCache::MeshCache(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+    std::filesystem::path MeshCache::CachePath(const uint64_t hash, const ReadOptions &options) const
+    {
+        // Допуск записывается битами double: имя не зависит от форматирования числа
+        std::ostringstream name;
+        name << std::hex << std::setfill('0') << std::setw(16) << hash << '-' << std::setw(16)
+             << std::bit_cast<uint64_t>(options.weld_tolerance) << (options.single_precision ? "-f32" : "-f64")
+             << ".stlcache";
+        return directory_ / name.str();
+    }
+
+    CachedBody MeshCache::Load(const std::string &filename, const ReadOptions &options) const
+    {
+        CachedBody body;
+        uint64_t hash = 0;
+        size_t source_size = 0;
+
+        {
+            MappedFile source(filename);
+            source_size = source.Size();
+            hash = HashContent(source.Data(), source_size);
+
+            const std::filesystem::path path = CachePath(hash, options);
+            if (std::filesystem::exists(path) && TryLoad(path, hash, source_size, options, body))
+            {
+                return body;
+            }
+
+            body.mesh = std::make_shared<const Mesh>(IsBinarySTL(source.Data(), source_size)
+                                                         ? ReadBinarySTL(source, options)
+                                                         : ReadAsciiSTL(source, options));
+        }
+
+        body.tree = std::make_unique<AABBTree>(body.mesh, AABBTreeOptions{.num_threads = options.num_threads});
+
+        // Кэш - только ускорение, ошибка записи не мешает вычислениям
+        try
+        {
+            Store(CachePath(hash, options), hash, source_size, options, body);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Не удалось записать кэш для " << filename << ": " << e.what() << '\n';
+        }
+
+        return body;
+    }
+
+    bool MeshCache::TryLoad(const std::filesystem::path &path, const uint64_t hash, const size_t source_size,
+                            const ReadOptions &options, CachedBody &body) const
+    {
+        MappedFile file(path.string());
+        const char *data = file.Data();
+        if (file.Size() < sizeof(CacheHeader))
+        {
+            return false;
+        }
+
+        CacheHeader header;
+        std::memcpy(&header, data, sizeof(CacheHeader));
+        if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+            header.version != kCacheVersion ||
+            header.byte_order != kByteOrderMark ||
+            header.source_hash != hash ||
+            header.source_size != source_size ||
+            header.weld_tolerance != options.weld_tolerance ||
+            header.real_size != (options.single_precision ? sizeof(float) : sizeof(double)))
+        {
+            return false;
+        }
+
+        const size_t num_vertices = header.num_vertices;
+        const size_t num_triangles = header.num_triangles;
+        const CacheLayout layout = ComputeLayout(num_vertices, num_triangles, header.num_nodes, header.num_primitives,
+                                                 header.real_size);
+        if (layout.total != file.Size())
+        {
+            return false;
+        }
+
+        // Буферы сетки копируются из отображения одним блоком на массив
+        std::vector<uint32_t> indices(3 * num_triangles);
+        std::memcpy(indices.data(), data + layout.indices, indices.size() * sizeof(uint32_t));
+        const char *vertices = data + layout.vertices;
+        const char *normals = data + layout.normals;
+        try
+        {
+            if (options.single_precision)
+            {
+                body.mesh = std::make_shared<const Mesh>(Mesh::FromSinglePrecision(
+                    ReadArray<float>(vertices, 0, num_vertices),
+                    ReadArray<float>(vertices, 1, num_vertices),
+                    ReadArray<float>(vertices, 2, num_vertices),
+                    std::move(indices),
+                    ReadArray<float>(normals, 0, num_triangles),
+                    ReadArray<float>(normals, 1, num_triangles),
+                    ReadArray<float>(normals, 2, num_triangles),
+                    header.rounding_error));
+            }
+            else
+            {
+                body.mesh = std::make_shared<const Mesh>(
+                    ReadArray<double>(vertices, 0, num_vertices),
+                    ReadArray<double>(vertices, 1, num_vertices),
+                    ReadArray<double>(vertices, 2, num_vertices),
+                    std::move(indices),
+                    ReadArray<double>(normals, 0, num_triangles),
+                    ReadArray<double>(normals, 1, num_triangles),
+                    ReadArray<double>(normals, 2, num_triangles));
+            }
+
+            // Узлы и номера треугольников копируются в дерево без сортировки и пересчёта
+            // границ, упакованные вершины листьев дерево собирает по сетке за O(N)
+            const auto *nodes = reinterpret_cast<const AABBTreeNode *>(data + layout.nodes);
+            const auto *primitives = reinterpret_cast<const uint32_t *>(data + layout.primitives);
+            body.tree = std::make_unique<AABBTree>(body.mesh, nodes, header.num_nodes,
+                                                   primitives, header.num_primitives);
+        }
+        catch (const std::invalid_argument &)
+        {
+            body.mesh.reset();
+            return false;
+        }
+
+        body.from_cache = true;
+        return true;
+    }
+
+    void MeshCache::Store(const std::filesystem::path &path, const uint64_t hash, const size_t source_size,
+                          const ReadOptions &options, const CachedBody &body) const
+    {
+        const std::vector<AABBTreeNode> &nodes = body.tree->Nodes();
+        const std::vector<uint32_t> &primitives = body.tree->Primitives();
+
+        const Mesh &mesh = *body.mesh;
+        const size_t num_vertices = mesh.VertexCount();
+        const size_t num_triangles = mesh.TriangleCount();
+
+        CacheHeader header{};
+        std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+        header.version = kCacheVersion;
+        header.byte_order = kByteOrderMark;
+        header.source_hash = hash;
+        header.source_size = source_size;
+        header.weld_tolerance = options.weld_tolerance;
+        header.real_size = mesh.IsSinglePrecision() ? sizeof(float) : sizeof(double);
+        header.rounding_error = mesh.RoundingError();
+        header.num_vertices = num_vertices;
+        header.num_triangles = num_triangles;
+        header.num_nodes = nodes.size();
+        header.num_primitives = primitives.size();
+
+        const CacheLayout layout = ComputeLayout(num_vertices, num_triangles, nodes.size(), primitives.size(),
+                                                 header.real_size);
+        std::vector<char> content(layout.total, 0);
+        std::memcpy(content.data(), &header, sizeof(header));
+
+        // Буферы сетки пишутся как есть, без преобразований
+        char *vertices = content.data() + layout.vertices;
+        char *normals = content.data() + layout.normals;
+        std::memcpy(content.data() + layout.indices, mesh.Indices().data(), 3 * num_triangles * sizeof(uint32_t));
+        if (mesh.IsSinglePrecision())
+        {
+            WriteArray(vertices, 0, mesh.XF());
+            WriteArray(vertices, 1, mesh.YF());
+            WriteArray(vertices, 2, mesh.ZF());
+            if (mesh.HasNormals())
+            {
+                WriteArray(normals, 0, mesh.NXF());
+                WriteArray(normals, 1, mesh.NYF());
+                WriteArray(normals, 2, mesh.NZF());
+            }
+        }
+        else
+        {
+            WriteArray(vertices, 0, mesh.X());
+            WriteArray(vertices, 1, mesh.Y());
+            WriteArray(vertices, 2, mesh.Z());
+            if (mesh.HasNormals())
+            {
+                WriteArray(normals, 0, mesh.NX());
+                WriteArray(normals, 1, mesh.NY());
+                WriteArray(normals, 2, mesh.NZ());
+            }
+        }
+        std::memcpy(content.data() + layout.nodes, nodes.data(), nodes.size() * sizeof(AABBTreeNode));
+        std::memcpy(content.data() + layout.primitives, primitives.data(), primitives.size() * sizeof(uint32_t));
+
+        // Запись во временный файл и переименование, чтобы параллельные запуски
+        // никогда не увидели недописанный кэш
+        std::filesystem::create_directories(directory_);
+        const std::filesystem::path tmp_path =
+            path.string() + ".tmp"s + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+            {
+                throw std::runtime_error("Cannot create cache file: "s + tmp_path.string());
+            }
+            out.write(content.data(), static_cast<std::streamsize>(content.size()));
+            if (!out)
+            {
+                throw std::runtime_error("Cannot write cache file: "s + tmp_path.string());
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tmp_path, path, error);
+        if (error)
+        {
+            std::filesystem::remove(tmp_path, error);
+        }
+    }
+
+} // namespace read_stl
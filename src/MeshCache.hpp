@@ -0,0 +1,78 @@
+#pragma once
+
+#include "AABBTree.hpp"
+#include "Mesh.hpp"
+#include "ReadSTL.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace read_stl
+{
+    /**
+     * 64-битный хеш содержимого файла (ключ кэша)
+     */
+    uint64_t HashContent(const char *data, size_t size);
+
+    /**
+     * Тело, готовое к вычислению расстояний: сетка и построенное по ней дерево
+     */
+    struct CachedBody
+    {
+        std::shared_ptr<const math::Mesh> mesh;
+        std::unique_ptr<math::AABBTree> tree;
+        bool from_cache = false;
+    };
+
+    /**
+     * Кэш разобранных STL-файлов. Для каждого файла хранятся буферы сетки
+     * (см. Mesh) и дерево в плоском виде. Файл кэша называется
+     * по хешу содержимого STL и параметрам чтения, поэтому переименование исходника
+     * кэш не сбрасывает, изменение содержимого - сбрасывает, а чтения с разными
+     * ReadOptions хранятся в разных файлах и не вытесняют друг друга. Кэш читается через отображение в память;
+     * при попадании каждый массив копируется в сетку или дерево одним блоком, а упакованные
+     * вершины листьев собираются заново за O(N). Разбор STL, сварка вершин, сортировка
+     * треугольников и расчёт границ узлов не выполняются, но данные в памяти - копии,
+     * а не виды на отображение.
+     *
+     * Формат (все числа в порядке байтов машины, секции выровнены на 8 байт,
+     * real - double или float в зависимости от ReadOptions::single_precision):
+     *   заголовок CacheHeader,
+     *   real[num_vertices] x 3 - координаты вершин x[], y[], z[],
+     *   uint32_t[3 * num_triangles] - индексы вершин треугольников,
+     *   real[num_triangles] x 3 - нормали nx[], ny[], nz[],
+     *   AABBTreeNode[num_nodes] - узлы дерева,
+     *   uint32_t[num_primitives] - номера треугольников листьев.
+     * При изменении формата увеличивается kCacheVersion.
+     */
+    class MeshCache
+    {
+    private:
+        std::filesystem::path directory_;
+
+        bool TryLoad(const std::filesystem::path &path, uint64_t hash, size_t source_size,
+                     const ReadOptions &options, CachedBody &body) const;
+        void Store(const std::filesystem::path &path, uint64_t hash, size_t source_size,
+                   const ReadOptions &options, const CachedBody &body) const;
+
+    public:
+        static constexpr uint32_t kCacheVersion = 5;
+
+        explicit MeshCache(std::filesystem::path directory);
+
+        /**
+         * Тело из кэша, а при промахе - чтение STL, построение дерева и запись в кэш.
+         * Разбор и построение используют options.num_threads потоков
+         */
+        CachedBody Load(const std::string &filename, const ReadOptions &options = {}) const;
+
+        /**
+         * Путь файла кэша: <хеш>-<биты weld_tolerance>-<f32|f64>.stlcache
+         */
+        std::filesystem::path CachePath(uint64_t hash, const ReadOptions &options = {}) const;
+    };
+
+} // namespace read_stl
@@ -0,0 +1,367 @@
+#include "OBBTree.hpp"
+#include "Vec3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace math
+{
+    namespace
+    {
+        using Matrix3 = std::array<std::array<double, 3>, 3>;
+
+        // Запас полуразмеров относительно величины координат: покрывает округления
+        // при проекциях и в оценке расстояния, так что бокс остаётся объемлющим
+        constexpr double kRelativeMargin = 1e-9;
+
+        using vec3::Dot;
+
+        /**
+         * Собственные векторы симметричной матрицы 3x3 методом вращений Якоби.
+         * Столбцы vectors - собственные векторы (ортонормированные при любой точности)
+         */
+        void EigenVectors(Matrix3 a, Matrix3 &vectors)
+        {
+            vectors = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+            for (size_t sweep = 0; sweep != 32; ++sweep)
+            {
+                const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+                const double diag = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+                if (off <= 1e-30 * diag)
+                {
+                    return;
+                }
+                for (size_t p = 0; p != 2; ++p)
+                {
+                    for (size_t q = p + 1; q != 3; ++q)
+                    {
+                        if (a[p][q] == 0.0)
+                        {
+                            continue;
+                        }
+                        const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                        const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                        const double c = 1.0 / std::sqrt(t * t + 1.0);
+                        const double s = t * c;
+                        for (size_t k = 0; k != 3; ++k)
+                        {
+                            const double kp = a[k][p], kq = a[k][q];
+                            a[k][p] = c * kp - s * kq;
+                            a[k][q] = s * kp + c * kq;
+                        }
+                        for (size_t k = 0; k != 3; ++k)
+                        {
+                            const double pk = a[p][k], qk = a[q][k];
+                            a[p][k] = c * pk - s * qk;
+                            a[q][k] = s * pk + c * qk;
+                        }
+                        for (size_t k = 0; k != 3; ++k)
+                        {
+                            const double kp = vectors[k][p], kq = vectors[k][q];
+                            vectors[k][p] = c * kp - s * kq;
+                            vectors[k][q] = s * kp + c * kq;
+                        }
+                    }
+                }
+            }
+        }
+    } // namespace
+
+    OBBTree::OBBTree(const AABBTree &tree, const BoundingVolume volume) : tree_(tree), volume_(volume)
+    {
+        Refit();
+    }
+
+    void OBBTree::Refit()
+    {
+        // Перестроенные при AABBTree::Refit поддеревья могли изменить число узлов
+        nodes_.resize(tree_.Nodes().size());
+        if (!nodes_.empty())
+        {
+            FitRecursive(0, volume_);
+        }
+    }
+
+    std::pair<size_t, size_t> OBBTree::FitRecursive(const uint32_t node, const BoundingVolume volume)
+    {
+        // Диапазон номеров треугольников поддерева в Primitives() (при построении
+        // деревом он непрерывен, иначе берётся объемлющий диапазон - бокс лишь шире)
+        const AABBTreeNode &box = tree_.Nodes()[node];
+        std::pair<size_t, size_t> range;
+        if (box.IsLeaf())
+        {
+            range = {box.offset, static_cast<size_t>(box.offset) + box.count};
+        }
+        else
+        {
+            const std::pair<size_t, size_t> left = FitRecursive(node + 1, volume);
+            const std::pair<size_t, size_t> right = FitRecursive(box.offset, volume);
+            range = {std::min(left.first, right.first), std::max(left.second, right.second)};
+        }
+        FitNode(node, range.first, range.second, volume);
+        return range;
+    }
+
+    void OBBTree::FitNode(const uint32_t node, const size_t start, const size_t end, const BoundingVolume volume)
+    {
+        const Mesh &mesh = tree_.GetMesh();
+        const std::vector<uint32_t> &primitives = tree_.Primitives();
+        const AABBTreeNode &box = tree_.Nodes()[node];
+        OBBTreeNode &result = nodes_[node];
+
+        // Бокс по осям координат из исходного дерева
+        double scale = 0.0;
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            const double min_bound = box.min_bounds[axis], max_bound = box.max_bounds[axis];
+            result.center[axis] = 0.5 * (min_bound + max_bound);
+            result.half_sizes[axis] = 0.5 * (max_bound - min_bound);
+            scale = std::max({scale, std::abs(min_bound), std::abs(max_bound)});
+        }
+        result.axes = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+
+        if (volume == BoundingVolume::OBB)
+        {
+            // Главные оси: собственные векторы ковариации вершин (относительно центра
+            // бокса, чтобы не терять точность на удалённых от начала координат деталях)
+            const std::array<double, 3> origin = result.center;
+            std::array<double, 3> mean{};
+            Matrix3 covariance{};
+            const double num_vertices = 3.0 * static_cast<double>(end - start);
+            for (size_t i = start; i != end; ++i)
+            {
+                for (size_t corner = 0; corner != 3; ++corner)
+                {
+                    const uint32_t vertex = mesh.Index(primitives[i], corner);
+                    std::array<double, 3> p{};
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        p[axis] = mesh.Coord(vertex, axis) - origin[axis];
+                        mean[axis] += p[axis];
+                    }
+                    for (size_t r = 0; r != 3; ++r)
+                    {
+                        for (size_t c = 0; c != 3; ++c)
+                        {
+                            covariance[r][c] += p[r] * p[c];
+                        }
+                    }
+                }
+            }
+            for (size_t r = 0; r != 3; ++r)
+            {
+                mean[r] /= num_vertices;
+            }
+            for (size_t r = 0; r != 3; ++r)
+            {
+                for (size_t c = 0; c != 3; ++c)
+                {
+                    covariance[r][c] = covariance[r][c] / num_vertices - mean[r] * mean[c];
+                }
+            }
+
+            Matrix3 vectors;
+            EigenVectors(covariance, vectors);
+            Matrix3 axes;
+            for (size_t k = 0; k != 3; ++k)
+            {
+                axes[k] = {vectors[0][k], vectors[1][k], vectors[2][k]};
+            }
+
+            // Размеры - по проекциям всех вершин на оси
+            std::array<double, 3> min_proj, max_proj;
+            min_proj.fill(std::numeric_limits<double>::max());
+            max_proj.fill(std::numeric_limits<double>::lowest());
+            for (size_t i = start; i != end; ++i)
+            {
+                for (size_t corner = 0; corner != 3; ++corner)
+                {
+                    const uint32_t vertex = mesh.Index(primitives[i], corner);
+                    const std::array<double, 3> p = {mesh.Coord(vertex, 0) - origin[0],
+                                                     mesh.Coord(vertex, 1) - origin[1],
+                                                     mesh.Coord(vertex, 2) - origin[2]};
+                    for (size_t k = 0; k != 3; ++k)
+                    {
+                        const double projection = Dot(axes[k], p);
+                        min_proj[k] = std::min(min_proj[k], projection);
+                        max_proj[k] = std::max(max_proj[k], projection);
+                    }
+                }
+            }
+
+            // Ориентированный бокс берётся, только если его поверхность меньше, чем у бокса
+            // по осям (площадь, а не объём, чтобы сравнивать и плоские боксы)
+            const std::array<double, 3> &h = result.half_sizes;
+            const double aabb_area = 4.0 * (h[0] * h[1] + h[1] * h[2] + h[2] * h[0]);
+            const std::array<double, 3> size = {max_proj[0] - min_proj[0], max_proj[1] - min_proj[1],
+                                                max_proj[2] - min_proj[2]};
+            const double obb_area = size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+            if (obb_area < aabb_area)
+            {
+                result.axes = axes;
+                for (size_t axis = 0; axis != 3; ++axis)
+                {
+                    result.center[axis] = origin[axis];
+                    for (size_t k = 0; k != 3; ++k)
+                    {
+                        result.center[axis] += axes[k][axis] * 0.5 * (min_proj[k] + max_proj[k]);
+                    }
+                }
+                for (size_t k = 0; k != 3; ++k)
+                {
+                    result.half_sizes[k] = 0.5 * (max_proj[k] - min_proj[k]);
+                }
+            }
+        }
+
+        for (double &half_size : result.half_sizes)
+        {
+            half_size += kRelativeMargin * scale;
+        }
+    }
+
+    const AABBTree &OBBTree::GetTree() const { return tree_; }
+
+    const std::vector<OBBTreeNode> &OBBTree::Nodes() const { return nodes_; }
+
+    size_t OBBTree::MemoryBytes() const { return nodes_.capacity() * sizeof(OBBTreeNode); }
+
+    double OBBTree::Distance(const OBBTreeNode &box1, const OBBTreeNode &box2)
+    {
+        const std::array<double, 3> &a = box1.half_sizes;
+        const std::array<double, 3> &b = box2.half_sizes;
+
+        // rotation[i][j] - косинус угла между i-й осью первого и j-й осью второго,
+        // offset - центр второго бокса в осях первого
+        Matrix3 rotation, abs_rotation;
+        std::array<double, 3> offset;
+        const std::array<double, 3> delta = {box2.center[0] - box1.center[0], box2.center[1] - box1.center[1],
+                                             box2.center[2] - box1.center[2]};
+        for (size_t i = 0; i != 3; ++i)
+        {
+            offset[i] = Dot(box1.axes[i], delta);
+            for (size_t j = 0; j != 3; ++j)
+            {
+                rotation[i][j] = Dot(box1.axes[i], box2.axes[j]);
+                abs_rotation[i][j] = std::abs(rotation[i][j]);
+            }
+        }
+
+        // Евклидово расстояние от каждого бокса до бокса, описанного вокруг другого
+        // в его осях (оси граней с учётом всех трёх направлений сразу)
+        double squared_1 = 0.0, squared_2 = 0.0;
+        for (size_t i = 0; i != 3; ++i)
+        {
+            const double radius = b[0] * abs_rotation[i][0] + b[1] * abs_rotation[i][1] + b[2] * abs_rotation[i][2];
+            const double gap = std::abs(offset[i]) - a[i] - radius;
+            squared_1 += gap > 0.0 ? gap * gap : 0.0;
+        }
+        for (size_t j = 0; j != 3; ++j)
+        {
+            const double projection = offset[0] * rotation[0][j] + offset[1] * rotation[1][j] + offset[2] * rotation[2][j];
+            const double radius = a[0] * abs_rotation[0][j] + a[1] * abs_rotation[1][j] + a[2] * abs_rotation[2][j];
+            const double gap = std::abs(projection) - b[j] - radius;
+            squared_2 += gap > 0.0 ? gap * gap : 0.0;
+        }
+        double distance = std::sqrt(std::max(squared_1, squared_2));
+
+        // Разделяющие оси - векторные произведения осей (почти параллельные пропускаются,
+        // их заменяют оси граней)
+        for (size_t i = 0; i != 3; ++i)
+        {
+            const size_t i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+            for (size_t j = 0; j != 3; ++j)
+            {
+                const double squared_length = 1.0 - rotation[i][j] * rotation[i][j];
+                if (squared_length < 1e-12)
+                {
+                    continue;
+                }
+                const size_t j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                const double radius_1 = a[i1] * abs_rotation[i2][j] + a[i2] * abs_rotation[i1][j];
+                const double radius_2 = b[j1] * abs_rotation[i][j2] + b[j2] * abs_rotation[i][j1];
+                const double projection = std::abs(offset[i2] * rotation[i1][j] - offset[i1] * rotation[i2][j]);
+                distance = std::max(distance, (projection - radius_1 - radius_2) / std::sqrt(squared_length));
+            }
+        }
+
+        return distance;
+    }
+
+    void OBBTree::FindClosestRecursive(const OBBTree &other, const uint32_t node1, const uint32_t node2,
+                                       size_t &closest1, size_t &closest2, double &min_distance,
+                                       AABBTreeQueryStats *stats) const
+    {
+        if (stats)
+        {
+            ++stats->node_pairs;
+        }
+        if (Distance(nodes_[node1], other.nodes_[node2]) >= min_distance)
+        {
+            return;
+        }
+        if (stats)
+        {
+            ++stats->expanded_pairs;
+        }
+
+        const AABBTreeNode &box1 = tree_.Nodes()[node1];
+        const AABBTreeNode &box2 = other.tree_.Nodes()[node2];
+        if (box1.IsLeaf() && box2.IsLeaf())
+        {
+            tree_.LeafToLeaf(other.tree_, box1, box2, closest1, closest2, min_distance, stats);
+            return;
+        }
+
+        // Потомки - как в AABBTree (левый - следующий узел), сначала более близкие пары
+        std::array<std::pair<double, std::array<uint32_t, 2>>, 4> pairs;
+        size_t num_pairs = 0;
+        const auto add = [&](const uint32_t child1, const uint32_t child2)
+        {
+            pairs[num_pairs++] = {Distance(nodes_[child1], other.nodes_[child2]), {child1, child2}};
+        };
+        if (box1.IsLeaf())
+        {
+            add(node1, node2 + 1);
+            add(node1, box2.offset);
+        }
+        else if (box2.IsLeaf())
+        {
+            add(node1 + 1, node2);
+            add(box1.offset, node2);
+        }
+        else
+        {
+            add(node1 + 1, node2 + 1);
+            add(node1 + 1, box2.offset);
+            add(box1.offset, node2 + 1);
+            add(box1.offset, box2.offset);
+        }
+        std::stable_sort(pairs.begin(), pairs.begin() + static_cast<std::ptrdiff_t>(num_pairs),
+                         [](const auto &a, const auto &b)
+                         { return a.first < b.first; });
+        for (size_t i = 0; i != num_pairs; ++i)
+        {
+            FindClosestRecursive(other, pairs[i].second[0], pairs[i].second[1], closest1, closest2, min_distance,
+                                 stats);
+        }
+    }
+
+    void OBBTree::FindClosestTriangles(const OBBTree &other, size_t &closest1,
+                                       size_t &closest2, double &min_distance,
+                                       AABBTreeQueryStats *stats) const
+    {
+        closest1 = AABBTree::kNoTriangle;
+        closest2 = AABBTree::kNoTriangle;
+        min_distance = std::numeric_limits<double>::max();
+
+        if (nodes_.empty() || other.nodes_.empty())
+        {
+            return;
+        }
+
+        FindClosestRecursive(other, 0, 0, closest1, closest2, min_distance, stats);
+    }
+
+} // namespace math
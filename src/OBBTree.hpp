@@ -0,0 +1,91 @@
+#pragma once
+
+#include "AABBTree.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace math
+{
+    /**
+     * Ориентированный бокс узла: центр, три единичные взаимно ортогональные оси
+     * и полуразмеры вдоль них
+     */
+    struct OBBTreeNode
+    {
+        std::array<double, 3> center;
+        std::array<std::array<double, 3>, 3> axes;
+        std::array<double, 3> half_sizes;
+    };
+
+    /**
+     * Вид ограничивающего объёма тела
+     */
+    enum class BoundingVolume
+    {
+        AABB, // Боксы узлов AABB-дерева (оси координат)
+        OBB   // Боксы по главным осям вершин узла
+    };
+
+    /**
+     * Иерархия ориентированных боксов поверх AABB-дерева: узлы и листья те же,
+     * у каждого узла вместо бокса по осям координат - бокс по главным осям
+     * (собственным векторам ковариации) его вершин. Для тонких наклонных деталей
+     * (лопатки, трубы по диагонали) такие боксы намного плотнее.
+     * Вид объёма выбирается для каждого тела отдельно: тело с BoundingVolume::AABB
+     * использует боксы исходного дерева, и такие тела можно сравнивать с телами OBB.
+     * Исходное дерево должно жить дольше иерархии. Боксы подбираются по вершинам при
+     * построении, поэтому после AABBTree::Refit исходного дерева нужно вызвать Refit:
+     * устаревшие боксы могут не содержать перемещённые треугольники и отсечь ближайшую пару
+     */
+    class OBBTree
+    {
+    private:
+        const AABBTree &tree_;
+        BoundingVolume volume_;
+        std::vector<OBBTreeNode> nodes_; // По номерам узлов исходного дерева
+
+        void FitNode(uint32_t node, size_t start, size_t end, BoundingVolume volume);
+        std::pair<size_t, size_t> FitRecursive(uint32_t node, BoundingVolume volume);
+
+        void FindClosestRecursive(const OBBTree &other, uint32_t node1, uint32_t node2,
+                                  size_t &closest1, size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats) const;
+
+    public:
+        explicit OBBTree(const AABBTree &tree, BoundingVolume volume = BoundingVolume::OBB);
+
+        /**
+         * Подбор боксов всех узлов заново после AABBTree::Refit исходного дерева
+         * (с тем же видом объёма)
+         */
+        void Refit();
+
+        const AABBTree &GetTree() const;
+        const std::vector<OBBTreeNode> &Nodes() const;
+
+        /**
+         * Объём памяти боксов в байтах (без исходного дерева)
+         */
+        size_t MemoryBytes() const;
+
+        /**
+         * Нижняя граница расстояния между содержимым двух боксов: наибольшая из
+         * оценок по разделяющим осям (9 векторных произведений осей) и евклидовых
+         * расстояний до бокса, описанного вокруг другого в системе осей каждого.
+         * Для пересекающихся боксов - 0
+         */
+        static double Distance(const OBBTreeNode &box1, const OBBTreeNode &box2);
+
+        /**
+         * Ближайшая пара треугольников двух тел, как в AABBTree::FindClosestTriangles
+         */
+        void FindClosestTriangles(const OBBTree &other, size_t &closest1,
+                                  size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats = nullptr) const;
+    };
+
+} // namespace math
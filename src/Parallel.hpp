@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+    /**
+     * Число потоков по умолчанию (не меньше одного)
+     */
+    inline size_t DefaultThreadCount()
+    {
+        const size_t count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    /**
+     * Число потоков с учётом значения по умолчанию (0 - все ядра)
+     */
+    inline size_t ResolveThreadCount(const size_t num_threads)
+    {
+        return num_threads == 0 ? DefaultThreadCount() : num_threads;
+    }
+
+    /**
+     * Выполнение func(chunk) для chunk из [0, num_chunks) на num_threads потоках.
+     * Каждая задача выполняется ровно один раз, вызывающий поток тоже работает.
+     * Первое выброшенное исключение пробрасывается наружу после завершения всех потоков
+     */
+    template <class Func>
+    void ParallelFor(const size_t num_chunks, Func &&func, size_t num_threads = 0)
+    {
+        num_threads = std::min(ResolveThreadCount(num_threads), num_chunks);
+        if (num_threads <= 1)
+        {
+            for (size_t chunk = 0; chunk != num_chunks; ++chunk)
+            {
+                func(chunk);
+            }
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors(num_threads);
+        auto worker = [&](const size_t thread_index)
+        {
+            try
+            {
+                for (size_t chunk = thread_index; chunk < num_chunks; chunk += num_threads)
+                {
+                    func(chunk);
+                }
+            }
+            catch (...)
+            {
+                errors[thread_index] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (size_t i = 1; i != num_threads; ++i)
+        {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const std::exception_ptr &error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    /**
+     * Разбиение диапазона [0, count) на num_chunks почти равных частей и
+     * параллельный вызов func(begin, end, chunk) для каждой из них
+     */
+    template <class Func>
+    void ParallelForRange(const size_t count, const size_t num_chunks, Func &&func, size_t num_threads = 0)
+    {
+        if (count == 0 || num_chunks == 0)
+        {
+            return;
+        }
+        ParallelFor(
+            num_chunks,
+            [&](const size_t chunk)
+            {
+                const size_t begin = count * chunk / num_chunks;
+                const size_t end = count * (chunk + 1) / num_chunks;
+                func(begin, end, chunk);
+            },
+            num_threads);
+    }
+
+    /**
+     * Выполнение func(task, thread_index) для task из [0, num_tasks) с перехватом
+     * работы: каждый поток получает подряд идущий блок задач и берёт их с начала,
+     * а закончив свои, забирает задачи с конца блока самого загруженного потока.
+     * Подходит для задач сильно разной длительности. Задачи с меньшими номерами
+     * каждого блока начинаются раньше. Исключения - как в ParallelFor
+     */
+    template <class Func>
+    void ParallelForStealing(const size_t num_tasks, Func &&func, size_t num_threads = 0)
+    {
+        num_threads = std::min(ResolveThreadCount(num_threads), num_tasks);
+        if (num_threads <= 1)
+        {
+            for (size_t task = 0; task != num_tasks; ++task)
+            {
+                func(task, size_t{0});
+            }
+            return;
+        }
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+        std::vector<Queue> queues(num_threads);
+        for (size_t thread_index = 0; thread_index != num_threads; ++thread_index)
+        {
+            const size_t begin = num_tasks * thread_index / num_threads;
+            const size_t end = num_tasks * (thread_index + 1) / num_threads;
+            for (size_t task = begin; task != end; ++task)
+            {
+                queues[thread_index].tasks.push_back(task);
+            }
+        }
+
+        const auto pop_own = [&queues](const size_t thread_index, size_t &task)
+        {
+            std::lock_guard<std::mutex> lock(queues[thread_index].mutex);
+            if (queues[thread_index].tasks.empty())
+            {
+                return false;
+            }
+            task = queues[thread_index].tasks.front();
+            queues[thread_index].tasks.pop_front();
+            return true;
+        };
+        const auto steal = [&queues, num_threads](size_t &task)
+        {
+            while (true)
+            {
+                // Жертва - поток с наибольшим числом оставшихся задач
+                size_t victim = num_threads, victim_size = 0;
+                for (size_t i = 0; i != num_threads; ++i)
+                {
+                    std::lock_guard<std::mutex> lock(queues[i].mutex);
+                    if (queues[i].tasks.size() > victim_size)
+                    {
+                        victim = i;
+                        victim_size = queues[i].tasks.size();
+                    }
+                }
+                if (victim == num_threads)
+                {
+                    return false;
+                }
+
+                std::lock_guard<std::mutex> lock(queues[victim].mutex);
+                if (!queues[victim].tasks.empty())
+                {
+                    task = queues[victim].tasks.back();
+                    queues[victim].tasks.pop_back();
+                    return true;
+                }
+            }
+        };
+
+        std::vector<std::exception_ptr> errors(num_threads);
+        auto worker = [&](const size_t thread_index)
+        {
+            try
+            {
+                size_t task = 0;
+                while (pop_own(thread_index, task) || steal(task))
+                {
+                    func(task, thread_index);
+                }
+            }
+            catch (...)
+            {
+                errors[thread_index] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (size_t i = 1; i != num_threads; ++i)
+        {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const std::exception_ptr &error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    /**
+     * Устойчивая поразрядная сортировка пар (keys[i], values[i]) по ключу, по 8 бит
+     * за проход, на num_chunks частях. Каждая часть считает гистограмму своих ключей,
+     * по префиксным суммам гистограмм части раскладывают элементы в общий буфер.
+     * Проход пропускается, если у всех ключей одинаковый разряд. Результат не зависит
+     * от числа частей
+     */
+    template <class Value>
+    void ParallelRadixSort(std::vector<uint32_t> &keys, std::vector<Value> &values, size_t num_chunks,
+                           const size_t num_threads = 0)
+    {
+        constexpr size_t kRadix = 256;
+        const size_t count = keys.size();
+        num_chunks = std::max<size_t>(1, std::min(num_chunks, count));
+
+        std::vector<uint32_t> sorted_keys(count);
+        std::vector<Value> sorted_values(count);
+        std::vector<std::array<size_t, kRadix>> offsets(num_chunks);
+        for (uint32_t shift = 0; shift < 32; shift += 8)
+        {
+            ParallelForRange(
+                count, num_chunks,
+                [&](const size_t begin, const size_t end, const size_t chunk)
+                {
+                    std::array<size_t, kRadix> &histogram = offsets[chunk];
+                    histogram.fill(0);
+                    for (size_t i = begin; i != end; ++i)
+                    {
+                        ++histogram[(keys[i] >> shift) & (kRadix - 1)];
+                    }
+                },
+                num_threads);
+
+            // Смещения: сначала по разрядам, внутри разряда - по частям в порядке следования
+            size_t total = 0;
+            bool single_digit = false;
+            for (size_t digit = 0; digit != kRadix; ++digit)
+            {
+                size_t digit_count = 0;
+                for (size_t chunk = 0; chunk != num_chunks; ++chunk)
+                {
+                    const size_t chunk_count = offsets[chunk][digit];
+                    offsets[chunk][digit] = total + digit_count;
+                    digit_count += chunk_count;
+                }
+                single_digit = single_digit || digit_count == count;
+                total += digit_count;
+            }
+            if (single_digit)
+            {
+                continue;
+            }
+
+            ParallelForRange(
+                count, num_chunks,
+                [&](const size_t begin, const size_t end, const size_t chunk)
+                {
+                    std::array<size_t, kRadix> &offset = offsets[chunk];
+                    for (size_t i = begin; i != end; ++i)
+                    {
+                        const size_t position = offset[(keys[i] >> shift) & (kRadix - 1)]++;
+                        sorted_keys[position] = keys[i];
+                        sorted_values[position] = values[i];
+                    }
+                },
+                num_threads);
+            keys.swap(sorted_keys);
+            values.swap(sorted_values);
+        }
+    }
+
+} // namespace parallel
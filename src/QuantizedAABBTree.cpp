@@ -0,0 +1,298 @@
+#include "QuantizedAABBTree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std::string_literals;
+
+namespace math
+{
+    namespace
+    {
+        // Граница по целому значению q внутри отрезка [low, high]. Концы отрезка
+        // восстанавливаются точно, остальные значения монотонно растут с q
+        template <typename T>
+        float Dequantize(const float low, const float high, const T q)
+        {
+            constexpr T kLevels = std::numeric_limits<T>::max();
+            if (q == 0)
+            {
+                return low;
+            }
+            if (q == kLevels)
+            {
+                return high;
+            }
+            const float step = (high - low) * (1.0f / static_cast<float>(kLevels));
+            return low + static_cast<float>(q) * step;
+        }
+
+        // Наибольшее q, для которого граница не больше value
+        template <typename T>
+        T QuantizeDown(const float low, const float high, const float value)
+        {
+            constexpr T kLevels = std::numeric_limits<T>::max();
+            const double scaled = std::floor((static_cast<double>(value) - low) /
+                                             (static_cast<double>(high) - low) * kLevels);
+            T q = scaled >= 0.0 && scaled <= kLevels ? static_cast<T>(scaled) : (scaled > 0.0 ? kLevels : T{0});
+            while (q != 0 && Dequantize(low, high, q) > value)
+            {
+                --q;
+            }
+            return q;
+        }
+
+        // Наименьшее q, для которого граница не меньше value
+        template <typename T>
+        T QuantizeUp(const float low, const float high, const float value)
+        {
+            constexpr T kLevels = std::numeric_limits<T>::max();
+            const double scaled = std::ceil((static_cast<double>(value) - low) /
+                                            (static_cast<double>(high) - low) * kLevels);
+            T q = scaled >= 0.0 && scaled <= kLevels ? static_cast<T>(scaled) : (scaled > 0.0 ? kLevels : T{0});
+            while (q != kLevels && Dequantize(low, high, q) < value)
+            {
+                ++q;
+            }
+            return q;
+        }
+
+        double BoxDistance(const float (&min1)[3], const float (&max1)[3],
+                           const float (&min2)[3], const float (&max2)[3])
+        {
+            double distance = 0.0;
+            for (size_t i = 0; i != 3; ++i)
+            {
+                if (max1[i] < min2[i])
+                {
+                    distance += std::pow(static_cast<double>(min2[i]) - max1[i], 2);
+                }
+                else if (max2[i] < min1[i])
+                {
+                    distance += std::pow(static_cast<double>(min1[i]) - max2[i], 2);
+                }
+            }
+            return std::sqrt(distance);
+        }
+    } // namespace
+
+    template <typename T>
+    QuantizedAABBTree<T>::QuantizedAABBTree(const AABBTree &tree) : mesh_(tree.mesh_)
+    {
+        const std::vector<AABBTreeNode> &binary = tree.Nodes();
+        if (binary.empty())
+        {
+            return;
+        }
+        if (tree.Primitives().size() > (std::numeric_limits<uint32_t>::max() >> kLinkShift))
+        {
+            throw std::invalid_argument("Too many triangles for a quantized AABB tree: "s +
+                                        std::to_string(tree.Primitives().size()));
+        }
+        primitives_ = tree.Primitives();
+
+        // Сжатый узел заменяет внутренний узел двоичного дерева
+        nodes_.reserve(binary.size() / 2);
+        std::copy(binary[0].min_bounds, binary[0].min_bounds + 3, root_.min_bounds);
+        std::copy(binary[0].max_bounds, binary[0].max_bounds + 3, root_.max_bounds);
+        root_.link = binary[0].IsLeaf() ? (binary[0].offset << kLinkShift) | binary[0].count
+                                        : Compress(binary, 0, root_) << kLinkShift;
+        nodes_.shrink_to_fit();
+    }
+
+    template <typename T>
+    QuantizedAABBTree<T>::QuantizedAABBTree(std::shared_ptr<const Mesh> mesh, const AABBTreeOptions &options)
+        : QuantizedAABBTree(AABBTree(std::move(mesh), options))
+    {
+    }
+
+    template <typename T>
+    uint32_t QuantizedAABBTree<T>::Compress(const std::vector<AABBTreeNode> &binary, const uint32_t binary_node,
+                                            const Entry &entry)
+    {
+        const uint32_t index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+
+        const std::array<uint32_t, 2> children = {binary_node + 1, binary[binary_node].offset};
+        for (size_t slot = 0; slot != 2; ++slot)
+        {
+            const AABBTreeNode &child = binary[children[slot]];
+            QuantizedAABBTreeNode<T> &node = nodes_[index];
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                node.min_bounds[slot][axis] = QuantizeDown<T>(entry.min_bounds[axis], entry.max_bounds[axis],
+                                                              child.min_bounds[axis]);
+                node.max_bounds[slot][axis] = QuantizeUp<T>(entry.min_bounds[axis], entry.max_bounds[axis],
+                                                            child.max_bounds[axis]);
+            }
+
+            // Потомки сжимаются относительно распакованного, а не исходного бокса:
+            // при обходе известен только он
+            Entry child_entry{};
+            ChildBounds(node, slot, entry.min_bounds, entry.max_bounds, child_entry.min_bounds,
+                        child_entry.max_bounds);
+            const uint32_t link = child.IsLeaf() ? (child.offset << kLinkShift) | child.count
+                                                 : Compress(binary, children[slot], child_entry) << kLinkShift;
+
+            // Ссылка берётся заново: рекурсия могла перераспределить массив
+            nodes_[index].link[slot] = link;
+        }
+        return index;
+    }
+
+    template <typename T>
+    const Mesh &QuantizedAABBTree<T>::GetMesh() const { return *mesh_; }
+
+    template <typename T>
+    const std::vector<QuantizedAABBTreeNode<T>> &QuantizedAABBTree<T>::Nodes() const { return nodes_; }
+
+    template <typename T>
+    const std::vector<uint32_t> &QuantizedAABBTree<T>::Primitives() const { return primitives_; }
+
+    template <typename T>
+    size_t QuantizedAABBTree<T>::MemoryBytes() const
+    {
+        return nodes_.capacity() * sizeof(QuantizedAABBTreeNode<T>) + primitives_.capacity() * sizeof(uint32_t) +
+               sizeof(root_);
+    }
+
+    template <typename T>
+    void QuantizedAABBTree<T>::ChildBounds(const QuantizedAABBTreeNode<T> &node, const size_t slot,
+                                           const float (&parent_min)[3], const float (&parent_max)[3],
+                                           float (&min_bounds)[3], float (&max_bounds)[3])
+    {
+        for (size_t axis = 0; axis != 3; ++axis)
+        {
+            min_bounds[axis] = Dequantize(parent_min[axis], parent_max[axis], node.min_bounds[slot][axis]);
+            max_bounds[axis] = Dequantize(parent_min[axis], parent_max[axis], node.max_bounds[slot][axis]);
+        }
+    }
+
+    template <typename T>
+    void QuantizedAABBTree<T>::RootBounds(float (&min_bounds)[3], float (&max_bounds)[3]) const
+    {
+        std::copy(root_.min_bounds, root_.min_bounds + 3, min_bounds);
+        std::copy(root_.max_bounds, root_.max_bounds + 3, max_bounds);
+    }
+
+    template <typename T>
+    void QuantizedAABBTree<T>::FindClosestRecursive(const QuantizedAABBTree &other, const Entry &entry1,
+                                                    const Entry &entry2, size_t &closest1, size_t &closest2,
+                                                    double &min_distance, AABBTreeQueryStats *stats) const
+    {
+        if (stats)
+        {
+            ++stats->node_pairs;
+        }
+
+        const double distance = BoxDistance(entry1.min_bounds, entry1.max_bounds,
+                                            entry2.min_bounds, entry2.max_bounds);
+        if (distance >= min_distance)
+        {
+            return;
+        }
+        if (stats)
+        {
+            ++stats->expanded_pairs;
+        }
+
+        const uint32_t count1 = entry1.link & kCountMask;
+        const uint32_t count2 = entry2.link & kCountMask;
+
+        // Оба листа - вершины собираются из сеток, расстояния считает общее
+        // с двоичным деревом ядро
+        if (count1 != 0 && count2 != 0)
+        {
+            const uint32_t *primitives1 = primitives_.data() + (entry1.link >> kLinkShift);
+            const uint32_t *primitives2 = other.primitives_.data() + (entry2.link >> kLinkShift);
+            std::array<double, 9 * AABBTree::kMaxLeafSize> coords1, coords2;
+            AABBTree::PackLeaf(*mesh_, primitives1, count1, coords1.data());
+            AABBTree::PackLeaf(*other.mesh_, primitives2, count2, coords2.data());
+            AABBTree::LeafToLeaf(coords1.data(), primitives1, count1, coords2.data(), primitives2, count2,
+                                 closest1, closest2, min_distance, stats);
+            return;
+        }
+
+        // Распакованные потомки внутренних узлов (лист остаётся единственным "потомком")
+        const auto children = [](const QuantizedAABBTree &tree, const Entry &entry, std::array<Entry, 2> &result)
+        {
+            if ((entry.link & kCountMask) != 0)
+            {
+                result[0] = entry;
+                return size_t{1};
+            }
+            const QuantizedAABBTreeNode<T> &node = tree.nodes_[entry.link >> kLinkShift];
+            for (size_t slot = 0; slot != 2; ++slot)
+            {
+                ChildBounds(node, slot, entry.min_bounds, entry.max_bounds, result[slot].min_bounds,
+                            result[slot].max_bounds);
+                result[slot].link = node.link[slot];
+            }
+            return size_t{2};
+        };
+        std::array<Entry, 2> children1, children2;
+        const size_t num_children1 = children(*this, entry1, children1);
+        const size_t num_children2 = children(other, entry2, children2);
+
+        // Если один из узлов - лист, пары идут в порядке потомков другого, как в двоичном дереве
+        if (num_children1 == 1 || num_children2 == 1)
+        {
+            for (size_t i = 0; i != num_children1; ++i)
+            {
+                for (size_t j = 0; j != num_children2; ++j)
+                {
+                    FindClosestRecursive(other, children1[i], children2[j], closest1, closest2, min_distance, stats);
+                }
+            }
+            return;
+        }
+
+        // Сначала более близкие пары: раньше найденный минимум отсекает больше узлов
+        struct ChildPair
+        {
+            double distance;
+            uint8_t child1;
+            uint8_t child2;
+        };
+        std::array<ChildPair, 4> pairs = {{{0.0, 0, 0}, {0.0, 0, 1}, {0.0, 1, 0}, {0.0, 1, 1}}};
+        for (ChildPair &pair : pairs)
+        {
+            pair.distance = BoxDistance(children1[pair.child1].min_bounds, children1[pair.child1].max_bounds,
+                                        children2[pair.child2].min_bounds, children2[pair.child2].max_bounds);
+        }
+        std::stable_sort(pairs.begin(), pairs.end(),
+                         [](const ChildPair &a, const ChildPair &b)
+                         { return a.distance < b.distance; });
+        for (const ChildPair &pair : pairs)
+        {
+            FindClosestRecursive(other, children1[pair.child1], children2[pair.child2], closest1, closest2,
+                                 min_distance, stats);
+        }
+    }
+
+    template <typename T>
+    void QuantizedAABBTree<T>::FindClosestTriangles(const QuantizedAABBTree &other, size_t &closest1,
+                                                    size_t &closest2, double &min_distance,
+                                                    AABBTreeQueryStats *stats) const
+    {
+        closest1 = AABBTree::kNoTriangle;
+        closest2 = AABBTree::kNoTriangle;
+        min_distance = std::numeric_limits<double>::max();
+
+        if (primitives_.empty() || other.primitives_.empty())
+        {
+            return;
+        }
+
+        FindClosestRecursive(other, root_, other.root_, closest1, closest2, min_distance, stats);
+    }
+
+    template class QuantizedAABBTree<uint8_t>;
+    template class QuantizedAABBTree<uint16_t>;
+
+} // namespace math
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "AABBTree.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace math
+{
+    /**
+     * Сжатый узел: боксы двух потомков в целых числах типа T относительно бокса
+     * самого узла (0 - нижняя граница бокса узла, максимум T - верхняя) и ссылки на них.
+     * Ссылка - (номер сжатого узла << 4) для внутреннего потомка или
+     * (первый треугольник << 4) | число треугольников для листа
+     */
+    template <typename T>
+    struct QuantizedAABBTreeNode
+    {
+        T min_bounds[2][3];
+        T max_bounds[2][3];
+        uint32_t link[2];
+    };
+
+    /**
+     * Сжатое AABB-дерево, полученное из двоичного AABBTree: границы потомков хранятся
+     * 8- или 16-битными смещениями внутри бокса родителя, поэтому узел на два потомка
+     * занимает 20 (uint8_t) или 32 (uint16_t) байта вместо двух узлов по 32 байта.
+     * Границы округляются наружу по тем же формулам, что и при распаковке, так что
+     * распакованный бокс всегда содержит бокс исходного узла и расстояние между
+     * боксами не превышает расстояния между треугольниками. Боксы распаковываются
+     * при обходе от корня, хранится только бокс корня. Номера треугольников копируются
+     * из исходного дерева, а сетка разделяется через shared_ptr, так что исходное дерево
+     * после сжатия не нужно. Упакованные вершины листьев не хранятся (в двоичном дереве
+     * это 72 байта на треугольник): вершины листа собираются из сетки при его проверке
+     */
+    template <typename T>
+    class QuantizedAABBTree
+    {
+        static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>,
+                      "Quantized AABB tree supports 8 or 16 bit bounds");
+
+    private:
+        // Распакованный бокс и ссылка на поддерево при обходе
+        struct Entry
+        {
+            float min_bounds[3];
+            float max_bounds[3];
+            uint32_t link;
+        };
+
+        std::shared_ptr<const Mesh> mesh_;
+        std::vector<QuantizedAABBTreeNode<T>> nodes_;
+        std::vector<uint32_t> primitives_;
+        Entry root_{};
+
+        uint32_t Compress(const std::vector<AABBTreeNode> &binary, uint32_t binary_node, const Entry &entry);
+
+        void FindClosestRecursive(const QuantizedAABBTree &other, const Entry &entry1, const Entry &entry2,
+                                  size_t &closest1, size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats) const;
+
+    public:
+        static constexpr uint32_t kLinkShift = 4;
+        static constexpr uint32_t kCountMask = (1u << kLinkShift) - 1;
+        static_assert(AABBTree::kMaxLeafSize <= kCountMask, "Leaf size must fit into the link");
+
+        /**
+         * Сжатие дерева. Если треугольников не меньше 2^28 (не помещаются в ссылку),
+         * выбрасывается std::invalid_argument
+         */
+        explicit QuantizedAABBTree(const AABBTree &tree);
+
+        /**
+         * Построение двоичного дерева по сетке и его сжатие; двоичное дерево не сохраняется
+         */
+        explicit QuantizedAABBTree(std::shared_ptr<const Mesh> mesh, const AABBTreeOptions &options = {});
+
+        const Mesh &GetMesh() const;
+        const std::vector<QuantizedAABBTreeNode<T>> &Nodes() const;
+        const std::vector<uint32_t> &Primitives() const;
+
+        /**
+         * Объём памяти дерева в байтах: всё, что нужно поиску, кроме сетки
+         * (сравним с AABBTree::MemoryBytes)
+         */
+        size_t MemoryBytes() const;
+
+        /**
+         * Распаковка бокса потомка slot (0 или 1) узла node с боксом [parent_min, parent_max]
+         */
+        static void ChildBounds(const QuantizedAABBTreeNode<T> &node, size_t slot,
+                                const float (&parent_min)[3], const float (&parent_max)[3],
+                                float (&min_bounds)[3], float (&max_bounds)[3]);
+
+        /**
+         * Бокс корня (совпадает с боксом корня исходного дерева)
+         */
+        void RootBounds(float (&min_bounds)[3], float (&max_bounds)[3]) const;
+
+        /**
+         * Ближайшая пара треугольников двух деревьев, как в AABBTree::FindClosestTriangles
+         */
+        void FindClosestTriangles(const QuantizedAABBTree &other, size_t &closest1,
+                                  size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats = nullptr) const;
+    };
+
+    using QuantizedAABBTree8 = QuantizedAABBTree<uint8_t>;
+    using QuantizedAABBTree16 = QuantizedAABBTree<uint16_t>;
+
+} // namespace math
@@ -1,9 +1,18 @@
 #include "ReadSTL.hpp"
+#include "Parallel.hpp"
 #include "Vector.hpp"
 #include "Triangle.hpp"
+#include "Weld.hpp"
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -11,8 +20,356 @@ namespace read_stl
 {
     using namespace math;
     using namespace stl_reader;
+    using namespace std::string_literals;
 
-    std::vector<Triangle> GetTriangles(const std::string &filename)
+    // Грани в порядке файла без сварки вершин
+    struct FacetSoup
+    {
+        std::vector<std::array<double, 3>> normals;
+        std::vector<std::array<double, 3>> corners; // по три на грань
+    };
+
+    namespace
+    {
+        constexpr size_t kBinaryHeaderSize = 80;
+        constexpr size_t kBinaryPrefixSize = kBinaryHeaderSize + sizeof(uint32_t);
+        constexpr size_t kBinaryFacetSize = 50; // 12 float + 2 байта атрибутов
+
+        // Чтение little-endian числа из произвольного (невыровненного) адреса
+        template <class T>
+        T LoadLittleEndian(const char *ptr)
+        {
+            T value;
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                std::memcpy(&value, ptr, sizeof(T));
+            }
+            else
+            {
+                char bytes[sizeof(T)];
+                for (size_t i = 0; i != sizeof(T); ++i)
+                {
+                    bytes[i] = ptr[sizeof(T) - 1 - i];
+                }
+                std::memcpy(&value, bytes, sizeof(T));
+            }
+            return value;
+        }
+
+        std::array<double, 3> LoadFloatArray(const char *ptr)
+        {
+            return {static_cast<double>(LoadLittleEndian<float>(ptr)),
+                    static_cast<double>(LoadLittleEndian<float>(ptr + 4)),
+                    static_cast<double>(LoadLittleEndian<float>(ptr + 8))};
+        }
+
+        // Минимальный размер части текстового файла для отдельной задачи
+        constexpr size_t kMinAsciiChunkSize = 64 * 1024;
+
+        // Размер блока при потоковом чтении текстового файла
+        constexpr size_t kStreamBlockSize = 1024 * 1024;
+
+        bool IsSpace(const char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        // Последовательное чтение слов и чисел из текстового STL
+        class AsciiCursor
+        {
+        private:
+            const char *pos_;
+            const char *end_;
+
+        public:
+            AsciiCursor(const char *begin, const char *end) : pos_(begin), end_(end) {}
+
+            bool NextToken(std::string_view &token)
+            {
+                while (pos_ != end_ && IsSpace(*pos_))
+                {
+                    ++pos_;
+                }
+                const char *begin = pos_;
+                while (pos_ != end_ && !IsSpace(*pos_))
+                {
+                    ++pos_;
+                }
+                token = std::string_view(begin, static_cast<size_t>(pos_ - begin));
+                return !token.empty();
+            }
+
+            double NextNumber()
+            {
+                std::string_view token;
+                if (!NextToken(token))
+                {
+                    throw std::invalid_argument("Unexpected end of ASCII STL"s);
+                }
+                // from_chars не принимает ведущий '+'
+                if (token.front() == '+')
+                {
+                    token.remove_prefix(1);
+                }
+                double value = 0.0;
+                const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+                if (ec != std::errc() || ptr != token.data() + token.size())
+                {
+                    throw std::invalid_argument("Invalid number in ASCII STL: "s + std::string(token));
+                }
+                return value;
+            }
+
+            std::array<double, 3> NextVector()
+            {
+                const double x = NextNumber();
+                const double y = NextNumber();
+                const double z = NextNumber();
+                return {x, y, z};
+            }
+        };
+
+        // Начало первого слова "facet" не раньше from ("endfacet" не подходит)
+        const char *FindFacetStart(const char *file_begin, const char *from, const char *end)
+        {
+            const std::string_view text(from, static_cast<size_t>(end - from));
+            size_t pos = text.find("facet");
+            while (pos != std::string_view::npos)
+            {
+                const char *ptr = from + pos;
+                if (ptr == file_begin || IsSpace(ptr[-1]))
+                {
+                    return ptr;
+                }
+                pos = text.find("facet", pos + 1);
+            }
+            return end;
+        }
+
+        // Разбор части текстового файла, содержащей только целые грани
+        void ParseAsciiChunk(const char *begin, const char *end, FacetSoup &soup)
+        {
+            AsciiCursor cursor(begin, end);
+            std::array<double, 3> normal = {0.0, 0.0, 0.0};
+            std::array<std::array<double, 3>, 3> corners;
+            size_t num_corners = 0;
+
+            std::string_view token;
+            while (cursor.NextToken(token))
+            {
+                if (token == "normal")
+                {
+                    normal = cursor.NextVector();
+                }
+                else if (token == "vertex")
+                {
+                    if (num_corners == 3)
+                    {
+                        throw std::invalid_argument("Facet with more than 3 vertices in ASCII STL"s);
+                    }
+                    corners[num_corners++] = cursor.NextVector();
+                }
+                else if (token == "endfacet")
+                {
+                    if (num_corners != 3)
+                    {
+                        throw std::invalid_argument("Facet with less than 3 vertices in ASCII STL"s);
+                    }
+                    soup.normals.push_back(normal);
+                    soup.corners.insert(soup.corners.end(), corners.begin(), corners.end());
+                    normal = {0.0, 0.0, 0.0};
+                    num_corners = 0;
+                }
+                // Остальные слова (solid, facet, outer loop, endloop, endsolid) структуру не меняют
+            }
+        }
+    } // namespace
+
+    bool IsBinarySTL(const char *data, size_t size)
+    {
+        if (data == nullptr || size < kBinaryPrefixSize)
+        {
+            return false;
+        }
+
+        const size_t num_tris = LoadLittleEndian<uint32_t>(data + kBinaryHeaderSize);
+        const size_t expected_size = kBinaryPrefixSize + num_tris * kBinaryFacetSize;
+        if (size == expected_size)
+        {
+            return true;
+        }
+
+        // Некоторые программы дописывают данные в конец файла, а текстовый STL
+        // обязан начинаться со слова "solid"
+        return size > expected_size && std::strncmp(data, "solid", 5) != 0;
+    }
+
+    namespace
+    {
+        // Декодирование бинарных записей граней (записи независимы, поэтому параллельно)
+        FacetSoup DecodeBinarySTL(const MappedFile &file, const size_t num_threads)
+        {
+            const char *data = file.Data();
+            if (!IsBinarySTL(data, file.Size()))
+            {
+                throw std::invalid_argument("File is not a binary STL"s);
+            }
+
+            const size_t num_tris = LoadLittleEndian<uint32_t>(data + kBinaryHeaderSize);
+
+            FacetSoup soup;
+            soup.normals.resize(num_tris);
+            soup.corners.resize(3 * num_tris);
+
+            parallel::ParallelForRange(
+                num_tris, parallel::ResolveThreadCount(num_threads),
+                [&](const size_t begin, const size_t end, size_t)
+                {
+                    const char *record = data + kBinaryPrefixSize + begin * kBinaryFacetSize;
+                    for (size_t itri = begin; itri != end; ++itri, record += kBinaryFacetSize)
+                    {
+                        soup.normals[itri] = LoadFloatArray(record);
+                        for (size_t icorner = 0; icorner != 3; ++icorner)
+                        {
+                            soup.corners[3 * itri + icorner] = LoadFloatArray(record + 12 * (icorner + 1));
+                        }
+                    }
+                },
+                num_threads);
+
+            return soup;
+        }
+
+        // Разбор текстового файла по частям и склейка частей в исходном порядке
+        FacetSoup DecodeAsciiSTL(const MappedFile &file, size_t num_threads)
+        {
+            const char *file_begin = file.Data();
+            const char *file_end = file_begin + file.Size();
+            num_threads = parallel::ResolveThreadCount(num_threads);
+
+            // Границы частей - начала граней, ближайшие к равномерному разбиению
+            const size_t num_chunks = std::max<size_t>(1, std::min(num_threads * 4, file.Size() / kMinAsciiChunkSize));
+            std::vector<const char *> bounds;
+            bounds.push_back(FindFacetStart(file_begin, file_begin, file_end));
+            for (size_t i = 1; i < num_chunks; ++i)
+            {
+                const char *target = file_begin + file.Size() * i / num_chunks;
+                const char *bound = FindFacetStart(file_begin, std::max(target, bounds.back()), file_end);
+                if (bound != bounds.back())
+                {
+                    bounds.push_back(bound);
+                }
+            }
+            if (bounds.back() != file_end)
+            {
+                bounds.push_back(file_end);
+            }
+
+            std::vector<FacetSoup> soups(bounds.size() - 1);
+            parallel::ParallelFor(
+                soups.size(),
+                [&](const size_t chunk)
+                {
+                    ParseAsciiChunk(bounds[chunk], bounds[chunk + 1], soups[chunk]);
+                },
+                num_threads);
+
+            if (soups.size() == 1)
+            {
+                return std::move(soups.front());
+            }
+
+            std::vector<size_t> offsets(soups.size() + 1, 0);
+            for (size_t chunk = 0; chunk != soups.size(); ++chunk)
+            {
+                offsets[chunk + 1] = offsets[chunk] + soups[chunk].normals.size();
+            }
+
+            FacetSoup result;
+            result.normals.resize(offsets.back());
+            result.corners.resize(3 * offsets.back());
+            parallel::ParallelFor(
+                soups.size(),
+                [&](const size_t chunk)
+                {
+                    std::copy(soups[chunk].normals.begin(), soups[chunk].normals.end(),
+                              result.normals.begin() + static_cast<std::ptrdiff_t>(offsets[chunk]));
+                    std::copy(soups[chunk].corners.begin(), soups[chunk].corners.end(),
+                              result.corners.begin() + static_cast<std::ptrdiff_t>(3 * offsets[chunk]));
+                },
+                num_threads);
+
+            return result;
+        }
+
+        // Сварка вершин и сборка индексированной сетки в исходном порядке граней
+        Mesh BuildMesh(FacetSoup &&soup, const ReadOptions &options)
+        {
+            WeldResult weld = WeldVertices(soup.corners, options.weld_tolerance, options.num_threads);
+            soup.corners = {};
+
+            const size_t num_vertices = weld.vertices.size();
+            const size_t num_tris = soup.normals.size();
+            std::vector<double> x(num_vertices), y(num_vertices), z(num_vertices);
+            std::vector<double> nx(num_tris), ny(num_tris), nz(num_tris);
+
+            const size_t num_chunks = parallel::ResolveThreadCount(options.num_threads);
+            parallel::ParallelForRange(
+                num_vertices, num_chunks,
+                [&](const size_t begin, const size_t end, size_t)
+                {
+                    for (size_t i = begin; i != end; ++i)
+                    {
+                        x[i] = weld.vertices[i][0];
+                        y[i] = weld.vertices[i][1];
+                        z[i] = weld.vertices[i][2];
+                    }
+                },
+                options.num_threads);
+            parallel::ParallelForRange(
+                num_tris, num_chunks,
+                [&](const size_t begin, const size_t end, size_t)
+                {
+                    for (size_t i = begin; i != end; ++i)
+                    {
+                        nx[i] = soup.normals[i][0];
+                        ny[i] = soup.normals[i][1];
+                        nz[i] = soup.normals[i][2];
+                    }
+                },
+                options.num_threads);
+
+            Mesh mesh(std::move(x), std::move(y), std::move(z), std::move(weld.indices),
+                      std::move(nx), std::move(ny), std::move(nz));
+            if (options.single_precision)
+            {
+                return mesh.ToSinglePrecision();
+            }
+            return mesh;
+        }
+    } // namespace
+
+    Mesh ReadBinarySTL(const MappedFile &file, const ReadOptions &options)
+    {
+        return BuildMesh(DecodeBinarySTL(file, options.num_threads), options);
+    }
+
+    Mesh ReadAsciiSTL(const MappedFile &file, const ReadOptions &options)
+    {
+        return BuildMesh(DecodeAsciiSTL(file, options.num_threads), options);
+    }
+
+    Mesh ReadMesh(const std::string &filename, const ReadOptions &options)
+    {
+        MappedFile file(filename);
+        if (IsBinarySTL(file.Data(), file.Size()))
+        {
+            return ReadBinarySTL(file, options);
+        }
+        return ReadAsciiSTL(file, options);
+    }
+
+    std::vector<Triangle> GetTrianglesStlReader(const std::string &filename)
     {
         // Хеш-таблица для хранения уникальных точек и их номеров
         std::unordered_map<Vector, size_t, VectorReadHash> point_map;
@@ -29,33 +386,38 @@ namespace read_stl
             return it->second;
         };
 
-        try
-        {
-            StlMesh<double, size_t> mesh(filename);
+        StlMesh<double, size_t> mesh(filename);
 
-            std::vector<Triangle> triangles;
+        std::vector<Triangle> triangles;
+
+        for (size_t itri = 0; itri < mesh.num_tris(); itri++)
+        {
+            const double *ptr_for_normal = mesh.tri_normal(itri);
+            Vector normal({ptr_for_normal[0], ptr_for_normal[1], ptr_for_normal[2]});
 
-            for (size_t itri = 0; itri < mesh.num_tris(); itri++)
+            std::array<Vector, 3> points;
+            for (size_t icorner = 0; icorner < 3; ++icorner)
             {
-                const double *ptr_for_normal = mesh.tri_normal(itri);
-                Vector normal({ptr_for_normal[0], ptr_for_normal[1], ptr_for_normal[2]});
+                const double *ptr_for_one_point = mesh.tri_corner_coords(itri, icorner);
+                points[icorner] = Vector({ptr_for_one_point[0], ptr_for_one_point[1], ptr_for_one_point[2]});
+            }
 
-                std::array<Vector, 3> points;
-                for (size_t icorner = 0; icorner < 3; ++icorner)
-                {
-                    const double *ptr_for_one_point = mesh.tri_corner_coords(itri, icorner);
-                    points[icorner] = Vector({ptr_for_one_point[0], ptr_for_one_point[1], ptr_for_one_point[2]});
-                }
+            for (auto &point : points)
+            {
+                size_t num = get_point_number(point);
+                point.SetNum(num);
+            }
 
-                for (auto &point : points)
-                {
-                    size_t num = get_point_number(point);
-                    point.SetNum(num);
-                }
+            triangles.emplace_back(itri, normal, points);
+        }
+        return triangles;
+    }
 
-                triangles.emplace_back(itri, normal, points);
-            }
-            return triangles;
+    std::vector<Triangle> GetTriangles(const std::string &filename, const ReadOptions &options)
+    {
+        try
+        {
+            return ReadMesh(filename, options).ToTriangles();
         }
         catch (const std::exception &e)
         {
@@ -69,4 +431,137 @@ namespace read_stl
         }
     }
 
+    StlStream::StlStream(const std::string &filename, const size_t batch_size)
+        : in_(filename, std::ios::binary), batch_size_(batch_size), pending_(std::make_unique<FacetSoup>())
+    {
+        if (!in_.is_open())
+        {
+            throw std::runtime_error("Cannot open file: "s + filename);
+        }
+        if (batch_size_ == 0)
+        {
+            throw std::invalid_argument("Batch size cannot be zero"s);
+        }
+
+        // Формат определяется так же, как при полном чтении: по размеру файла
+        in_.seekg(0, std::ios::end);
+        const size_t size = static_cast<size_t>(in_.tellg());
+        in_.seekg(0, std::ios::beg);
+
+        char prefix[kBinaryPrefixSize] = {};
+        in_.read(prefix, static_cast<std::streamsize>(std::min(size, kBinaryPrefixSize)));
+        if (size >= kBinaryPrefixSize)
+        {
+            const size_t num_tris = LoadLittleEndian<uint32_t>(prefix + kBinaryHeaderSize);
+            const size_t expected_size = kBinaryPrefixSize + num_tris * kBinaryFacetSize;
+            binary_ = size == expected_size ||
+                      (size > expected_size && std::strncmp(prefix, "solid", 5) != 0);
+            binary_tris_left_ = binary_ ? num_tris : 0;
+        }
+
+        if (!binary_)
+        {
+            in_.clear();
+            in_.seekg(0, std::ios::beg);
+        }
+    }
+
+    StlStream::~StlStream() = default;
+
+    bool StlStream::ReadAsciiBlock()
+    {
+        if (!in_)
+        {
+            return false;
+        }
+
+        const size_t old_size = text_.size();
+        text_.resize(old_size + kStreamBlockSize);
+        in_.read(text_.data() + old_size, static_cast<std::streamsize>(kStreamBlockSize));
+        text_.resize(old_size + static_cast<size_t>(in_.gcount()));
+        const bool at_end = !in_;
+
+        // Разбираем только целые грани, хвост остаётся до следующего блока
+        size_t cut = text_.size();
+        if (!at_end)
+        {
+            const size_t pos = text_.rfind("endfacet");
+            cut = pos == std::string::npos ? 0 : pos + 8;
+        }
+        if (cut != 0)
+        {
+            ParseAsciiChunk(text_.data(), text_.data() + cut, *pending_);
+            text_.erase(0, cut);
+        }
+        return true;
+    }
+
+    bool StlStream::NextBatch(std::vector<Triangle> &batch)
+    {
+        batch.clear();
+
+        if (binary_)
+        {
+            const size_t count = std::min(batch_size_, binary_tris_left_);
+            buffer_.resize(count * kBinaryFacetSize);
+            in_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            if (static_cast<size_t>(in_.gcount()) != buffer_.size())
+            {
+                throw std::runtime_error("Unexpected end of binary STL"s);
+            }
+            binary_tris_left_ -= count;
+
+            batch.reserve(count);
+            const char *record = buffer_.data();
+            for (size_t i = 0; i != count; ++i, record += kBinaryFacetSize)
+            {
+                const size_t itri = triangles_read_ + i;
+                std::array<Vector, 3> points;
+                for (size_t icorner = 0; icorner != 3; ++icorner)
+                {
+                    points[icorner] = Vector(3 * itri + icorner, LoadFloatArray(record + 12 * (icorner + 1)));
+                }
+                batch.emplace_back(itri, Vector(LoadFloatArray(record)), points);
+            }
+        }
+        else
+        {
+            if (pending_->normals.size() - pending_pos_ < batch_size_)
+            {
+                // Уже выданные грани удаляются до чтения следующего блока
+                pending_->normals.erase(pending_->normals.begin(),
+                                        pending_->normals.begin() + static_cast<std::ptrdiff_t>(pending_pos_));
+                pending_->corners.erase(pending_->corners.begin(),
+                                        pending_->corners.begin() + static_cast<std::ptrdiff_t>(3 * pending_pos_));
+                pending_pos_ = 0;
+
+                while (pending_->normals.size() < batch_size_ && ReadAsciiBlock())
+                {
+                }
+            }
+
+            const size_t count = std::min(batch_size_, pending_->normals.size() - pending_pos_);
+            batch.reserve(count);
+            for (size_t i = 0; i != count; ++i)
+            {
+                const size_t itri = triangles_read_ + i;
+                const size_t ipending = pending_pos_ + i;
+                std::array<Vector, 3> points;
+                for (size_t icorner = 0; icorner != 3; ++icorner)
+                {
+                    points[icorner] = Vector(3 * itri + icorner, pending_->corners[3 * ipending + icorner]);
+                }
+                batch.emplace_back(itri, Vector(pending_->normals[ipending]), points);
+            }
+            pending_pos_ += count;
+        }
+
+        triangles_read_ += batch.size();
+        return !batch.empty();
+    }
+
+    bool StlStream::IsBinary() const { return binary_; }
+
+    size_t StlStream::TrianglesRead() const { return triangles_read_; }
+
 } // namespace read_stl
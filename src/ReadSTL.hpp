@@ -2,14 +2,108 @@
 
 #include "stl_reader.h"
 
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
 #include "Vector.hpp"
 #include "Triangle.hpp"
 
+#include <cstddef>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace read_stl
 {
-    std::vector<math::Triangle> GetTriangles(const std::string &filename);
+    /**
+     * Параметры чтения STL-файла
+     */
+    struct ReadOptions
+    {
+        double weld_tolerance = 0.0; // Шаг сетки сварки вершин (0 - точное совпадение)
+        size_t num_threads = 0;      // Число потоков (0 - все ядра)
+        bool single_precision = false; // Хранить сетку во float (см. Mesh::ToSinglePrecision)
+    };
+
+    /**
+     * Чтение треугольников из STL-файла. Бинарные и текстовые файлы разбираются
+     * напрямую из отображения файла в память, текстовые - в несколько потоков.
+     * Точки свариваются (см. WeldVertices) и нумеруются в порядке первого появления,
+     * треугольники - по порядку в файле.
+     */
+    std::vector<math::Triangle> GetTriangles(const std::string &filename, const ReadOptions &options = {});
+
+    /**
+     * Чтение STL-файла в индексированную сетку (те же правила, что у GetTriangles).
+     * В отличие от GetTriangles, ошибки чтения передаются исключениями
+     */
+    math::Mesh ReadMesh(const std::string &filename, const ReadOptions &options = {});
+
+    /**
+     * Прежний способ чтения через stl_reader::StlMesh (оставлен для сравнения)
+     */
+    std::vector<math::Triangle> GetTrianglesStlReader(const std::string &filename);
+
+    /**
+     * Проверка, что данные являются бинарным STL: 80 байт заголовка,
+     * число граней и по 50 байт на каждую грань
+     */
+    bool IsBinarySTL(const char *data, size_t size);
+
+    /**
+     * Разбор бинарного STL из отображённого в память файла.
+     * Записи граней декодируются параллельно в плоский буфер углов и свариваются в сетку
+     */
+    math::Mesh ReadBinarySTL(const MappedFile &file, const ReadOptions &options = {});
+
+    /**
+     * Разбор текстового STL из отображённого в память файла.
+     * Файл делится на части по границам граней (facet), части разбираются
+     * параллельно через std::from_chars (без зависимости от локали) и склеиваются
+     * в исходном порядке, поэтому нумерация совпадает с последовательным чтением
+     */
+    math::Mesh ReadAsciiSTL(const MappedFile &file, const ReadOptions &options = {});
+
+    struct FacetSoup;
+
+    /**
+     * Потоковое чтение STL-файла (бинарного или текстового) порциями по batch_size
+     * треугольников. Память ограничена размером порции и буфера чтения, поэтому
+     * можно обрабатывать сетки, которые целиком не помещаются в память.
+     * Точки не свариваются (для этого нужна таблица всех вершин файла),
+     * номер точки - глобальный номер угла 3 * i + k, номер треугольника - i
+     */
+    class StlStream
+    {
+    private:
+        std::ifstream in_;
+        bool binary_ = false;
+        size_t batch_size_ = 0;
+        size_t binary_tris_left_ = 0;
+        size_t triangles_read_ = 0;
+
+        std::vector<char> buffer_;
+        std::string text_;
+        std::unique_ptr<FacetSoup> pending_;
+        size_t pending_pos_ = 0;
+
+        bool ReadAsciiBlock();
+
+    public:
+        explicit StlStream(const std::string &filename, size_t batch_size = 65536);
+        ~StlStream();
+
+        StlStream(const StlStream &other) = delete;
+        StlStream &operator=(const StlStream &other) = delete;
+
+        /**
+         * Следующая порция треугольников (batch очищается и заполняется заново).
+         * Возвращает false, когда файл прочитан полностью
+         */
+        bool NextBatch(std::vector<math::Triangle> &batch);
+
+        bool IsBinary() const;
+        size_t TrianglesRead() const;
+    };
 
 } // namespace read_stl
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+
+namespace math
+{
+    /**
+     * Операции над точками std::array<double, 3> для внутренних циклов геометрических
+     * ядер: в отличие от операторов Vector они встраиваются компилятором
+     */
+    namespace vec3
+    {
+        using Point = std::array<double, 3>;
+
+        inline Point Sub(const Point &a, const Point &b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+
+        inline double Dot(const Point &a, const Point &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+        inline Point Cross(const Point &a, const Point &b)
+        {
+            return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+        }
+
+        // Точка a + t * d
+        inline Point Along(const Point &a, const Point &d, const double t)
+        {
+            return {a[0] + t * d[0], a[1] + t * d[1], a[2] + t * d[2]};
+        }
+    } // namespace vec3
+} // namespace math
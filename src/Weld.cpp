@@ -0,0 +1,191 @@
+#include "Weld.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace read_stl
+{
+    using namespace std::string_literals;
+
+    namespace
+    {
+        using Key = std::array<uint64_t, 3>;
+
+        // Ключ ячейки сетки: при нулевом допуске - точные битовые значения координат
+        Key QuantizeCorner(const std::array<double, 3> &corner, const double inv_tolerance)
+        {
+            Key key;
+            for (size_t j = 0; j != 3; ++j)
+            {
+                if (inv_tolerance == 0.0)
+                {
+                    // -0.0 и 0.0 равны, поэтому должны попасть в одну ячейку
+                    const double value = corner[j] == 0.0 ? 0.0 : corner[j];
+                    key[j] = std::bit_cast<uint64_t>(value);
+                }
+                else
+                {
+                    key[j] = static_cast<uint64_t>(std::llround(corner[j] * inv_tolerance));
+                }
+            }
+            return key;
+        }
+
+        uint64_t HashKey(const Key &key)
+        {
+            // Перемешивание в духе splitmix64
+            uint64_t hash = 0x9e3779b97f4a7c15ULL;
+            for (const uint64_t part : key)
+            {
+                hash ^= part + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+                hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+                hash ^= hash >> 31;
+            }
+            return hash;
+        }
+    } // namespace
+
+    WeldResult WeldVertices(const std::vector<std::array<double, 3>> &corners,
+                            const double tolerance, size_t num_threads)
+    {
+        WeldResult result;
+        const size_t num_corners = corners.size();
+        if (num_corners == 0)
+        {
+            return result;
+        }
+        if (num_corners >= std::numeric_limits<uint32_t>::max())
+        {
+            throw std::length_error("Too many corners to weld: "s + std::to_string(num_corners));
+        }
+        if (tolerance < 0.0)
+        {
+            throw std::invalid_argument("Weld tolerance cannot be negative"s);
+        }
+
+        num_threads = parallel::ResolveThreadCount(num_threads);
+        const size_t num_chunks = num_threads;
+        const double inv_tolerance = tolerance > 0.0 ? 1.0 / tolerance : 0.0;
+
+        // 1. Ключи всех углов (нужны целиком до начала заполнения таблицы)
+        std::vector<Key> keys(num_corners);
+        parallel::ParallelForRange(
+            num_corners, num_chunks,
+            [&](const size_t begin, const size_t end, size_t)
+            {
+                for (size_t i = begin; i != end; ++i)
+                {
+                    keys[i] = QuantizeCorner(corners[i], inv_tolerance);
+                }
+            },
+            num_threads);
+
+        // 2. Заполнение таблицы: в ячейке хранится наименьший номер угла с данным
+        // ключом плюс один (0 - пустая ячейка). Порядок потоков на результат не влияет.
+        // Синхронизацию между этапами дают join потоков, поэтому хватает relaxed
+        const size_t capacity = std::bit_ceil(std::max<size_t>(16, 2 * num_corners));
+        const size_t mask = capacity - 1;
+        std::vector<std::atomic<uint32_t>> table(capacity);
+        std::vector<uint32_t> first_corner(num_corners);
+
+        parallel::ParallelForRange(
+            num_corners, num_chunks,
+            [&](const size_t begin, const size_t end, size_t)
+            {
+                for (size_t i = begin; i != end; ++i)
+                {
+                    const uint32_t value = static_cast<uint32_t>(i) + 1;
+                    size_t slot = HashKey(keys[i]) & mask;
+                    uint32_t current = table[slot].load(std::memory_order_relaxed);
+                    while (true)
+                    {
+                        if (current == 0)
+                        {
+                            if (table[slot].compare_exchange_weak(current, value, std::memory_order_relaxed))
+                            {
+                                break;
+                            }
+                            continue;
+                        }
+                        if (keys[current - 1] == keys[i])
+                        {
+                            while (value < current &&
+                                   !table[slot].compare_exchange_weak(current, value, std::memory_order_relaxed))
+                            {
+                            }
+                            break;
+                        }
+                        slot = (slot + 1) & mask;
+                        current = table[slot].load(std::memory_order_relaxed);
+                    }
+                    first_corner[i] = static_cast<uint32_t>(slot);
+                }
+            },
+            num_threads);
+
+        // 3. Первый угол с тем же ключом и число новых вершин в каждой части
+        std::vector<size_t> chunk_offsets(num_chunks + 1, 0);
+        parallel::ParallelForRange(
+            num_corners, num_chunks,
+            [&](const size_t begin, const size_t end, const size_t chunk)
+            {
+                size_t count = 0;
+                for (size_t i = begin; i != end; ++i)
+                {
+                    first_corner[i] = table[first_corner[i]].load(std::memory_order_relaxed) - 1;
+                    count += first_corner[i] == i ? 1 : 0;
+                }
+                chunk_offsets[chunk + 1] = count;
+            },
+            num_threads);
+
+        for (size_t chunk = 0; chunk != num_chunks; ++chunk)
+        {
+            chunk_offsets[chunk + 1] += chunk_offsets[chunk];
+        }
+
+        // 4. Номера вершин в порядке первого появления
+        result.vertices.resize(chunk_offsets.back());
+        result.indices.resize(num_corners);
+        parallel::ParallelForRange(
+            num_corners, num_chunks,
+            [&](const size_t begin, const size_t end, const size_t chunk)
+            {
+                uint32_t vertex = static_cast<uint32_t>(chunk_offsets[chunk]);
+                for (size_t i = begin; i != end; ++i)
+                {
+                    if (first_corner[i] == i)
+                    {
+                        result.vertices[vertex] = corners[i];
+                        result.indices[i] = vertex++;
+                    }
+                }
+            },
+            num_threads);
+
+        // 5. Остальные углы получают номер своего первого угла
+        parallel::ParallelForRange(
+            num_corners, num_chunks,
+            [&](const size_t begin, const size_t end, size_t)
+            {
+                for (size_t i = begin; i != end; ++i)
+                {
+                    if (first_corner[i] != i)
+                    {
+                        result.indices[i] = result.indices[first_corner[i]];
+                    }
+                }
+            },
+            num_threads);
+
+        return result;
+    }
+
+} // namespace read_stl
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace read_stl
+{
+    /**
+     * Результат сварки вершин: уникальные вершины в порядке первого появления
+     * и индексы вершин для каждого угла (по три на треугольник)
+     */
+    struct WeldResult
+    {
+        std::vector<std::array<double, 3>> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    /**
+     * Сварка совпадающих углов треугольников в общие вершины.
+     * Координаты квантуются на сетке с шагом tolerance (0 - точное совпадение),
+     * углы из одной ячейки получают одну вершину. Точки по разные стороны
+     * границы ячейки не объединяются, даже если они ближе tolerance.
+     * Используется плоская хеш-таблица с открытой адресацией, которая
+     * заполняется параллельно (num_threads = 0 - все ядра); нумерация
+     * не зависит от числа потоков и совпадает с последовательной.
+     */
+    WeldResult WeldVertices(const std::vector<std::array<double, 3>> &corners,
+                            double tolerance = 0.0, size_t num_threads = 0);
+
+} // namespace read_stl
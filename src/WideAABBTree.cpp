@@ -0,0 +1,315 @@
+#include "WideAABBTree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace math
+{
+    namespace
+    {
+        constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+        // Половина площади поверхности бокса
+        double HalfArea(const float (&min_bounds)[3], const float (&max_bounds)[3])
+        {
+            const double dx = static_cast<double>(max_bounds[0]) - min_bounds[0];
+            const double dy = static_cast<double>(max_bounds[1]) - min_bounds[1];
+            const double dz = static_cast<double>(max_bounds[2]) - min_bounds[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+
+        // Порог отсечения во float: квадрат текущего минимума с запасом на округление
+        // разностей и суммы квадратов во float (их относительная погрешность меньше 1e-6),
+        // чтобы узел с близкими треугольниками никогда не отсекался
+        float PruneBound(const double min_distance)
+        {
+            const double bound = min_distance * min_distance * (1.0 + 1e-6);
+            if (!(bound < static_cast<double>(std::numeric_limits<float>::max())))
+            {
+                return kInfinity;
+            }
+            float result = static_cast<float>(bound);
+            if (static_cast<double>(result) < bound)
+            {
+                result = std::nextafter(result, kInfinity);
+            }
+            return result;
+        }
+    } // namespace
+
+    template <size_t Width>
+    WideAABBTree<Width>::WideAABBTree(const AABBTree &tree) : tree_(tree)
+    {
+        const std::vector<AABBTreeNode> &binary = tree_.Nodes();
+        if (binary.empty())
+        {
+            return;
+        }
+
+        // Каждый широкий узел заменяет не меньше одного внутреннего двоичного
+        nodes_.reserve(binary.size() / 2 + 1);
+        std::copy(binary[0].min_bounds, binary[0].min_bounds + 3, root_.min_bounds);
+        std::copy(binary[0].max_bounds, binary[0].max_bounds + 3, root_.max_bounds);
+        root_.child = Collapse(0);
+        root_.count = 0;
+    }
+
+    template <size_t Width>
+    uint32_t WideAABBTree<Width>::Collapse(const uint32_t binary_node)
+    {
+        const std::vector<AABBTreeNode> &binary = tree_.Nodes();
+
+        // Потомки собираются с нескольких уровней двоичного дерева: пока есть место,
+        // раскрывается внутренний потомок с наибольшей площадью
+        std::array<uint32_t, Width> slots{};
+        size_t num_slots = 0;
+        if (binary[binary_node].IsLeaf())
+        {
+            slots[num_slots++] = binary_node;
+        }
+        else
+        {
+            slots[num_slots++] = binary_node + 1;
+            slots[num_slots++] = binary[binary_node].offset;
+        }
+        while (num_slots < Width)
+        {
+            size_t largest = Width;
+            double largest_area = -1.0;
+            for (size_t slot = 0; slot != num_slots; ++slot)
+            {
+                const AABBTreeNode &node = binary[slots[slot]];
+                if (!node.IsLeaf() && HalfArea(node.min_bounds, node.max_bounds) > largest_area)
+                {
+                    largest = slot;
+                    largest_area = HalfArea(node.min_bounds, node.max_bounds);
+                }
+            }
+            if (largest == Width)
+            {
+                break;
+            }
+            const uint32_t node = slots[largest];
+            slots[largest] = node + 1;
+            slots[num_slots++] = binary[node].offset;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        for (size_t slot = 0; slot != Width; ++slot)
+        {
+            float min_bounds[3] = {kInfinity, kInfinity, kInfinity};
+            float max_bounds[3] = {-kInfinity, -kInfinity, -kInfinity};
+            uint32_t child = 0, count = 0;
+            if (slot < num_slots)
+            {
+                const AABBTreeNode &node = binary[slots[slot]];
+                std::copy(node.min_bounds, node.min_bounds + 3, min_bounds);
+                std::copy(node.max_bounds, node.max_bounds + 3, max_bounds);
+                child = node.IsLeaf() ? node.offset : Collapse(slots[slot]);
+                count = node.count;
+            }
+
+            // Ссылка берётся заново: рекурсия могла перераспределить массив
+            WideAABBTreeNode<Width> &wide = nodes_[index];
+            wide.min_x[slot] = min_bounds[0];
+            wide.min_y[slot] = min_bounds[1];
+            wide.min_z[slot] = min_bounds[2];
+            wide.max_x[slot] = max_bounds[0];
+            wide.max_y[slot] = max_bounds[1];
+            wide.max_z[slot] = max_bounds[2];
+            wide.child[slot] = child;
+            wide.count[slot] = count;
+        }
+        return index;
+    }
+
+    template <size_t Width>
+    typename WideAABBTree<Width>::Entry WideAABBTree<Width>::GetEntry(const WideAABBTreeNode<Width> &node,
+                                                                      const size_t slot) const
+    {
+        return Entry{{node.min_x[slot], node.min_y[slot], node.min_z[slot]},
+                     {node.max_x[slot], node.max_y[slot], node.max_z[slot]},
+                     node.child[slot],
+                     node.count[slot]};
+    }
+
+    template <size_t Width>
+    const AABBTree &WideAABBTree<Width>::GetTree() const { return tree_; }
+
+    template <size_t Width>
+    const std::vector<WideAABBTreeNode<Width>> &WideAABBTree<Width>::Nodes() const { return nodes_; }
+
+    template <size_t Width>
+    size_t WideAABBTree<Width>::MemoryBytes() const
+    {
+        return nodes_.capacity() * sizeof(WideAABBTreeNode<Width>);
+    }
+
+    template <size_t Width>
+    void WideAABBTree<Width>::BoxDistances(const WideAABBTreeNode<Width> &node,
+                                           const float (&min_bounds)[3], const float (&max_bounds)[3],
+                                           float (&squared_distances)[Width])
+    {
+#if defined(__AVX2__)
+        if constexpr (Width == 8)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            const auto gap = [zero](const float *child_min, const float *child_max, const float query_min,
+                                    const float query_max)
+            {
+                const __m256 below = _mm256_sub_ps(_mm256_load_ps(child_min), _mm256_set1_ps(query_max));
+                const __m256 above = _mm256_sub_ps(_mm256_set1_ps(query_min), _mm256_load_ps(child_max));
+                return _mm256_max_ps(_mm256_max_ps(below, above), zero);
+            };
+            const __m256 gx = gap(node.min_x, node.max_x, min_bounds[0], max_bounds[0]);
+            const __m256 gy = gap(node.min_y, node.max_y, min_bounds[1], max_bounds[1]);
+            const __m256 gz = gap(node.min_z, node.max_z, min_bounds[2], max_bounds[2]);
+            const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy)),
+                                             _mm256_mul_ps(gz, gz));
+            _mm256_storeu_ps(squared_distances, sum);
+            return;
+        }
+        else
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const auto gap = [zero](const float *child_min, const float *child_max, const float query_min,
+                                    const float query_max)
+            {
+                const __m128 below = _mm_sub_ps(_mm_load_ps(child_min), _mm_set1_ps(query_max));
+                const __m128 above = _mm_sub_ps(_mm_set1_ps(query_min), _mm_load_ps(child_max));
+                return _mm_max_ps(_mm_max_ps(below, above), zero);
+            };
+            const __m128 gx = gap(node.min_x, node.max_x, min_bounds[0], max_bounds[0]);
+            const __m128 gy = gap(node.min_y, node.max_y, min_bounds[1], max_bounds[1]);
+            const __m128 gz = gap(node.min_z, node.max_z, min_bounds[2], max_bounds[2]);
+            const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz));
+            _mm_storeu_ps(squared_distances, sum);
+            return;
+        }
+#else
+        // Переносимый вариант без ветвлений, компилятор векторизует его сам
+        for (size_t slot = 0; slot != Width; ++slot)
+        {
+            const float gx = std::max(std::max(node.min_x[slot] - max_bounds[0], min_bounds[0] - node.max_x[slot]), 0.0f);
+            const float gy = std::max(std::max(node.min_y[slot] - max_bounds[1], min_bounds[1] - node.max_y[slot]), 0.0f);
+            const float gz = std::max(std::max(node.min_z[slot] - max_bounds[2], min_bounds[2] - node.max_z[slot]), 0.0f);
+            squared_distances[slot] = gx * gx + gy * gy + gz * gz;
+        }
+#endif
+    }
+
+    template <size_t Width>
+    void WideAABBTree<Width>::FindClosestRecursive(const WideAABBTree &other, const Entry &entry1, const Entry &entry2,
+                                                   size_t &closest1, size_t &closest2, double &min_distance,
+                                                   AABBTreeQueryStats *stats) const
+    {
+        // Оба листа - точные расстояния общим с двоичным деревом ядром
+        if (entry1.count != 0 && entry2.count != 0)
+        {
+            AABBTreeNode leaf1{}, leaf2{};
+            leaf1.offset = entry1.child;
+            leaf1.count = entry1.count;
+            leaf2.offset = entry2.child;
+            leaf2.count = entry2.count;
+            tree_.LeafToLeaf(other.tree_, leaf1, leaf2, closest1, closest2, min_distance, stats);
+            return;
+        }
+
+        // Раскрывается внутренний узел с большим боксом, бокс другого сравнивается
+        // сразу со всеми его потомками
+        const bool expand_first = entry2.count != 0 ||
+                                  (entry1.count == 0 && HalfArea(entry1.min_bounds, entry1.max_bounds) >=
+                                                            HalfArea(entry2.min_bounds, entry2.max_bounds));
+        const Entry &query = expand_first ? entry2 : entry1;
+        const WideAABBTreeNode<Width> &node = expand_first ? nodes_[entry1.child] : other.nodes_[entry2.child];
+
+        float squared_distances[Width];
+        BoxDistances(node, query.min_bounds, query.max_bounds, squared_distances);
+        if (stats)
+        {
+            stats->node_pairs += Width;
+        }
+
+        // Сначала более близкие потомки. Пересекающиеся боксы (расстояние 0) упорядочиваются
+        // по расстоянию между центрами: так в касающихся телах раньше находятся касающиеся треугольники
+        std::array<uint8_t, Width> order{};
+        std::array<float, Width> center_distances{};
+        size_t num_candidates = 0;
+        const float bound = PruneBound(min_distance);
+        for (size_t slot = 0; slot != Width; ++slot)
+        {
+            if (squared_distances[slot] < bound)
+            {
+                order[num_candidates++] = static_cast<uint8_t>(slot);
+                if (squared_distances[slot] == 0.0f)
+                {
+                    const float dx = (node.min_x[slot] + node.max_x[slot]) - (query.min_bounds[0] + query.max_bounds[0]);
+                    const float dy = (node.min_y[slot] + node.max_y[slot]) - (query.min_bounds[1] + query.max_bounds[1]);
+                    const float dz = (node.min_z[slot] + node.max_z[slot]) - (query.min_bounds[2] + query.max_bounds[2]);
+                    center_distances[slot] = dx * dx + dy * dy + dz * dz;
+                }
+            }
+        }
+        const auto closer = [&](const uint8_t a, const uint8_t b)
+        {
+            return squared_distances[a] < squared_distances[b] ||
+                   (squared_distances[a] == squared_distances[b] && center_distances[a] < center_distances[b]);
+        };
+        for (size_t i = 1; i < num_candidates; ++i)
+        {
+            const uint8_t slot = order[i];
+            size_t j = i;
+            for (; j != 0 && closer(slot, order[j - 1]); --j)
+            {
+                order[j] = order[j - 1];
+            }
+            order[j] = slot;
+        }
+
+        for (size_t i = 0; i != num_candidates; ++i)
+        {
+            const uint8_t slot = order[i];
+            if (!(squared_distances[slot] < PruneBound(min_distance)))
+            {
+                break;
+            }
+            const Entry child = GetEntry(node, slot);
+            if (expand_first)
+            {
+                FindClosestRecursive(other, child, entry2, closest1, closest2, min_distance, stats);
+            }
+            else
+            {
+                FindClosestRecursive(other, entry1, child, closest1, closest2, min_distance, stats);
+            }
+        }
+    }
+
+    template <size_t Width>
+    void WideAABBTree<Width>::FindClosestTriangles(const WideAABBTree &other, size_t &closest1,
+                                                   size_t &closest2, double &min_distance,
+                                                   AABBTreeQueryStats *stats) const
+    {
+        closest1 = AABBTree::kNoTriangle;
+        closest2 = AABBTree::kNoTriangle;
+        min_distance = std::numeric_limits<double>::max();
+
+        if (nodes_.empty() || other.nodes_.empty())
+        {
+            return;
+        }
+
+        FindClosestRecursive(other, root_, other.root_, closest1, closest2, min_distance, stats);
+    }
+
+    template class WideAABBTree<4>;
+    template class WideAABBTree<8>;
+
+} // namespace math
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "AABBTree.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math
+{
+    /**
+     * Узел широкого дерева: границы Width потомков хранятся структурой массивов
+     * (отдельный массив на каждую границу каждой оси), поэтому квадраты расстояний
+     * от одного бокса до всех потомков считаются одним векторным проходом
+     * (AVX2 для Width = 8, SSE для Width = 4 при сборке с ENABLE_AVX2).
+     *
+     * Потомок - внутренний узел (count = 0, child - номер узла) или лист двоичного
+     * дерева (count треугольников с позиции child в Primitives()). Незанятые позиции
+     * имеют пустой бокс (min = +inf, max = -inf), расстояние до него бесконечно
+     */
+    template <size_t Width>
+    struct alignas(4 * Width) WideAABBTreeNode
+    {
+        float min_x[Width];
+        float min_y[Width];
+        float min_z[Width];
+        float max_x[Width];
+        float max_y[Width];
+        float max_z[Width];
+        uint32_t child[Width];
+        uint32_t count[Width];
+    };
+
+    /**
+     * Широкое дерево (BVH4 / BVH8), полученное схлопыванием уровней двоичного
+     * AABBTree: у каждого узла до Width потомков. Листья, номера треугольников и
+     * упакованные вершины берутся из исходного дерева, которое должно жить
+     * дольше широкого. При обходе сравниваются квадраты расстояний между боксами,
+     * корень не извлекается
+     */
+    template <size_t Width>
+    class WideAABBTree
+    {
+        static_assert(Width == 4 || Width == 8, "Wide AABB tree supports 4 or 8 children per node");
+
+    private:
+        // Бокс и ссылка на поддерево (внутренний узел или лист) при обходе
+        struct Entry
+        {
+            float min_bounds[3];
+            float max_bounds[3];
+            uint32_t child;
+            uint32_t count;
+        };
+
+        const AABBTree &tree_;
+        std::vector<WideAABBTreeNode<Width>> nodes_;
+        Entry root_{};
+
+        uint32_t Collapse(uint32_t binary_node);
+        Entry GetEntry(const WideAABBTreeNode<Width> &node, size_t slot) const;
+
+        void FindClosestRecursive(const WideAABBTree &other, const Entry &entry1, const Entry &entry2,
+                                  size_t &closest1, size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats) const;
+
+    public:
+        explicit WideAABBTree(const AABBTree &tree);
+
+        const AABBTree &GetTree() const;
+        const std::vector<WideAABBTreeNode<Width>> &Nodes() const;
+
+        /**
+         * Объём памяти широких узлов в байтах (без исходного дерева)
+         */
+        size_t MemoryBytes() const;
+
+        /**
+         * Квадраты расстояний от бокса до всех потомков узла (для пустых позиций - +inf).
+         * Для пересекающихся боксов - 0
+         */
+        static void BoxDistances(const WideAABBTreeNode<Width> &node,
+                                 const float (&min_bounds)[3], const float (&max_bounds)[3],
+                                 float (&squared_distances)[Width]);
+
+        /**
+         * Ближайшая пара треугольников двух деревьев, как в AABBTree::FindClosestTriangles
+         */
+        void FindClosestTriangles(const WideAABBTree &other, size_t &closest1,
+                                  size_t &closest2, double &min_distance,
+                                  AABBTreeQueryStats *stats = nullptr) const;
+    };
+
+    using AABBTree4 = WideAABBTree<4>;
+    using AABBTree8 = WideAABBTree<8>;
+
+} // namespace math
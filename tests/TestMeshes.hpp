@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MathOperations.hpp"
+#include "Mesh.hpp"
+#include "Triangle.hpp"
+#include "Vector.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Сетки и эталонные расстояния, общие для тестов деревьев
+namespace test_meshes
+{
+    // Случайные мелкие треугольники в кубе со стороной 10, сдвинутом по x на offset
+    inline std::shared_ptr<const math::Mesh> RandomMesh(const size_t num_triangles, const double offset,
+                                                        const unsigned seed)
+    {
+        using math::Vector;
+
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> position(0.0, 10.0);
+        std::uniform_real_distribution<double> edge(-0.5, 0.5);
+
+        std::vector<math::Triangle> triangles;
+        for (size_t i = 0; i != num_triangles; ++i)
+        {
+            const Vector base{position(generator) + offset, position(generator), position(generator)};
+            Vector a = base;
+            Vector b = base + Vector{edge(generator), edge(generator), edge(generator)};
+            Vector c = base + Vector{edge(generator), edge(generator), edge(generator)};
+            a.SetNum(3 * i);
+            b.SetNum(3 * i + 1);
+            c.SetNum(3 * i + 2);
+            triangles.emplace_back(i, Vector{0.0, 0.0, 1.0}, a, b, c);
+        }
+        return std::make_shared<const math::Mesh>(math::Mesh::FromTriangles(triangles));
+    }
+
+    // Сетка с той же топологией и вершинами, сдвинутыми функцией move(vertex, axis, coord)
+    template <class Move>
+    std::shared_ptr<const math::Mesh> MoveVertices(const math::Mesh &mesh, Move &&move)
+    {
+        std::vector<double> coords[3];
+        for (size_t i = 0; i != mesh.VertexCount(); ++i)
+        {
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                coords[axis].push_back(move(i, axis, mesh.Coord(static_cast<uint32_t>(i), axis)));
+            }
+        }
+        return std::make_shared<const math::Mesh>(std::move(coords[0]), std::move(coords[1]),
+                                                  std::move(coords[2]), mesh.Indices());
+    }
+
+    // Перебор всех пар треугольников
+    inline double BruteForceDistance(const math::Mesh &mesh_1, const math::Mesh &mesh_2)
+    {
+        double min_distance = std::numeric_limits<double>::max();
+        for (size_t i = 0; i != mesh_1.TriangleCount(); ++i)
+        {
+            for (size_t j = 0; j != mesh_2.TriangleCount(); ++j)
+            {
+                min_distance = std::min(min_distance,
+                                        math::TriangleDistance(mesh_1.GetTriangle(i), mesh_2.GetTriangle(j)));
+            }
+        }
+        return min_distance;
+    }
+} // namespace test_meshes
@@ -0,0 +1,603 @@
+#include "AABBTree.hpp"
+#include "MathOperations.hpp"
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+#include "QuantizedAABBTree.hpp"
+#include "TestMeshes.hpp"
+#include "Triangle.hpp"
+#include "WideAABBTree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace math;
+using namespace test_meshes;
+
+namespace
+{
+    // Границы каждого узла - объединение границ потомков, листья содержат свои треугольники
+    void CheckBounds(const AABBTree &tree)
+    {
+        const std::vector<AABBTreeNode> &nodes = tree.Nodes();
+        for (size_t index = 0; index != nodes.size(); ++index)
+        {
+            const AABBTreeNode &node = nodes[index];
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                if (!node.IsLeaf())
+                {
+                    EXPECT_EQ(node.min_bounds[axis], std::min(nodes[index + 1].min_bounds[axis],
+                                                              nodes[node.offset].min_bounds[axis]));
+                    EXPECT_EQ(node.max_bounds[axis], std::max(nodes[index + 1].max_bounds[axis],
+                                                              nodes[node.offset].max_bounds[axis]));
+                    continue;
+                }
+                for (uint32_t i = node.offset; i != node.offset + node.count; ++i)
+                {
+                    for (size_t corner = 0; corner != 3; ++corner)
+                    {
+                        const double coord = tree.GetMesh().Coord(tree.GetMesh().Index(tree.Primitives()[i], corner), axis);
+                        EXPECT_LE(node.min_bounds[axis], coord);
+                        EXPECT_GE(node.max_bounds[axis], coord);
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+TEST(AABBTreeTest, MatchesBruteForce)
+{
+    for (const BuildMethod method : {BuildMethod::Median, BuildMethod::SAH, BuildMethod::LBVH})
+    {
+        for (const size_t leaf_size : {size_t{1}, size_t{4}, AABBTree::kMaxLeafSize})
+        {
+            for (const double offset : {0.0, 5.0, 12.0})
+            {
+                const auto mesh_1 = RandomMesh(150, 0.0, 1);
+                const auto mesh_2 = RandomMesh(120, offset, 2);
+                AABBTree tree_1(mesh_1, {.method = method, .max_leaf_size = leaf_size});
+                AABBTree tree_2(mesh_2, {.method = method, .max_leaf_size = leaf_size});
+
+                size_t closest_1 = 0, closest_2 = 0;
+                double distance = 0.0;
+                AABBTreeQueryStats stats;
+                tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, distance, &stats);
+
+                EXPECT_DOUBLE_EQ(distance, BruteForceDistance(*mesh_1, *mesh_2));
+                EXPECT_DOUBLE_EQ(distance,
+                                 TriangleDistance(mesh_1->GetTriangle(closest_1), mesh_2->GetTriangle(closest_2)));
+                EXPECT_GT(stats.node_pairs, 0u);
+                EXPECT_LE(stats.expanded_pairs, stats.node_pairs);
+                EXPECT_LE(stats.triangle_pairs, 150u * 120u);
+
+                // Обход по наилучшей паре находит то же расстояние
+                size_t best_first_1 = 0, best_first_2 = 0;
+                double best_first_distance = 0.0;
+                tree_1.FindClosestTrianglesBestFirst(tree_2, best_first_1, best_first_2, best_first_distance);
+                EXPECT_EQ(best_first_distance, distance);
+                EXPECT_DOUBLE_EQ(best_first_distance, TriangleDistance(mesh_1->GetTriangle(best_first_1),
+                                                                       mesh_2->GetTriangle(best_first_2)));
+            }
+        }
+    }
+}
+
+TEST(AABBTreeTest, SAHOnDegenerateCentroids)
+{
+    // Все треугольники в одной точке - разбиение по корзинам невозможно
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i != 64; ++i)
+    {
+        triangles.emplace_back(i, Vector{0.0, 0.0, 1.0}, Vector{0.0, 0.0, 0.0}, Vector{1.0, 0.0, 0.0},
+                               Vector{0.0, 1.0, 0.0});
+    }
+    AABBTree tree(triangles, {.method = BuildMethod::SAH, .max_leaf_size = 1});
+    EXPECT_EQ(tree.Nodes().size(), 2 * 64 - 1);
+}
+
+TEST(AABBTreeTest, LayoutIsDepthFirst)
+{
+    AABBTree tree(RandomMesh(100, 0.0, 3), {.method = BuildMethod::SAH, .max_leaf_size = 1});
+    const std::vector<AABBTreeNode> &nodes = tree.Nodes();
+
+    ASSERT_EQ(nodes.size(), 2 * 100 - 1);
+    EXPECT_EQ(tree.Primitives().size(), 100u);
+    for (size_t i = 0; i != nodes.size(); ++i)
+    {
+        if (nodes[i].IsLeaf())
+        {
+            continue;
+        }
+        // Бокс родителя содержит боксы обоих потомков
+        for (const size_t child : {i + 1, static_cast<size_t>(nodes[i].offset)})
+        {
+            ASSERT_LT(child, nodes.size());
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                EXPECT_LE(nodes[i].min_bounds[axis], nodes[child].min_bounds[axis]);
+                EXPECT_GE(nodes[i].max_bounds[axis], nodes[child].max_bounds[axis]);
+            }
+        }
+    }
+}
+
+TEST(AABBTreeTest, MultiTriangleLeaves)
+{
+    const auto mesh = RandomMesh(100, 0.0, 3);
+    for (const size_t leaf_size : {size_t{2}, size_t{4}, AABBTree::kMaxLeafSize})
+    {
+        AABBTree tree(mesh, {.method = BuildMethod::SAH, .max_leaf_size = leaf_size});
+
+        // Каждый треугольник ровно в одном листе, бокс листа содержит его вершины
+        std::vector<size_t> covered(mesh->TriangleCount(), 0);
+        size_t num_leaves = 0;
+        for (const AABBTreeNode &node : tree.Nodes())
+        {
+            if (!node.IsLeaf())
+            {
+                continue;
+            }
+            ++num_leaves;
+            EXPECT_LE(node.count, leaf_size);
+            for (uint32_t i = node.offset; i != node.offset + node.count; ++i)
+            {
+                const uint32_t triangle = tree.Primitives()[i];
+                ++covered[triangle];
+                for (size_t corner = 0; corner != 3; ++corner)
+                {
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        const double coord = mesh->Coord(mesh->Index(triangle, corner), axis);
+                        EXPECT_LE(node.min_bounds[axis], coord);
+                        EXPECT_GE(node.max_bounds[axis], coord);
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(covered, std::vector<size_t>(mesh->TriangleCount(), 1));
+        EXPECT_EQ(tree.Nodes().size(), 2 * num_leaves - 1);
+        EXPECT_LT(num_leaves, mesh->TriangleCount());
+    }
+
+    EXPECT_THROW(AABBTree(mesh, {.max_leaf_size = 0}), std::invalid_argument);
+    EXPECT_THROW(AABBTree(mesh, {.max_leaf_size = AABBTree::kMaxLeafSize + 1}), std::invalid_argument);
+}
+
+TEST(AABBTreeTest, ParallelBuildMatchesSerial)
+{
+    // Сетка крупнее порога параллельного построения, корень делится параллельно
+    const size_t n = 4 * AABBTree::kParallelSplitMin;
+    const std::shared_ptr<const Mesh> mesh = RandomMesh(n, 0.0, 4);
+    for (const BuildMethod method : {BuildMethod::Median, BuildMethod::SAH, BuildMethod::LBVH})
+    {
+        const AABBTree serial(mesh, {.method = method, .num_threads = 1});
+        const AABBTree parallel(mesh, {.method = method, .num_threads = 4});
+
+        EXPECT_EQ(parallel.Primitives(), serial.Primitives());
+        ASSERT_EQ(parallel.Nodes().size(), serial.Nodes().size());
+        EXPECT_EQ(std::memcmp(parallel.Nodes().data(), serial.Nodes().data(),
+                              serial.Nodes().size() * sizeof(AABBTreeNode)),
+                  0);
+    }
+}
+
+TEST(AABBTreeTest, RadixSortMatchesStableSort)
+{
+    // Много повторяющихся ключей: проверяется и устойчивость
+    std::mt19937 generator(5);
+    std::uniform_int_distribution<uint32_t> key(0, 1u << 20);
+    std::vector<std::pair<uint32_t, uint32_t>> expected(10000);
+    for (size_t i = 0; i != expected.size(); ++i)
+    {
+        expected[i] = {key(generator) & 0xF00F0F, static_cast<uint32_t>(i)};
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    for (const size_t num_chunks : {size_t{1}, size_t{3}, size_t{16}})
+    {
+        std::mt19937 same_generator(5);
+        std::vector<uint32_t> keys(expected.size()), values(expected.size());
+        for (size_t i = 0; i != keys.size(); ++i)
+        {
+            keys[i] = key(same_generator) & 0xF00F0F;
+            values[i] = static_cast<uint32_t>(i);
+        }
+        parallel::ParallelRadixSort(keys, values, num_chunks, 2);
+        for (size_t i = 0; i != keys.size(); ++i)
+        {
+            ASSERT_EQ(keys[i], expected[i].first);
+            ASSERT_EQ(values[i], expected[i].second);
+        }
+    }
+}
+
+// Дерево Tree, построенное по двоичному, находит то же расстояние, что и перебор
+// всех пар; check_nodes(derived, binary) проверяет число его узлов
+template <class Tree, class CheckNodes>
+void CheckDerivedTree(CheckNodes &&check_nodes)
+{
+    for (const size_t leaf_size : {size_t{1}, size_t{4}})
+    {
+        for (const double offset : {0.0, 5.0, 12.0})
+        {
+            const auto mesh_1 = RandomMesh(150, 0.0, 1);
+            const auto mesh_2 = RandomMesh(120, offset, 2);
+            const AABBTree tree_1(mesh_1, {.max_leaf_size = leaf_size});
+            const AABBTree tree_2(mesh_2, {.max_leaf_size = leaf_size});
+            const Tree derived_1(tree_1);
+            const Tree derived_2(tree_2);
+            check_nodes(derived_1, tree_1);
+
+            size_t closest_1 = 0, closest_2 = 0;
+            double distance = 0.0;
+            derived_1.FindClosestTriangles(derived_2, closest_1, closest_2, distance);
+            EXPECT_DOUBLE_EQ(distance, BruteForceDistance(*mesh_1, *mesh_2));
+            EXPECT_DOUBLE_EQ(distance,
+                             TriangleDistance(mesh_1->GetTriangle(closest_1), mesh_2->GetTriangle(closest_2)));
+        }
+    }
+}
+
+TEST(AABBTreeTest, WideTreeMatchesBruteForce)
+{
+    const auto fewer_nodes = [](const auto &wide, const AABBTree &tree)
+    { EXPECT_LT(wide.Nodes().size(), tree.Nodes().size() / 2); };
+    CheckDerivedTree<WideAABBTree<4>>(fewer_nodes);
+    CheckDerivedTree<WideAABBTree<8>>(fewer_nodes);
+}
+
+TEST(AABBTreeTest, QuantizedTreeMatchesBruteForce)
+{
+    // Сжатый узел заменяет внутренний узел двоичного дерева
+    const auto one_per_internal = [](const auto &quantized, const AABBTree &tree)
+    { EXPECT_EQ(quantized.Nodes().size(), tree.Nodes().size() / 2); };
+    CheckDerivedTree<QuantizedAABBTree8>(one_per_internal);
+    CheckDerivedTree<QuantizedAABBTree16>(one_per_internal);
+}
+
+TEST(AABBTreeTest, QuantizedTreeOutlivesBinaryTree)
+{
+    const auto mesh_1 = RandomMesh(150, 0.0, 1);
+    const auto mesh_2 = RandomMesh(120, 5.0, 2);
+    auto tree_1 = std::make_unique<AABBTree>(mesh_1);
+    const QuantizedAABBTree8 quantized_1(*tree_1);
+    tree_1.reset();
+    const QuantizedAABBTree8 quantized_2(mesh_2, {.max_leaf_size = 1});
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double distance = 0.0;
+    quantized_1.FindClosestTriangles(quantized_2, closest_1, closest_2, distance);
+    EXPECT_DOUBLE_EQ(distance, BruteForceDistance(*mesh_1, *mesh_2));
+    EXPECT_DOUBLE_EQ(distance, TriangleDistance(mesh_1->GetTriangle(closest_1), mesh_2->GetTriangle(closest_2)));
+}
+
+TEST(AABBTreeTest, QuantizedBoundsAreConservative)
+{
+    const auto mesh = RandomMesh(500, 0.0, 3);
+    const AABBTree tree(mesh);
+    const QuantizedAABBTree8 quantized(tree);
+    EXPECT_LE(4 * quantized.MemoryBytes(), tree.MemoryBytes());
+
+    // Распакованный бокс каждого листа содержит все вершины его треугольников
+    struct Box
+    {
+        float min_bounds[3];
+        float max_bounds[3];
+        uint32_t link;
+    };
+    std::vector<Box> stack(1);
+    quantized.RootBounds(stack[0].min_bounds, stack[0].max_bounds);
+    stack[0].link = 0;
+    size_t num_leaves = 0;
+    while (!stack.empty())
+    {
+        const Box box = stack.back();
+        stack.pop_back();
+        const QuantizedAABBTreeNode<uint8_t> &node = quantized.Nodes()[box.link >> QuantizedAABBTree8::kLinkShift];
+        for (size_t slot = 0; slot != 2; ++slot)
+        {
+            Box child{};
+            QuantizedAABBTree8::ChildBounds(node, slot, box.min_bounds, box.max_bounds, child.min_bounds,
+                                            child.max_bounds);
+            child.link = node.link[slot];
+            const uint32_t count = child.link & QuantizedAABBTree8::kCountMask;
+            if (count == 0)
+            {
+                stack.push_back(child);
+                continue;
+            }
+            ++num_leaves;
+            const uint32_t first = child.link >> QuantizedAABBTree8::kLinkShift;
+            for (uint32_t i = first; i != first + count; ++i)
+            {
+                for (size_t corner = 0; corner != 3; ++corner)
+                {
+                    const uint32_t vertex = mesh->Index(tree.Primitives()[i], corner);
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        EXPECT_LE(child.min_bounds[axis], mesh->Coord(vertex, axis));
+                        EXPECT_GE(child.max_bounds[axis], mesh->Coord(vertex, axis));
+                    }
+                }
+            }
+        }
+    }
+    EXPECT_EQ(num_leaves, quantized.Nodes().size() + 1);
+}
+
+TEST(AABBTreeTest, WideBoxDistances)
+{
+    // Бокс [0, 1]^3 и потомки: пересекающийся, сдвинутые по x и по диагонали, пустой
+    WideAABBTreeNode<4> node{};
+    const float min_x[4] = {0.5f, 3.0f, -4.0f, std::numeric_limits<float>::infinity()};
+    const float max_x[4] = {2.0f, 4.0f, -2.0f, -std::numeric_limits<float>::infinity()};
+    const float min_yz[4] = {0.5f, 0.0f, 3.0f, std::numeric_limits<float>::infinity()};
+    const float max_yz[4] = {2.0f, 1.0f, 4.0f, -std::numeric_limits<float>::infinity()};
+    for (size_t slot = 0; slot != 4; ++slot)
+    {
+        node.min_x[slot] = min_x[slot];
+        node.max_x[slot] = max_x[slot];
+        node.min_y[slot] = node.min_z[slot] = min_yz[slot];
+        node.max_y[slot] = node.max_z[slot] = max_yz[slot];
+    }
+
+    const float min_bounds[3] = {0.0f, 0.0f, 0.0f};
+    const float max_bounds[3] = {1.0f, 1.0f, 1.0f};
+    float squared_distances[4];
+    AABBTree4::BoxDistances(node, min_bounds, max_bounds, squared_distances);
+    EXPECT_EQ(squared_distances[0], 0.0f);
+    EXPECT_EQ(squared_distances[1], 4.0f);
+    EXPECT_EQ(squared_distances[2], 4.0f + 4.0f + 4.0f);
+    EXPECT_EQ(squared_distances[3], std::numeric_limits<float>::infinity());
+}
+
+TEST(AABBTreeTest, RestoreFromArrays)
+{
+    const auto mesh_1 = RandomMesh(80, 0.0, 4);
+    const auto mesh_2 = RandomMesh(80, 11.0, 5);
+    AABBTree built(mesh_1);
+    AABBTree other(mesh_2);
+    AABBTree restored(mesh_1, built.Nodes().data(), built.Nodes().size(),
+                      built.Primitives().data(), built.Primitives().size());
+
+    size_t a1 = 0, a2 = 0, b1 = 0, b2 = 0;
+    double distance_built = 0.0, distance_restored = 0.0;
+    built.FindClosestTriangles(other, a1, a2, distance_built);
+    restored.FindClosestTriangles(other, b1, b2, distance_restored);
+    EXPECT_EQ(distance_built, distance_restored);
+
+    // Ссылка правого потомка назад - структура повреждена
+    std::vector<AABBTreeNode> nodes = built.Nodes();
+    nodes[0].offset = 0;
+    EXPECT_THROW(AABBTree(mesh_1, nodes.data(), nodes.size(), built.Primitives().data(), built.Primitives().size()),
+                 std::invalid_argument);
+
+    // Лист больше kMaxLeafSize
+    nodes = built.Nodes();
+    nodes.back().offset = 0;
+    nodes.back().count = AABBTree::kMaxLeafSize + 1;
+    EXPECT_THROW(AABBTree(mesh_1, nodes.data(), nodes.size(), built.Primitives().data(), built.Primitives().size()),
+                 std::invalid_argument);
+}
+
+TEST(AABBTreeTest, ParallelQueryMatchesSerial)
+{
+    // Пересекающиеся тела дают много пар на нулевом расстоянии - выбор пары должен совпасть
+    for (const double offset : {0.0, 3.0, 11.0})
+    {
+        const auto mesh_1 = RandomMesh(3000, 0.0, 8);
+        const auto mesh_2 = RandomMesh(2000, offset, 9);
+        const AABBTree tree_1(mesh_1);
+        const AABBTree tree_2(mesh_2);
+
+        size_t serial_1 = 0, serial_2 = 0;
+        double serial_distance = 0.0;
+        tree_1.FindClosestTriangles(tree_2, serial_1, serial_2, serial_distance);
+        for (const size_t num_threads : {1, 2, 3, 8})
+        {
+            size_t closest_1 = 0, closest_2 = 0;
+            double distance = 0.0;
+            AABBTreeQueryStats stats;
+            tree_1.FindClosestTrianglesParallel(tree_2, closest_1, closest_2, distance, num_threads, &stats);
+            EXPECT_EQ(distance, serial_distance);
+            EXPECT_EQ(closest_1, serial_1);
+            EXPECT_EQ(closest_2, serial_2);
+            EXPECT_GT(stats.triangle_pairs, 0u);
+        }
+    }
+}
+
+TEST(AABBTreeTest, ParallelQueryPrunesTouchingBodies)
+{
+    // Касающиеся тела: после первой пары на нулевом расстоянии подзадачи отсекаются
+    // начальным минимумом, и число пар треугольников не растёт с числом потоков
+    const auto mesh_1 = RandomMesh(3000, 0.0, 10);
+    const auto mesh_2 = RandomMesh(3000, 2.0, 11);
+    const AABBTree tree_1(mesh_1);
+    const AABBTree tree_2(mesh_2);
+
+    size_t serial_1 = 0, serial_2 = 0;
+    double serial_distance = 0.0;
+    AABBTreeQueryStats serial_stats;
+    tree_1.FindClosestTriangles(tree_2, serial_1, serial_2, serial_distance, &serial_stats);
+    ASSERT_EQ(serial_distance, 0.0);
+    for (const size_t num_threads : {2, 4, 8, 32})
+    {
+        size_t closest_1 = 0, closest_2 = 0;
+        double distance = 0.0;
+        AABBTreeQueryStats stats;
+        tree_1.FindClosestTrianglesParallel(tree_2, closest_1, closest_2, distance, num_threads, &stats);
+        EXPECT_EQ(distance, serial_distance);
+        EXPECT_EQ(closest_1, serial_1);
+        EXPECT_EQ(closest_2, serial_2);
+        EXPECT_LE(stats.triangle_pairs, 2 * serial_stats.triangle_pairs) << num_threads << " threads";
+    }
+}
+
+TEST(AABBTreeTest, BestFirstExpandsFewerPairs)
+{
+    // Раскрытая пара не дальше итогового расстояния, поэтому по наилучшей паре
+    // раскрывается не больше пар, чем при обходе в глубину
+    const auto mesh_1 = RandomMesh(2000, 0.0, 6);
+    const auto mesh_2 = RandomMesh(2000, 11.0, 7);
+    const AABBTree tree_1(mesh_1);
+    const AABBTree tree_2(mesh_2);
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double depth_first = 0.0, best_first = 0.0;
+    AABBTreeQueryStats depth_first_stats, best_first_stats;
+    tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, depth_first, &depth_first_stats);
+    tree_1.FindClosestTrianglesBestFirst(tree_2, closest_1, closest_2, best_first, &best_first_stats);
+    EXPECT_EQ(best_first, depth_first);
+    EXPECT_LE(best_first_stats.expanded_pairs, depth_first_stats.expanded_pairs);
+}
+
+TEST(AABBTreeTest, RefitMatchesBruteForce)
+{
+    const auto mesh_1 = RandomMesh(150, 0.0, 1);
+    const auto mesh_2 = RandomMesh(120, 12.0, 2);
+    AABBTree tree_1(mesh_1);
+    const AABBTree tree_2(mesh_2);
+
+    // Небольшая деформация: вершины сдвигаются к второму телу
+    std::mt19937 generator(6);
+    std::uniform_real_distribution<double> shift(0.0, 1.0);
+    const auto moved = MoveVertices(*mesh_1, [&](size_t, const size_t axis, const double coord)
+                                    { return coord + (axis == 0 ? 0.2 * coord + shift(generator) : 0.0); });
+    const std::vector<uint32_t> primitives = tree_1.Primitives();
+    EXPECT_EQ(tree_1.Refit(moved), 0u);
+    EXPECT_EQ(tree_1.Primitives(), primitives);
+    CheckBounds(tree_1);
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double distance = 0.0;
+    tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, distance);
+    EXPECT_DOUBLE_EQ(distance, BruteForceDistance(*moved, *mesh_2));
+    EXPECT_DOUBLE_EQ(distance, TriangleDistance(moved->GetTriangle(closest_1), mesh_2->GetTriangle(closest_2)));
+
+    EXPECT_THROW(tree_1.Refit(mesh_2), std::invalid_argument);
+}
+
+TEST(AABBTreeTest, ParallelRefitMatchesSerial)
+{
+    const size_t n = 2 * AABBTree::kParallelBuildMin;
+    const std::shared_ptr<const Mesh> mesh = RandomMesh(n, 0.0, 7);
+    const auto moved = MoveVertices(*mesh, [](const size_t vertex, size_t, const double coord)
+                                    { return coord * 1.5 + static_cast<double>(vertex % 7) * 0.01; });
+    AABBTree serial(mesh, {.num_threads = 1});
+    AABBTree parallel(mesh, {.num_threads = 1});
+    serial.Refit(moved, {.build = {.num_threads = 1}});
+    parallel.Refit(moved, {.build = {.num_threads = 4}});
+
+    ASSERT_EQ(parallel.Nodes().size(), serial.Nodes().size());
+    EXPECT_EQ(std::memcmp(parallel.Nodes().data(), serial.Nodes().data(),
+                          serial.Nodes().size() * sizeof(AABBTreeNode)),
+              0);
+    CheckBounds(parallel);
+}
+
+TEST(AABBTreeTest, RefitRebuildsDegradedSubtrees)
+{
+    // Вершины каждого треугольника переносятся в случайное место: соседние по дереву
+    // треугольники разлетаются, боксы потомков сильно пересекаются
+    const auto mesh_1 = RandomMesh(2000, 0.0, 8);
+    const auto mesh_2 = RandomMesh(300, 12.0, 9);
+    std::mt19937 generator(10);
+    std::uniform_real_distribution<double> position(0.0, 10.0);
+    std::vector<double> shifts(3 * mesh_1->TriangleCount());
+    for (double &shift : shifts)
+    {
+        shift = position(generator);
+    }
+    const auto moved = MoveVertices(*mesh_1, [&](const size_t vertex, const size_t axis, const double coord)
+                                    { return coord + shifts[3 * (vertex / 3) + axis] - 5.0; });
+
+    for (const BuildMethod method : {BuildMethod::SAH, BuildMethod::LBVH})
+    {
+        AABBTree refit(mesh_1, {.method = method});
+        AABBTree rebuilt(mesh_1, {.method = method});
+        const AABBTree tree_2(mesh_2);
+        EXPECT_EQ(refit.Refit(moved), 0u);
+        EXPECT_GT(rebuilt.Refit(moved, {.rebuild_overlap = 0.5, .build = {.method = method}}), 0u);
+        CheckBounds(rebuilt);
+
+        std::vector<uint32_t> sorted = rebuilt.Primitives();
+        std::sort(sorted.begin(), sorted.end());
+        for (size_t i = 0; i != sorted.size(); ++i)
+        {
+            ASSERT_EQ(sorted[i], i);
+        }
+
+        size_t closest_1 = 0, closest_2 = 0;
+        double refit_distance = 0.0, rebuilt_distance = 0.0;
+        AABBTreeQueryStats refit_stats, rebuilt_stats;
+        refit.FindClosestTriangles(tree_2, closest_1, closest_2, refit_distance, &refit_stats);
+        rebuilt.FindClosestTriangles(tree_2, closest_1, closest_2, rebuilt_distance, &rebuilt_stats);
+        EXPECT_EQ(rebuilt_distance, refit_distance);
+        EXPECT_DOUBLE_EQ(rebuilt_distance, TriangleDistance(moved->GetTriangle(closest_1),
+                                                            mesh_2->GetTriangle(closest_2)));
+        EXPECT_LT(rebuilt_stats.node_pairs, refit_stats.node_pairs);
+    }
+}
+
+TEST(AABBTreeTest, DeepTreeQuery)
+{
+    // Вырожденное дерево-гусеница: у каждого внутреннего узла левый потомок - лист.
+    // Глубина больше, чем помещается в стек обхода без выделения памяти
+    const size_t n = 300;
+    const auto mesh_1 = RandomMesh(n, 0.0, 11);
+    const auto mesh_2 = RandomMesh(100, 12.0, 12);
+    std::vector<AABBTreeNode> nodes(2 * n - 1);
+    std::vector<uint32_t> primitives(n);
+    for (uint32_t i = 0; i != n; ++i)
+    {
+        primitives[i] = i;
+        AABBTreeNode &leaf = nodes[i + 1 == n ? 2 * i : 2 * i + 1];
+        leaf.offset = i;
+        leaf.count = 1;
+        if (i + 1 != n)
+        {
+            nodes[2 * i].offset = 2 * i + 2;
+        }
+    }
+    AABBTree tree_1(mesh_1, nodes.data(), nodes.size(), primitives.data(), primitives.size());
+    tree_1.Refit(mesh_1);
+    const AABBTree tree_2(mesh_2);
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double distance = 0.0;
+    tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, distance);
+    EXPECT_DOUBLE_EQ(distance, BruteForceDistance(*mesh_1, *mesh_2));
+
+    double parallel_distance = 0.0;
+    tree_1.FindClosestTrianglesParallel(tree_2, closest_1, closest_2, parallel_distance, 4);
+    EXPECT_EQ(parallel_distance, distance);
+}
+
+TEST(AABBTreeTest, EmptyTree)
+{
+    AABBTree empty(std::make_shared<const Mesh>());
+    AABBTree tree(RandomMesh(10, 0.0, 6));
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double distance = 0.0;
+    tree.FindClosestTriangles(empty, closest_1, closest_2, distance);
+    EXPECT_EQ(closest_1, AABBTree::kNoTriangle);
+    EXPECT_EQ(closest_2, AABBTree::kNoTriangle);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
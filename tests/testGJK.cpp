@@ -0,0 +1,272 @@
+#include "AABBTree.hpp"
+#include "ConvexBody.hpp"
+#include "Distance.hpp"
+#include "GJK.hpp"
+#include "MathOperations.hpp"
+#include "Triangle.hpp"
+#include "Vector.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace math;
+using namespace dist;
+
+namespace
+{
+    Triangle MakeTriangle(const TrianglePoints &points)
+    {
+        return Triangle(0, Vector{}, std::array<Vector, 3>{Vector(points[0]), Vector(points[1]), Vector(points[2])});
+    }
+
+    TrianglePoints RandomTriangle(std::mt19937 &generator, const std::array<double, 3> &shift)
+    {
+        std::uniform_real_distribution<double> coord(-1.0, 1.0);
+        TrianglePoints points;
+        for (std::array<double, 3> &point : points)
+        {
+            for (size_t axis = 0; axis != 3; ++axis)
+            {
+                point[axis] = coord(generator) + shift[axis];
+            }
+        }
+        return points;
+    }
+
+    // Точки на сфере (чётные) и заведомо внутри неё (нечётные)
+    std::vector<Vector> RandomBall(std::mt19937 &generator, const Vector &center, const double radius,
+                                   const size_t count)
+    {
+        std::normal_distribution<double> normal;
+        std::uniform_real_distribution<double> fraction(0.0, 0.9);
+        std::vector<Vector> points;
+        for (size_t i = 0; i != count; ++i)
+        {
+            const Vector direction{normal(generator), normal(generator), normal(generator)};
+            const double length = i % 2 == 0 ? radius : radius * fraction(generator);
+            points.push_back(center + direction * (length / std::sqrt(direction * direction)));
+        }
+        return points;
+    }
+
+    // Вершины и случайные внутренние точки бокса
+    std::vector<Vector> BoxPoints(std::mt19937 &generator, const Vector &low, const Vector &high)
+    {
+        std::uniform_real_distribution<double> fraction(0.0, 1.0);
+        std::vector<Vector> points;
+        for (size_t corner = 0; corner != 8; ++corner)
+        {
+            points.push_back(Vector{corner & 1 ? high[0] : low[0], corner & 2 ? high[1] : low[1],
+                                    corner & 4 ? high[2] : low[2]});
+        }
+        for (size_t i = 0; i != 50; ++i)
+        {
+            points.push_back(Vector{low[0] + fraction(generator) * (high[0] - low[0]),
+                                    low[1] + fraction(generator) * (high[1] - low[1]),
+                                    low[2] + fraction(generator) * (high[2] - low[2])});
+        }
+        return points;
+    }
+} // namespace
+
+TEST(GJKTest, MatchesTriangleDistance)
+{
+    // Разделённые, касающиеся, пересекающиеся и вырожденные пары
+    std::mt19937 generator(1);
+    for (size_t i = 0; i != 500; ++i)
+    {
+        TrianglePoints points_a = RandomTriangle(generator, {0.0, 0.0, 0.0});
+        const TrianglePoints points_b = RandomTriangle(generator, {0.5 * static_cast<double>(i % 6), 0.0, 0.0});
+        if (i % 25 == 0)
+        {
+            points_a[2] = points_a[1];
+        }
+        std::array<double, 3> closest_a, closest_b;
+        const double expected = TriangleDistance(points_a, points_b, closest_a, closest_b);
+        EXPECT_NEAR(GJK::Distance(MakeTriangle(points_a), MakeTriangle(points_b)), expected, 1e-9) << "pair " << i;
+    }
+
+    // Вершина над гранью и параллельные рёбра
+    const Triangle face = MakeTriangle({{{0.0, 0.0, 0.0}, {4.0, 0.0, 0.0}, {0.0, 4.0, 0.0}}});
+    const Triangle apex = MakeTriangle({{{1.0, 1.0, 2.0}, {1.0, 2.0, 5.0}, {2.0, 1.0, 5.0}}});
+    const Triangle parallel = MakeTriangle({{{1.0, -1.0, 0.0}, {3.0, -1.0, 0.0}, {2.0, -3.0, 0.0}}});
+    EXPECT_NEAR(GJK::Distance(face, apex), 2.0, 1e-12);
+    EXPECT_NEAR(GJK::Distance(face, parallel), 1.0, 1e-12);
+}
+
+TEST(GJKTest, WarmStartConverges)
+{
+    // Одна пара, понемногу сдвигаемая: симплекс прошлого запроса - начальный для следующего
+    std::mt19937 generator(2);
+    const TrianglePoints points_a = RandomTriangle(generator, {0.0, 0.0, 0.0});
+    const TrianglePoints start_b = RandomTriangle(generator, {3.0, 0.0, 0.0});
+
+    GJKSimplex simplex;
+    GJKStats warm, cold;
+    for (size_t step = 0; step != 100; ++step)
+    {
+        TrianglePoints points_b = start_b;
+        for (std::array<double, 3> &point : points_b)
+        {
+            point[1] += 0.01 * static_cast<double>(step);
+        }
+        const Triangle a = MakeTriangle(points_a), b = MakeTriangle(points_b);
+        std::array<double, 3> closest_a, closest_b;
+        const double expected = TriangleDistance(points_a, points_b, closest_a, closest_b);
+
+        EXPECT_NEAR(GJK::Distance(a, b, simplex, std::numeric_limits<double>::infinity(), &warm), expected, 1e-9);
+        GJKSimplex empty;
+        GJK::Distance(a, b, empty, std::numeric_limits<double>::infinity(), &cold);
+        EXPECT_GE(simplex.size, 1u);
+        EXPECT_LE(simplex.size, 3u);
+    }
+    EXPECT_EQ(warm.queries, 100u);
+    EXPECT_LT(warm.iterations, cold.iterations);
+    EXPECT_LE(warm.iterations, 2 * warm.queries);
+
+    // Симплекс с номерами вершин вне тел отбрасывается
+    GJKSimplex invalid;
+    invalid.vertices[0] = {7, 7};
+    invalid.size = 1;
+    std::array<double, 3> closest_a, closest_b;
+    EXPECT_NEAR(GJK::Distance(MakeTriangle(points_a), MakeTriangle(start_b), invalid),
+                TriangleDistance(points_a, start_b, closest_a, closest_b), 1e-9);
+}
+
+TEST(GJKTest, ConvexBodySupportMatchesScan)
+{
+    std::mt19937 generator(3);
+    const std::vector<Vector> points = RandomBall(generator, Vector{1.0, -2.0, 0.5}, 3.0, 2000);
+    const ConvexBody body(points);
+    EXPECT_LT(body.VertexCount(), points.size());
+    EXPECT_EQ(body.SourceIndices().size(), body.VertexCount());
+    EXPECT_EQ(body.Neighbors().size(), 3 * body.FaceCount());
+
+    // Внутренние точки в оболочку не входят
+    for (const uint32_t source : body.SourceIndices())
+    {
+        EXPECT_EQ(source % 2, 0u);
+    }
+
+    // Подъём из любой вершины находит ту же проекцию, что и перебор всех исходных точек
+    std::normal_distribution<double> normal;
+    std::uniform_int_distribution<uint32_t> start(0, body.VertexCount() - 1);
+    size_t steps = 0;
+    for (size_t i = 0; i != 200; ++i)
+    {
+        const std::array<double, 3> direction = {normal(generator), normal(generator), normal(generator)};
+        double expected = std::numeric_limits<double>::lowest();
+        for (const Vector &point : points)
+        {
+            expected = std::max(expected, point[0] * direction[0] + point[1] * direction[1] + point[2] * direction[2]);
+        }
+        const std::array<double, 3> &vertex = body.Vertex(body.Support(direction, start(generator), &steps));
+        EXPECT_NEAR(vertex[0] * direction[0] + vertex[1] * direction[1] + vertex[2] * direction[2], expected, 1e-9);
+    }
+    EXPECT_LT(steps, 200 * static_cast<size_t>(body.VertexCount()));
+
+    // Плоское облако: вершины - все точки
+    const std::vector<Vector> square = {Vector{0.0, 0.0, 1.0}, Vector{1.0, 0.0, 1.0}, Vector{0.0, 1.0, 1.0},
+                                        Vector{1.0, 1.0, 1.0}, Vector{0.5, 0.5, 1.0}};
+    const ConvexBody flat(square);
+    EXPECT_EQ(flat.VertexCount(), square.size());
+    EXPECT_EQ(flat.FaceCount(), 0u);
+    EXPECT_EQ(flat.Support({1.0, 1.0, 0.0}, 0), 3u);
+
+    EXPECT_THROW(ConvexBody(std::vector<Vector>{}), std::invalid_argument);
+}
+
+TEST(GJKTest, ConvexBodyDistance)
+{
+    std::mt19937 generator(4);
+    const ConvexBody box(BoxPoints(generator, Vector{0.0, 0.0, 0.0}, Vector{1.0, 1.0, 1.0}));
+    EXPECT_EQ(box.VertexCount(), 8u);
+
+    // Грань к грани, ребро к ребру, вершина к вершине и пересечение
+    const ConvexBody face(BoxPoints(generator, Vector{3.0, 0.5, 0.2}, Vector{4.0, 1.5, 1.2}));
+    const ConvexBody edge(BoxPoints(generator, Vector{2.0, 2.0, 0.0}, Vector{3.0, 3.0, 1.0}));
+    const ConvexBody corner(BoxPoints(generator, Vector{2.0, 3.0, 3.0}, Vector{3.0, 4.0, 4.0}));
+    const ConvexBody overlap(BoxPoints(generator, Vector{0.5, 0.5, 0.5}, Vector{2.0, 2.0, 2.0}));
+    EXPECT_NEAR(GJK::Distance(box, face), 2.0, 1e-9);
+    EXPECT_NEAR(GJK::Distance(edge, box), std::sqrt(2.0), 1e-9);
+    EXPECT_NEAR(GJK::Distance(box, corner), 3.0, 1e-9);
+    EXPECT_EQ(GJK::Distance(box, overlap), 0.0);
+
+    // Шары: расстояние между центрами без радиусов с точностью выборки поверхности
+    const ConvexBody ball_a(RandomBall(generator, Vector{0.0, 0.0, 0.0}, 1.0, 4000));
+    const ConvexBody ball_b(RandomBall(generator, Vector{5.0, 1.0, -2.0}, 2.0, 4000));
+    const double centers = std::sqrt(30.0);
+    std::array<double, 3> axis{};
+    GJKSimplex simplex;
+    GJKStats stats;
+    const double distance = GJK::Distance(ball_a, ball_b, simplex, std::numeric_limits<double>::infinity(), &stats,
+                                          &axis);
+    EXPECT_GE(distance, centers - 3.0 - 1e-9);
+    EXPECT_LE(distance, centers - 3.0 + 0.1);
+    EXPECT_NEAR(std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]), distance, 1e-12);
+    EXPECT_LT(axis[0], 0.0);
+
+    // Повторный запрос с итоговым симплексом сходится сразу
+    GJKStats warm;
+    EXPECT_NEAR(GJK::Distance(ball_a, ball_b, simplex, std::numeric_limits<double>::infinity(), &warm), distance,
+                1e-12);
+    EXPECT_LE(warm.iterations, 1u);
+    EXPECT_LT(warm.support_steps, stats.support_steps);
+}
+
+TEST(GJKTest, ConvexLowerBound)
+{
+    // Наборы случайных треугольников: оболочки невыпуклых тел ближе самих тел
+    std::mt19937 generator(5);
+    for (size_t i = 0; i != 20; ++i)
+    {
+        std::vector<Triangle> triangles_1, triangles_2;
+        for (size_t k = 0; k != 30; ++k)
+        {
+            triangles_1.push_back(MakeTriangle(RandomTriangle(generator, {0.0, 0.0, 0.0})));
+            triangles_2.push_back(MakeTriangle(
+                RandomTriangle(generator, {1.5 + 0.5 * static_cast<double>(i), 3.0 * std::sin(static_cast<double>(k)),
+                                           0.0})));
+        }
+        Distance distance(triangles_1, triangles_2);
+        const double exact = distance.FindDistanceBetweenBody();
+        const double lower = distance.ConvexLowerBound();
+        EXPECT_LE(lower, exact + 1e-12) << "pair " << i;
+        EXPECT_GE(lower, 0.0);
+        if (i > 10)
+        {
+            EXPECT_GT(lower, 0.0) << "pair " << i;
+        }
+        EXPECT_NEAR(distance.ConvexLowerBound(), lower, 1e-12);
+    }
+
+    // Выпуклые тела - точное расстояние
+    const std::vector<Triangle> tetrahedron_1 = {
+        MakeTriangle({{{0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}}}),
+        MakeTriangle({{{0.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}}),
+        MakeTriangle({{{0.0, 0.0, 0.0}, {0.0, 0.0, 1.0}, {1.0, 0.0, 0.0}}}),
+        MakeTriangle({{{1.0, 0.0, 0.0}, {0.0, 0.0, 1.0}, {0.0, 1.0, 0.0}}})};
+    std::vector<Triangle> tetrahedron_2;
+    for (const Triangle &triangle : tetrahedron_1)
+    {
+        std::array<Vector, 3> points;
+        for (size_t corner = 0; corner != 3; ++corner)
+        {
+            points[corner] = triangle.GetPoint(corner) * -1.0 + Vector{3.0, 3.0, 3.0};
+        }
+        tetrahedron_2.push_back(Triangle(0, Vector{}, points));
+    }
+    Distance tetrahedra(tetrahedron_1, tetrahedron_2);
+    EXPECT_NEAR(tetrahedra.ConvexLowerBound(), tetrahedra.FindDistanceBetweenBody(), 1e-9);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
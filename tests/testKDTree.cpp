@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
 #include <vector>
 
 using namespace math;
@@ -72,6 +73,17 @@ TEST_F(KDTreeTest, NearestNeighborFarPoint)
     EXPECT_EQ(nearest, Vector({7.0, 8.0, 9.0}));
 }
 
+TEST_F(KDTreeTest, NearestNeighborOverMesh)
+{
+    // Дерево по сетке не копирует вершины и возвращает их индексы как номера
+    auto mesh = std::make_shared<const Mesh>(Mesh::FromPoints(points));
+    KDTree tree(mesh);
+    Vector nearest = tree.NearestNeighbor(Vector({5.0, 5.0, 5.0}));
+
+    EXPECT_EQ(nearest, Vector({4.0, 5.0, 6.0}));
+    EXPECT_EQ(nearest.GetNum(), 1u);
+}
+
 // Main function for running all tests
 int main(int argc, char **argv)
 {
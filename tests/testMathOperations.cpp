@@ -1,11 +1,17 @@
+#include "GJK.hpp"
 #include "Matrix.hpp"
 #include "MathOperations.hpp"
+#include "Triangle.hpp"
 #include "Vector.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <random>
 #include <stdexcept>
+#include <vector>
 
 using namespace math;
 
@@ -56,6 +62,231 @@ TEST_F(MathOperationsTest, Normalize)
     EXPECT_THROW(Normalize(Vector{0.0, 0.0, 0.0}), std::invalid_argument);
 }
 
+TEST(TriangleDistanceTest, ClosedForm)
+{
+    std::array<double, 3> closest_a, closest_b;
+    const TrianglePoints base = {{{0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}}};
+
+    // Вершина над гранью
+    const TrianglePoints above = {{{0.2, 0.2, 2.0}, {0.2, 0.2, 3.0}, {1.2, 0.2, 3.0}}};
+    EXPECT_DOUBLE_EQ(TriangleDistance(base, above, closest_a, closest_b), 2.0);
+    EXPECT_DOUBLE_EQ(closest_a[0], 0.2);
+    EXPECT_DOUBLE_EQ(closest_a[2], 0.0);
+    EXPECT_DOUBLE_EQ(closest_b[2], 2.0);
+
+    // Скрещенные рёбра: ребро (0,0,0)-(1,0,0) и отрезок над ним поперёк
+    const TrianglePoints crossed = {{{0.5, -1.0, 1.0}, {0.5, 1.0, 1.0}, {0.5, 0.0, 3.0}}};
+    EXPECT_DOUBLE_EQ(TriangleDistance(base, crossed, closest_a, closest_b), 1.0);
+
+    // Ребро, проходящее сквозь грань
+    const TrianglePoints pierce = {{{0.2, 0.2, -1.0}, {0.2, 0.2, 1.0}, {3.0, 3.0, 0.5}}};
+    EXPECT_EQ(TriangleDistance(base, pierce, closest_a, closest_b), 0.0);
+    EXPECT_EQ(closest_a, closest_b);
+
+    // Вырожденный треугольник-точка
+    const TrianglePoints point = {{{2.0, 0.0, 0.0}, {2.0, 0.0, 0.0}, {2.0, 0.0, 0.0}}};
+    EXPECT_DOUBLE_EQ(TriangleDistance(base, point, closest_a, closest_b), 1.0);
+}
+
+namespace
+{
+    using Point = std::array<double, 3>;
+
+    Point Sub(const Point &a, const Point &b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+
+    double Dot(const Point &a, const Point &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+    Point Along(const Point &a, const Point &d, const double t) { return {a[0] + t * d[0], a[1] + t * d[1], a[2] + t * d[2]}; }
+
+    // Ближайшая к p точка треугольника abc по областям Вороного (Эриксон, 5.1.5)
+    Point ClosestOnTriangle(const Point &p, const Point &a, const Point &b, const Point &c)
+    {
+        const Point ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+        const double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+        if (d1 <= 0.0 && d2 <= 0.0)
+        {
+            return a;
+        }
+        const Point bp = Sub(p, b);
+        const double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+        if (d3 >= 0.0 && d4 <= d3)
+        {
+            return b;
+        }
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        {
+            return Along(a, ab, d1 / (d1 - d3));
+        }
+        const Point cp = Sub(p, c);
+        const double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+        if (d6 >= 0.0 && d5 <= d6)
+        {
+            return c;
+        }
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        {
+            return Along(a, ac, d2 / (d2 - d6));
+        }
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+        {
+            return Along(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+        const double denom = 1.0 / (va + vb + vc);
+        return Along(Along(a, ab, vb * denom), ac, vc * denom);
+    }
+} // namespace
+
+TEST(TriangleDistanceTest, MatchesSampledDistance)
+{
+    // Эталон - минимум точных расстояний от точек сетки на первом треугольнике
+    // до второго: он не меньше точного и отличается от него не больше шага сетки
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> coord(-1.0, 1.0);
+    const size_t steps = 60;
+    for (size_t i = 0; i != 200; ++i)
+    {
+        TrianglePoints tr_a, tr_b;
+        for (size_t corner = 0; corner != 3; ++corner)
+        {
+            tr_a[corner] = {coord(generator), coord(generator), coord(generator)};
+            tr_b[corner] = {coord(generator) + (i % 2 == 0 ? 2.5 : 0.5), coord(generator), coord(generator)};
+        }
+        std::array<double, 3> closest_a, closest_b;
+        const double distance = TriangleDistance(tr_a, tr_b, closest_a, closest_b);
+        EXPECT_NEAR(std::sqrt(Dot(Sub(closest_a, closest_b), Sub(closest_a, closest_b))), distance, 1e-12);
+
+        double sampled = std::numeric_limits<double>::max();
+        for (size_t u = 0; u <= steps; ++u)
+        {
+            for (size_t v = 0; u + v <= steps; ++v)
+            {
+                const double wu = static_cast<double>(u) / steps, wv = static_cast<double>(v) / steps;
+                Point p{};
+                for (size_t axis = 0; axis != 3; ++axis)
+                {
+                    p[axis] = wu * tr_a[0][axis] + wv * tr_a[1][axis] + (1.0 - wu - wv) * tr_a[2][axis];
+                }
+                const Point q = ClosestOnTriangle(p, tr_b[0], tr_b[1], tr_b[2]);
+                sampled = std::min(sampled, std::sqrt(Dot(Sub(p, q), Sub(p, q))));
+            }
+        }
+        EXPECT_LE(distance, sampled + 1e-12);
+        EXPECT_GE(distance, sampled - 0.1);
+    }
+}
+
+TEST(TriangleDistanceTest, BatchMatchesScalar)
+{
+    // Разделённые, пересекающиеся, вырожденные пары и неполный последний проход
+    std::mt19937 generator(2);
+    std::uniform_real_distribution<double> coord(-1.0, 1.0);
+    const size_t count = 4 * 50 + 3;
+    std::vector<TrianglePoints> triangles_a(count), triangles_b(count);
+    for (size_t k = 0; k != count; ++k)
+    {
+        for (size_t corner = 0; corner != 3; ++corner)
+        {
+            triangles_a[k][corner] = {coord(generator), coord(generator), coord(generator)};
+            triangles_b[k][corner] = {coord(generator) + static_cast<double>(k % 3), coord(generator), coord(generator)};
+        }
+        if (k % 7 == 0)
+        {
+            triangles_a[k][2] = triangles_a[k][1]; // Отрезок
+        }
+        if (k % 11 == 0)
+        {
+            triangles_b[k][1] = triangles_b[k][0]; // Точка
+            triangles_b[k][2] = triangles_b[k][0];
+        }
+    }
+
+    std::vector<double> coords_a(9 * count), coords_b(9 * count);
+    for (size_t k = 0; k != count; ++k)
+    {
+        for (size_t row = 0; row != 9; ++row)
+        {
+            coords_a[row * count + k] = triangles_a[k][row / 3][row % 3];
+            coords_b[row * count + k] = triangles_b[k][row / 3][row % 3];
+        }
+    }
+    std::vector<double> distances(count);
+    TriangleDistances(coords_a.data(), coords_b.data(), count, count, distances.data());
+
+    size_t num_intersecting = 0;
+    for (size_t k = 0; k != count; ++k)
+    {
+        std::array<double, 3> closest_a, closest_b;
+        const double expected = TriangleDistance(triangles_a[k], triangles_b[k], closest_a, closest_b);
+        EXPECT_NEAR(distances[k], expected, 1e-12) << "pair " << k;
+        num_intersecting += expected == 0.0 ? 1 : 0;
+    }
+    EXPECT_GT(num_intersecting, 0u);
+}
+
+TEST(TriangleDistanceTest, BoundSkipsOnlyLosingPairs)
+{
+    // С границей пары, которые ближе неё, считаются точно, остальные дают значение не меньше неё
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> coord(-1.0, 1.0);
+    const size_t count = 4 * 50;
+    std::vector<TrianglePoints> triangles_a(count), triangles_b(count);
+    std::vector<double> coords_a(9 * count), coords_b(9 * count);
+    for (size_t k = 0; k != count; ++k)
+    {
+        for (size_t corner = 0; corner != 3; ++corner)
+        {
+            triangles_a[k][corner] = {coord(generator), coord(generator), coord(generator)};
+            triangles_b[k][corner] = {coord(generator), coord(generator), coord(generator) + 1.5 * static_cast<double>(k % 4)};
+        }
+        for (size_t row = 0; row != 9; ++row)
+        {
+            coords_a[row * count + k] = triangles_a[k][row / 3][row % 3];
+            coords_b[row * count + k] = triangles_b[k][row / 3][row % 3];
+        }
+    }
+
+    for (const double bound : {0.5, 1.5, 3.0})
+    {
+        std::vector<double> batched(count);
+        TriangleDistances(coords_a.data(), coords_b.data(), count, count, batched.data(), bound);
+        size_t num_skipped = 0;
+        for (size_t k = 0; k != count; ++k)
+        {
+            std::array<double, 3> closest_a, closest_b;
+            const double exact = TriangleDistance(triangles_a[k], triangles_b[k], closest_a, closest_b);
+            const double bounded = TriangleDistance(triangles_a[k], triangles_b[k], closest_a, closest_b, bound);
+            EXPECT_LE(PlaneSeparation(triangles_a[k], triangles_b[k]), exact + 1e-12);
+            if (exact < bound)
+            {
+                EXPECT_EQ(bounded, exact);
+                EXPECT_NEAR(batched[k], exact, 1e-12);
+            }
+            else
+            {
+                EXPECT_GE(bounded, bound);
+                EXPECT_GE(batched[k], bound);
+                num_skipped += bounded != exact ? 1 : 0;
+            }
+
+            const Triangle tr_a(0, Vector{}, std::array<Vector, 3>{Vector(triangles_a[k][0]), Vector(triangles_a[k][1]),
+                                                               Vector(triangles_a[k][2])});
+            const Triangle tr_b(0, Vector{}, std::array<Vector, 3>{Vector(triangles_b[k][0]), Vector(triangles_b[k][1]),
+                                                               Vector(triangles_b[k][2])});
+            if (PlaneSeparation(triangles_a[k], triangles_b[k]) >= bound)
+            {
+                EXPECT_GE(dist::GJK::Distance(tr_a, tr_b, bound), bound);
+            }
+        }
+        if (bound < 3.0)
+        {
+            EXPECT_GT(num_skipped, 0u);
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
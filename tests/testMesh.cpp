@@ -0,0 +1,118 @@
+#include "Mesh.hpp"
+#include "MathOperations.hpp"
+#include "Triangle.hpp"
+#include "Vector.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace math;
+
+class MeshTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // Квадрат из двух треугольников с общим ребром 1-2
+        const Vector normal{0.0, 0.0, 1.0};
+        const Vector p0(0, {0.0, 0.0, 0.0});
+        const Vector p1(1, {1.0, 0.0, 0.0});
+        const Vector p2(2, {0.0, 1.0, 0.0});
+        const Vector p3(3, {1.0, 1.0, 0.0});
+        triangles = {Triangle(0, normal, p0, p1, p2), Triangle(1, normal, p1, p3, p2)};
+    }
+
+    std::vector<Triangle> triangles;
+};
+
+TEST_F(MeshTest, FromTrianglesSharesVertices)
+{
+    const Mesh mesh = Mesh::FromTriangles(triangles);
+
+    EXPECT_EQ(mesh.VertexCount(), 4u);
+    EXPECT_EQ(mesh.TriangleCount(), 2u);
+    EXPECT_TRUE(mesh.HasNormals());
+    EXPECT_EQ(mesh.Indices(), (std::vector<uint32_t>{0, 1, 2, 1, 3, 2}));
+    EXPECT_EQ(mesh.GetVertex(3), Vector({1.0, 1.0, 0.0}));
+    EXPECT_EQ(mesh.GetNorm(1), Vector({0.0, 0.0, 1.0}));
+}
+
+TEST_F(MeshTest, RoundTripTriangles)
+{
+    const Mesh mesh = Mesh::FromTriangles(triangles);
+    const std::vector<Triangle> restored = mesh.ToTriangles();
+
+    ASSERT_EQ(restored.size(), triangles.size());
+    for (size_t i = 0; i != triangles.size(); ++i)
+    {
+        EXPECT_EQ(restored[i], triangles[i]);
+        EXPECT_EQ(restored[i].GetNum(), i);
+        for (size_t j = 0; j != 3; ++j)
+        {
+            EXPECT_EQ(restored[i].GetPoint(j).GetNum(), triangles[i].GetPoint(j).GetNum());
+        }
+    }
+    EXPECT_EQ(mesh.GetMidlePoint(1), triangles[1].GetMidlePoint());
+}
+
+TEST_F(MeshTest, InconsistentNumbersSplitCorners)
+{
+    // Одинаковые номера у разных точек - номерам доверять нельзя
+    triangles[1] = Triangle(1, Vector{0.0, 0.0, 1.0},
+                            Vector(0, {5.0, 0.0, 0.0}), Vector(0, {6.0, 0.0, 0.0}), Vector(0, {5.0, 1.0, 0.0}));
+    const Mesh mesh = Mesh::FromTriangles(triangles);
+
+    EXPECT_EQ(mesh.VertexCount(), 6u);
+    EXPECT_EQ(mesh.GetTriangle(1), triangles[1]);
+}
+
+TEST_F(MeshTest, Bounds)
+{
+    const Mesh mesh = Mesh::FromTriangles(triangles);
+    std::array<double, 3> min_bounds, max_bounds;
+    mesh.TriangleBounds(1, min_bounds, max_bounds);
+
+    EXPECT_EQ(min_bounds, (std::array<double, 3>{0.0, 0.0, 0.0}));
+    EXPECT_EQ(max_bounds, (std::array<double, 3>{1.0, 1.0, 0.0}));
+}
+
+TEST_F(MeshTest, InvalidBuffers)
+{
+    EXPECT_THROW(Mesh({0.0}, {0.0, 1.0}, {0.0}, {}), std::invalid_argument);
+    EXPECT_THROW(Mesh({0.0}, {0.0}, {0.0}, {0, 0}), std::invalid_argument);
+    EXPECT_THROW(Mesh({0.0}, {0.0}, {0.0}, {0, 0, 1}), std::invalid_argument);
+}
+
+TEST_F(MeshTest, SinglePrecisionExactForFloatInput)
+{
+    // Координаты представимы во float - округления нет
+    const Mesh mesh = Mesh::FromTriangles(triangles);
+    const Mesh single = mesh.ToSinglePrecision();
+
+    EXPECT_TRUE(single.IsSinglePrecision());
+    EXPECT_TRUE(single.X().empty());
+    EXPECT_EQ(single.RoundingError(), 0.0);
+    EXPECT_LT(single.MemoryBytes(), mesh.MemoryBytes());
+    EXPECT_EQ(single.ToTriangles(), mesh.ToTriangles());
+    EXPECT_EQ(single.GetNorm(0), mesh.GetNorm(0));
+}
+
+TEST_F(MeshTest, SinglePrecisionRoundingErrorBound)
+{
+    const Mesh mesh({0.1, 1.0 / 3.0, 12345.678901}, {0.2, 0.0, 1e-9}, {0.3, 2.0 / 3.0, -7.7}, {0, 1, 2});
+    const Mesh single = mesh.ToSinglePrecision();
+
+    EXPECT_GT(single.RoundingError(), 0.0);
+    for (size_t i = 0; i != mesh.VertexCount(); ++i)
+    {
+        EXPECT_LE(Norm2(mesh.GetVertex(i) - single.GetVertex(i)), single.RoundingError());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,220 @@
+#include "MeshCache.hpp"
+#include "Distance.hpp"
+#include "ReadSTL.hpp"
+#include "Triangle.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace math;
+using namespace read_stl;
+
+// Два тела: треугольник в плоскости z = 0 и такой же, поднятый на offset
+void CreateTestAsciiBody(const std::string &filename, const double offset)
+{
+    std::ofstream out(filename);
+    out << "solid body\n";
+    for (size_t i = 0; i != 20; ++i)
+    {
+        out << "facet normal 0 0 1\nouter loop\n"
+            << "vertex " << i << " 0 " << offset << "\n"
+            << "vertex " << i + 1 << " 0 " << offset << "\n"
+            << "vertex " << i << " 1 " << offset << "\n"
+            << "endloop\nendfacet\n";
+    }
+    out << "endsolid body\n";
+}
+
+class MeshCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        cache_dir = "test_mesh_cache";
+        body_1 = "test_cache_body_1.stl";
+        body_2 = "test_cache_body_2.stl";
+        std::filesystem::remove_all(cache_dir);
+        CreateTestAsciiBody(body_1, 0.0);
+        CreateTestAsciiBody(body_2, 2.5);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(cache_dir);
+        std::filesystem::remove(body_1);
+        std::filesystem::remove(body_2);
+    }
+
+    std::string cache_dir;
+    std::string body_1;
+    std::string body_2;
+};
+
+TEST_F(MeshCacheTest, MissThenHit)
+{
+    MeshCache cache(cache_dir);
+
+    CachedBody cold = cache.Load(body_1);
+    EXPECT_FALSE(cold.from_cache);
+    ASSERT_TRUE(cold.tree);
+
+    CachedBody warm = cache.Load(body_1);
+    EXPECT_TRUE(warm.from_cache);
+    ASSERT_TRUE(warm.tree);
+
+    // Буферы сетки совпадают с разбором файла
+    const Mesh expected = ReadMesh(body_1);
+    ASSERT_TRUE(warm.mesh);
+    EXPECT_EQ(warm.mesh->X(), expected.X());
+    EXPECT_EQ(warm.mesh->Y(), expected.Y());
+    EXPECT_EQ(warm.mesh->Z(), expected.Z());
+    EXPECT_EQ(warm.mesh->Indices(), expected.Indices());
+    EXPECT_EQ(warm.mesh->NZ(), expected.NZ());
+}
+
+TEST_F(MeshCacheTest, CachedTreeGivesSameDistance)
+{
+    MeshCache cache(cache_dir);
+    cache.Load(body_1);
+    cache.Load(body_2);
+
+    CachedBody cached_1 = cache.Load(body_1);
+    CachedBody cached_2 = cache.Load(body_2);
+    ASSERT_TRUE(cached_1.from_cache && cached_2.from_cache);
+
+    dist::Distance fresh(GetTriangles(body_1), GetTriangles(body_2));
+    dist::Distance warm(cached_1.mesh, cached_2.mesh);
+    EXPECT_DOUBLE_EQ(fresh.FindDistanceBetweenBody(),
+                     warm.FindDistanceBetweenBody(*cached_1.tree, *cached_2.tree));
+    EXPECT_DOUBLE_EQ(warm.FindDistanceBetweenBody(*cached_1.tree, *cached_2.tree), 2.5);
+}
+
+TEST_F(MeshCacheTest, SinglePrecisionCache)
+{
+    MeshCache cache(cache_dir);
+    CachedBody cold = cache.Load(body_1, {.single_precision = true});
+    CachedBody warm = cache.Load(body_1, {.single_precision = true});
+    ASSERT_TRUE(warm.from_cache);
+    EXPECT_TRUE(warm.mesh->IsSinglePrecision());
+    EXPECT_EQ(warm.mesh->XF(), cold.mesh->XF());
+    EXPECT_EQ(warm.mesh->RoundingError(), cold.mesh->RoundingError());
+
+    // Другая точность хранения - другой кэш
+    EXPECT_FALSE(cache.Load(body_1).from_cache);
+
+    // Целые координаты представимы во float, расстояние не меняется
+    CachedBody other = cache.Load(body_2, {.single_precision = true});
+    dist::Distance single(warm.mesh, other.mesh);
+    EXPECT_DOUBLE_EQ(single.FindDistanceBetweenBody(*warm.tree, *other.tree), 2.5);
+    EXPECT_EQ(single.ErrorBound(), 0.0);
+}
+
+TEST_F(MeshCacheTest, PipelinedLoadGivesSameDistance)
+{
+    // Тела и деревья загружаются одновременно, результат тот же
+    dist::Distance sequential(GetTriangles(body_1), GetTriangles(body_2));
+    dist::Distance pipelined = dist::Distance::Load(body_1, body_2, {});
+    EXPECT_DOUBLE_EQ(pipelined.FindDistanceBetweenBody(), sequential.FindDistanceBetweenBody());
+    EXPECT_DOUBLE_EQ(pipelined.FindDistanceBetweenBody(), 2.5);
+
+    EXPECT_THROW(dist::Distance::Load(body_1, "no_such_file.stl", {}), std::runtime_error);
+}
+
+TEST_F(MeshCacheTest, StreamDistanceReportsClosestTriangles)
+{
+    // Треугольники второго тела на высоте 10 + i, кроме одного во второй порции
+    const std::string stream_body = "test_cache_stream_body.stl";
+    {
+        std::ofstream out(stream_body);
+        out << "solid stream\n";
+        for (size_t i = 0; i != 20; ++i)
+        {
+            const double z = i == 13 ? 3.0 : 10.0 + static_cast<double>(i);
+            out << "facet normal 0 0 1\nouter loop\n"
+                << "vertex " << i << " 0 " << z << "\n"
+                << "vertex " << i + 1 << " 0 " << z << "\n"
+                << "vertex " << i << " 1 " << z << "\n"
+                << "endloop\nendfacet\n";
+        }
+        out << "endsolid stream\n";
+    }
+
+    MeshCache cache(cache_dir);
+    const CachedBody body = cache.Load(body_1);
+    StlStream stream(stream_body, 8);
+    size_t closest_1 = 0, closest_2 = 0;
+    EXPECT_DOUBLE_EQ(dist::Distance::FindDistanceToStream(*body.tree, stream, closest_1, closest_2), 3.0);
+    EXPECT_EQ(closest_2, 13u);
+    EXPECT_DOUBLE_EQ(body.mesh->GetTriangle(closest_1).GetPoint(0)[2], 0.0);
+
+    // Пустой поток - ошибка, как и пустое тело
+    {
+        std::ofstream out(stream_body);
+        out << "solid empty\nendsolid empty\n";
+    }
+    StlStream empty(stream_body);
+    EXPECT_THROW(dist::Distance::FindDistanceToStream(*body.tree, empty), std::invalid_argument);
+    std::filesystem::remove(stream_body);
+}
+
+TEST_F(MeshCacheTest, ChangedContentInvalidatesCache)
+{
+    MeshCache cache(cache_dir);
+    cache.Load(body_1);
+
+    // Тот же путь, другое содержимое - другой ключ
+    CreateTestAsciiBody(body_1, 1.0);
+    CachedBody changed = cache.Load(body_1);
+    EXPECT_FALSE(changed.from_cache);
+    EXPECT_DOUBLE_EQ(changed.mesh->GetTriangle(0).GetPoint(0)[2], 1.0);
+
+    // Другие параметры чтения - кэш пересобирается
+    CachedBody welded = cache.Load(body_1, {.weld_tolerance = 1e-6});
+    EXPECT_FALSE(welded.from_cache);
+}
+
+TEST_F(MeshCacheTest, ReadOptionsUseSeparateFiles)
+{
+    MeshCache cache(cache_dir);
+    const std::vector<ReadOptions> options = {{}, {.weld_tolerance = 1e-6}, {.single_precision = true}};
+    for (const ReadOptions &read_options : options)
+    {
+        EXPECT_FALSE(cache.Load(body_1, read_options).from_cache);
+    }
+
+    // Чтения с разными параметрами по очереди не вытесняют друг друга
+    for (size_t round = 0; round != 2; ++round)
+    {
+        for (const ReadOptions &read_options : options)
+        {
+            EXPECT_TRUE(cache.Load(body_1, read_options).from_cache);
+        }
+    }
+    EXPECT_NE(cache.CachePath(1, options[0]), cache.CachePath(1, options[1]));
+    EXPECT_NE(cache.CachePath(1, options[0]), cache.CachePath(1, options[2]));
+}
+
+TEST_F(MeshCacheTest, CorruptedCacheIsRebuilt)
+{
+    MeshCache cache(cache_dir);
+    cache.Load(body_1);
+
+    std::ifstream in(body_1, std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::filesystem::path path = cache.CachePath(HashContent(content.data(), content.size()));
+    ASSERT_TRUE(std::filesystem::exists(path));
+    std::filesystem::resize_file(path, 10);
+
+    EXPECT_FALSE(cache.Load(body_1).from_cache);
+    EXPECT_TRUE(cache.Load(body_1).from_cache);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,166 @@
+#include "OBBTree.hpp"
+#include "AABBTree.hpp"
+#include "MathOperations.hpp"
+#include "Mesh.hpp"
+#include "TestMeshes.hpp"
+#include "Triangle.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace math;
+using namespace test_meshes;
+
+namespace
+{
+    // Тонкий стержень из треугольников вдоль направления (1, 1, 0), сдвинутый по (1, -1, 0) на shift.
+    // Последние bump треугольников сдвинуты вдвое меньше
+    std::shared_ptr<const Mesh> SlantedRod(const size_t num_triangles, const double shift, const size_t bump = 0)
+    {
+        std::vector<Triangle> triangles;
+        for (size_t i = 0; i != num_triangles; ++i)
+        {
+            const double s = (i + bump < num_triangles ? shift : 0.5 * shift) / std::sqrt(2.0);
+            const double t = static_cast<double>(i);
+            Vector a{t + s, t - s, 0.0};
+            Vector b{t + 1.0 + s, t + 1.0 - s, 0.0};
+            Vector c{t + 0.5 + s, t + 0.5 - s, 0.05};
+            a.SetNum(3 * i);
+            b.SetNum(3 * i + 1);
+            c.SetNum(3 * i + 2);
+            triangles.emplace_back(i, Vector{0.0, 0.0, 1.0}, a, b, c);
+        }
+        return std::make_shared<const Mesh>(Mesh::FromTriangles(triangles));
+    }
+} // namespace
+
+TEST(OBBTreeTest, RotatedBoxDistance)
+{
+    // Куб [-1, 1]^3 и такой же, повёрнутый на 45 градусов вокруг z, с центром (5, 0, 0)
+    const double r = 1.0 / std::sqrt(2.0);
+    const OBBTreeNode box_1{{0.0, 0.0, 0.0}, {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}}, {1.0, 1.0, 1.0}};
+    const OBBTreeNode box_2{{5.0, 0.0, 0.0}, {{{r, r, 0.0}, {-r, r, 0.0}, {0.0, 0.0, 1.0}}}, {1.0, 1.0, 1.0}};
+    EXPECT_NEAR(OBBTree::Distance(box_1, box_2), 4.0 - std::sqrt(2.0), 1e-12);
+    EXPECT_NEAR(OBBTree::Distance(box_2, box_1), 4.0 - std::sqrt(2.0), 1e-12);
+
+    // Пересекающиеся боксы
+    const OBBTreeNode box_3{{1.5, 0.0, 0.0}, box_2.axes, {1.0, 1.0, 1.0}};
+    EXPECT_EQ(OBBTree::Distance(box_1, box_3), 0.0);
+}
+
+TEST(OBBTreeTest, SlantedRodsAreSeparated)
+{
+    // Параллельные диагональные стержни: боксы по осям перекрываются, ориентированные - нет.
+    // Ближайшая пара - у выступа на конце второго стержня, остальные пары листьев
+    // ориентированные боксы отсекают
+    const auto mesh_1 = SlantedRod(64, 0.0);
+    const auto mesh_2 = SlantedRod(64, 1.0, 4);
+    const AABBTree tree_1(mesh_1);
+    const AABBTree tree_2(mesh_2);
+    const OBBTree obb_1(tree_1);
+    const OBBTree obb_2(tree_2);
+    const OBBTree aabb_2(tree_2, BoundingVolume::AABB);
+
+    EXPECT_GT(OBBTree::Distance(obb_1.Nodes()[0], obb_2.Nodes()[0]), 0.45);
+    EXPECT_EQ(OBBTree::Distance(obb_1.Nodes()[0], aabb_2.Nodes()[0]), 0.0);
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double obb_distance = 0.0, aabb_distance = 0.0;
+    AABBTreeQueryStats obb_stats, aabb_stats;
+    obb_1.FindClosestTriangles(obb_2, closest_1, closest_2, obb_distance, &obb_stats);
+    tree_1.FindClosestTriangles(tree_2, closest_1, closest_2, aabb_distance, &aabb_stats);
+    EXPECT_EQ(obb_distance, aabb_distance);
+    EXPECT_LT(obb_stats.triangle_pairs, aabb_stats.triangle_pairs);
+}
+
+TEST(OBBTreeTest, MatchesBruteForce)
+{
+    for (const double offset : {0.0, 5.0, 12.0})
+    {
+        const auto mesh_1 = RandomMesh(150, 0.0, 1);
+        const auto mesh_2 = RandomMesh(120, offset, 2);
+        const AABBTree tree_1(mesh_1);
+        const AABBTree tree_2(mesh_2);
+        const double expected = BruteForceDistance(*mesh_1, *mesh_2);
+
+        // Вид объёма выбирается для каждого тела
+        for (const BoundingVolume volume_1 : {BoundingVolume::AABB, BoundingVolume::OBB})
+        {
+            for (const BoundingVolume volume_2 : {BoundingVolume::AABB, BoundingVolume::OBB})
+            {
+                const OBBTree obb_1(tree_1, volume_1);
+                const OBBTree obb_2(tree_2, volume_2);
+                size_t closest_1 = 0, closest_2 = 0;
+                double distance = 0.0;
+                obb_1.FindClosestTriangles(obb_2, closest_1, closest_2, distance);
+                EXPECT_DOUBLE_EQ(distance, expected);
+            }
+        }
+    }
+}
+
+TEST(OBBTreeTest, RefitFollowsMovedVertices)
+{
+    // Первое тело сдвигается к второму на 9 по x: старые боксы не содержат его треугольников
+    const auto mesh_1 = RandomMesh(150, 0.0, 1);
+    const auto mesh_2 = RandomMesh(120, 12.0, 2);
+    AABBTree tree_1(mesh_1);
+    const AABBTree tree_2(mesh_2);
+    OBBTree obb_1(tree_1);
+    const OBBTree obb_2(tree_2);
+
+    const auto moved = MoveVertices(*mesh_1, [](size_t, const size_t axis, const double coord)
+                                    { return axis == 0 ? coord + 9.0 : coord; });
+    tree_1.Refit(moved);
+    obb_1.Refit();
+
+    size_t closest_1 = 0, closest_2 = 0;
+    double distance = 0.0;
+    obb_1.FindClosestTriangles(obb_2, closest_1, closest_2, distance);
+    EXPECT_DOUBLE_EQ(distance, BruteForceDistance(*moved, *mesh_2));
+    EXPECT_DOUBLE_EQ(distance, TriangleDistance(moved->GetTriangle(closest_1), mesh_2->GetTriangle(closest_2)));
+}
+
+TEST(OBBTreeTest, BoxesContainTriangles)
+{
+    const auto mesh = RandomMesh(200, 0.0, 3);
+    const AABBTree tree(mesh);
+    const OBBTree obb(tree);
+    for (size_t node = 0; node != tree.Nodes().size(); ++node)
+    {
+        const AABBTreeNode &leaf = tree.Nodes()[node];
+        if (!leaf.IsLeaf())
+        {
+            continue;
+        }
+        const OBBTreeNode &box = obb.Nodes()[node];
+        for (uint32_t i = leaf.offset; i != leaf.offset + leaf.count; ++i)
+        {
+            for (size_t corner = 0; corner != 3; ++corner)
+            {
+                const uint32_t vertex = mesh->Index(tree.Primitives()[i], corner);
+                for (size_t k = 0; k != 3; ++k)
+                {
+                    double projection = 0.0;
+                    for (size_t axis = 0; axis != 3; ++axis)
+                    {
+                        projection += box.axes[k][axis] * (mesh->Coord(vertex, axis) - box.center[axis]);
+                    }
+                    EXPECT_LE(std::abs(projection), box.half_sizes[k]);
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,9 +1,11 @@
 #include "ReadSTL.hpp"
+#include "Weld.hpp"
 #include "Vector.hpp"
 #include "Triangle.hpp"
 
 #include <gtest/gtest.h>
 
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 
@@ -141,6 +143,241 @@ TEST_F(ReadSTLTest, TriangleProperties)
     EXPECT_DOUBLE_EQ(triangles[0].GetPoint(2)[2], 0.0);
 }
 
+TEST_F(ReadSTLTest, BinaryMatchesStlReader)
+{
+    std::vector<Triangle> mapped = GetTriangles(test_filename);
+    std::vector<Triangle> legacy = GetTrianglesStlReader(test_filename);
+    ASSERT_EQ(mapped.size(), legacy.size());
+
+    // Треугольники, нормали, координаты и номера точек совпадают с прежним путём
+    for (size_t i = 0; i != mapped.size(); ++i)
+    {
+        EXPECT_EQ(mapped[i], legacy[i]);
+        for (size_t j = 0; j != 3; ++j)
+        {
+            EXPECT_EQ(mapped[i].GetPoint(j).GetNum(), legacy[i].GetPoint(j).GetNum());
+        }
+    }
+}
+
+TEST_F(ReadSTLTest, DetectBinarySTL)
+{
+    MappedFile file(test_filename);
+    EXPECT_TRUE(IsBinarySTL(file.Data(), file.Size()));
+    EXPECT_EQ(file.Size(), 84u + 2u * 50u);
+
+    const std::string ascii = "solid test\nendsolid test\n";
+    EXPECT_FALSE(IsBinarySTL(ascii.data(), ascii.size()));
+    EXPECT_FALSE(IsBinarySTL(nullptr, 0));
+}
+
+TEST_F(ReadSTLTest, MapNonExistentFile)
+{
+    EXPECT_THROW(MappedFile file(non_existent_filename), std::runtime_error);
+}
+
+// Текстовый вариант того же файла, что и CreateTestSTLFile
+void CreateTestAsciiSTLFile(const std::string &filename)
+{
+    std::ofstream out(filename);
+    out << "solid test\n"
+        << "  facet normal 0 0 1\n"
+        << "    outer loop\n"
+        << "      vertex 0 0 0\n"
+        << "      vertex 1.000000e+00 0 0\n"
+        << "      vertex 0 +1.0 0\n"
+        << "    endloop\n"
+        << "  endfacet\n"
+        << "  facet normal 0 1 0\n"
+        << "    outer loop\n"
+        << "      vertex 0 0 0\n"
+        << "      vertex 0 0 1\n"
+        << "      vertex 1 0 0\n"
+        << "    endloop\n"
+        << "  endfacet\n"
+        << "endsolid test\n";
+}
+
+TEST_F(ReadSTLTest, AsciiMatchesBinary)
+{
+    const std::string ascii_filename = "test_file_ascii.stl";
+    CreateTestAsciiSTLFile(ascii_filename);
+
+    std::vector<Triangle> ascii = GetTriangles(ascii_filename);
+    std::vector<Triangle> binary = GetTriangles(test_filename);
+    std::filesystem::remove(ascii_filename);
+
+    ASSERT_EQ(ascii.size(), binary.size());
+    for (size_t i = 0; i != ascii.size(); ++i)
+    {
+        EXPECT_EQ(ascii[i], binary[i]);
+        for (size_t j = 0; j != 3; ++j)
+        {
+            EXPECT_EQ(ascii[i].GetPoint(j).GetNum(), binary[i].GetPoint(j).GetNum());
+        }
+    }
+}
+
+TEST_F(ReadSTLTest, AsciiParallelKeepsOrder)
+{
+    // Файл больше минимального размера части, чтобы он разбился на несколько частей
+    const std::string ascii_filename = "test_file_ascii_big.stl";
+    {
+        std::ofstream out(ascii_filename);
+        out << "solid big\n";
+        for (size_t i = 0; i != 5000; ++i)
+        {
+            out << "facet normal 0 0 1\nouter loop\n"
+                << "vertex " << i << " 0 0\n"
+                << "vertex " << i + 1 << " 0 0\n"
+                << "vertex " << i << " 1.5e-1 0\n"
+                << "endloop\nendfacet\n";
+        }
+        out << "endsolid big\n";
+    }
+
+    MappedFile file(ascii_filename);
+    std::vector<Triangle> serial = ReadAsciiSTL(file, {.num_threads = 1}).ToTriangles();
+    std::vector<Triangle> parallel = ReadAsciiSTL(file, {.num_threads = 4}).ToTriangles();
+    std::filesystem::remove(ascii_filename);
+
+    ASSERT_EQ(serial.size(), 5000u);
+    ASSERT_EQ(parallel.size(), serial.size());
+    for (size_t i = 0; i != serial.size(); ++i)
+    {
+        EXPECT_EQ(parallel[i], serial[i]);
+        EXPECT_DOUBLE_EQ(parallel[i].GetPoint(0)[0], static_cast<double>(i));
+        for (size_t j = 0; j != 3; ++j)
+        {
+            EXPECT_EQ(parallel[i].GetPoint(j).GetNum(), serial[i].GetPoint(j).GetNum());
+        }
+    }
+    // Общие вершины соседних граней получают один номер
+    EXPECT_EQ(serial[0].GetPoint(1).GetNum(), serial[1].GetPoint(0).GetNum());
+}
+
+TEST_F(ReadSTLTest, AsciiInvalidNumber)
+{
+    const std::string ascii_filename = "test_file_ascii_bad.stl";
+    {
+        std::ofstream out(ascii_filename);
+        out << "solid bad\nfacet normal 0 0 1\nouter loop\nvertex 0 0 x\n";
+    }
+    MappedFile file(ascii_filename);
+    EXPECT_THROW(ReadAsciiSTL(file, {.num_threads = 1}), std::invalid_argument);
+    std::filesystem::remove(ascii_filename);
+}
+
+TEST_F(ReadSTLTest, StreamBinaryBatches)
+{
+    StlStream stream(test_filename, 1);
+    EXPECT_TRUE(stream.IsBinary());
+
+    std::vector<Triangle> expected = GetTriangles(test_filename);
+    std::vector<Triangle> batch;
+    size_t count = 0;
+    while (stream.NextBatch(batch))
+    {
+        ASSERT_EQ(batch.size(), 1u);
+        EXPECT_EQ(batch[0].GetNum(), count);
+        EXPECT_EQ(batch[0].GetNorm(), expected[count].GetNorm());
+        for (size_t j = 0; j != 3; ++j)
+        {
+            EXPECT_EQ(batch[0].GetPoint(j), expected[count].GetPoint(j));
+            // Без сварки номер точки - номер угла
+            EXPECT_EQ(batch[0].GetPoint(j).GetNum(), 3 * count + j);
+        }
+        ++count;
+    }
+    EXPECT_EQ(count, 2u);
+    EXPECT_EQ(stream.TrianglesRead(), 2u);
+}
+
+TEST_F(ReadSTLTest, StreamAsciiBatches)
+{
+    const std::string ascii_filename = "test_file_ascii_stream.stl";
+    {
+        std::ofstream out(ascii_filename);
+        out << "solid stream\n";
+        for (size_t i = 0; i != 50000; ++i)
+        {
+            out << "facet normal 0 0 1\nouter loop\n"
+                << "vertex " << i << " 0 0\n"
+                << "vertex " << i + 1 << " 0 0\n"
+                << "vertex " << i << " 1 0\n"
+                << "endloop\nendfacet\n";
+        }
+        out << "endsolid stream\n";
+    }
+
+    std::vector<Triangle> expected = GetTriangles(ascii_filename);
+    ASSERT_EQ(expected.size(), 50000u);
+
+    // Порция не кратна числу граней, файл больше блока чтения
+    StlStream stream(ascii_filename, 3000);
+    EXPECT_FALSE(stream.IsBinary());
+
+    std::vector<Triangle> batch;
+    size_t count = 0;
+    while (stream.NextBatch(batch))
+    {
+        EXPECT_LE(batch.size(), 3000u);
+        for (const Triangle &triangle : batch)
+        {
+            ASSERT_EQ(triangle.GetNum(), count);
+            EXPECT_EQ(triangle.GetPoint(0), expected[count].GetPoint(0));
+            EXPECT_EQ(triangle.GetPoint(2), expected[count].GetPoint(2));
+            ++count;
+        }
+    }
+    std::filesystem::remove(ascii_filename);
+    EXPECT_EQ(count, 50000u);
+}
+
+TEST(WeldTest, ExactWeldKeepsFirstAppearanceOrder)
+{
+    const std::vector<std::array<double, 3>> corners = {
+        {1.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 1.0, 0.0},
+        {0.0, -0.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 1.0}};
+
+    const WeldResult weld = WeldVertices(corners, 0.0, 2);
+    ASSERT_EQ(weld.vertices.size(), 4u);
+    EXPECT_EQ(weld.indices, (std::vector<uint32_t>{0, 1, 2, 1, 0, 3}));
+    EXPECT_EQ(weld.vertices[3], (std::array<double, 3>{0.0, 0.0, 1.0}));
+}
+
+TEST(WeldTest, ToleranceMergesNearbyCorners)
+{
+    const double ulp_shifted = std::nextafter(1.0, 2.0);
+    const std::vector<std::array<double, 3>> corners = {
+        {1.0, 2.0, 3.0}, {ulp_shifted, 2.0, 3.0}, {1.5, 2.0, 3.0}};
+
+    EXPECT_EQ(WeldVertices(corners).vertices.size(), 3u);
+
+    const WeldResult weld = WeldVertices(corners, 1e-6);
+    ASSERT_EQ(weld.vertices.size(), 2u);
+    EXPECT_EQ(weld.indices, (std::vector<uint32_t>{0, 0, 1}));
+    // Вершина берётся из первого угла ячейки
+    EXPECT_EQ(weld.vertices[0][0], 1.0);
+
+    EXPECT_THROW(WeldVertices(corners, -1.0), std::invalid_argument);
+}
+
+TEST(WeldTest, ParallelMatchesSerial)
+{
+    std::vector<std::array<double, 3>> corners;
+    for (size_t i = 0; i != 30000; ++i)
+    {
+        corners.push_back({static_cast<double>(i % 997), static_cast<double>(i % 13), 0.5});
+    }
+
+    const WeldResult serial = WeldVertices(corners, 0.0, 1);
+    const WeldResult parallel = WeldVertices(corners, 0.0, 8);
+    EXPECT_EQ(serial.vertices.size(), 997u * 13u);
+    EXPECT_EQ(serial.indices, parallel.indices);
+    EXPECT_EQ(serial.vertices, parallel.vertices);
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);